@@ -73,9 +73,28 @@ DEFAULT_AIRCRAFT_PARAMS = {
 
     'send_stick_position': {'label': 'Send Stick Position to Game', 'type': 'checkbox', 'value': True},
 
+    # --- X-Plane Force Passthrough ---
+    # Use X-Plane's own control forces (filtered, scaled and limited by the plugin) as the constant force
+    'xp_force_passthrough': {'label': 'X-Plane Force Passthrough', 'type': 'checkbox', 'value': False},
+    'xp_force_full_scale': {'label': 'XP Force Full Scale (lb)', 'type': 'slider', 'min': 5, 'max': 100, 'value': 30},
+    'xp_force_filter_hz': {'label': 'XP Force Filter (Hz)', 'type': 'slider', 'min': 0, 'max': 50, 'value': 15},
+    'xp_force_gain': {'label': 'XP Force Gain', 'type': 'slider', 'min': 0, 'max': 100, 'value': 100},
+
+    # --- X-Plane Telemetry Prediction ---
+    # Use inputs extrapolated by the plugin to compensate the telemetry and USB latency (0 ms = off)
+    'xp_predict_horizon_ms': {'label': 'XP Prediction Horizon (ms)', 'type': 'slider', 'min': 0, 'max': 100, 'value': 0},
+    'xp_predict_g_force': {'label': 'Predict G-Force', 'type': 'checkbox', 'value': True},
+    'xp_predict_aoa': {'label': 'Predict AoA (Stall)', 'type': 'checkbox', 'value': True},
+
     'max_aileron_coeff': {'label': 'Max Aileron Force %', 'type': 'slider', 'min': 0, 'max': 100, 'value': 100},
     'max_elevator_coeff': {'label': 'Max Elevator Force %', 'type': 'slider', 'min': 0, 'max': 100, 'value': 100},
     'prop_diameter': {'label': 'Prop Diameter (cm)', 'type': 'slider', 'min': 1, 'max': 500, 'value': 190},
+
+    # --- Pedals & Collective (--device pedals:... / collective:...) ---
+    'max_rudder_coeff': {'label': 'Max Rudder Force %', 'type': 'slider', 'min': 0, 'max': 100, 'value': 60},
+    'rudder_damper_coef': {'label': 'Rudder Damper Coef', 'type': 'slider', 'min': 0, 'max': 100, 'value': 10},
+    'collective_spring_coef': {'label': 'Collective Spring %', 'type': 'slider', 'min': 0, 'max': 100, 'value': 0},
+    'collective_friction_coef': {'label': 'Collective Friction %', 'type': 'slider', 'min': 0, 'max': 100, 'value': 30},
     
     # --- FFB Control ---
     
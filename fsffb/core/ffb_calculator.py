@@ -21,10 +21,13 @@ This module is responsible for calculating force feedback effects based on
 telemetry data received from the simulator.
 """
 
+import copy
 import math
 import time
-from fsffb.utils import clamp, expocurve, scale, scale_clamp, mix, Vector, Vector2D, LowPassFilter
+from collections import deque
+from fsffb.utils import clamp, expocurve, scale, scale_clamp, mix, Vector, Vector2D, LowPassFilter, DependentComputation
 import numpy as np
+from fsffb.scheduling import StageBudget, STAGE_CRITICAL, STAGE_NORMAL
 
 # Constants
 RAD_TO_DEG = 180 / math.pi
@@ -35,6 +38,18 @@ STD_AIR_DENSITY = 1.225  # kg/m^3
 VSOUND_ISA = 290.07 # m/s, speed of sound at sea level in ISA condition
 P0_ISA = 101325 # Pa, ISA static pressure at sealevel
 
+# process_frame stages: (priority, initial cost estimate in seconds). The spring and
+# constant force stages always run; vibrations (with damper/inertia/friction) are
+# skipped when the frame deadline is at risk, and the previous frame's are reused.
+CALCULATOR_STAGES = {
+    'spring_offsets': (STAGE_CRITICAL, 20e-6),
+    'sim_axes': (STAGE_CRITICAL, 5e-6),
+    'aero_springs': (STAGE_CRITICAL, 40e-6),
+    'pedal_collective': (STAGE_CRITICAL, 5e-6),
+    'constant_forces': (STAGE_CRITICAL, 30e-6),
+    'vibrations': (STAGE_NORMAL, 20e-6),
+}
+
 class FFBCalculator:
     """Calculates FFB effects from telemetry data."""
 
@@ -44,9 +59,12 @@ class FFBCalculator:
 
         Args:
             aircraft_params (dict): A dictionary of parameters for the
-                                    currently loaded aircraft.
+                                    currently loaded aircraft. The calculator keeps
+                                    a copy, changes go through update_parameter().
         """
-        self.params = aircraft_params
+        self.params = copy.deepcopy(aircraft_params)
+        # (name, value) updates from other threads, applied at the start of the next frame
+        self._pending_params = deque()
         # Store stick force data for potential future use
         self.stick_forces = {
             'pitch': 0.0,
@@ -64,17 +82,77 @@ class FFBCalculator:
         self.wind_y_derivative_filter = LowPassFilter(time_constant=1)
         #self.wind_z_derivative_filter = LowPassFilter(time_constant=filter_time_constant)
 
+        # Stage priorities and costs, and the effects reused when vibrations are skipped
+        self.stage_budget = StageBudget(CALCULATOR_STAGES)
+        self._last_vibration_effects = {}
+
+        # Scaled parameters, rebuilt after a parameter update
+        self._scaled_params = None
+
+        # Computations that only depend on a few inputs, rerun when one of them changes beyond
+        # its tolerance (telemetry key -> tolerance). The constant forces are not cached: their
+        # wind derivatives and filters advance every frame.
+        self._spring_offsets = DependentComputation(
+            self._calculate_spring_offsets,
+            channels={'ElevTrimPct': 1e-4, 'AileronTrimPct': 1e-4, 'ElevDeflPct': 1e-4,
+                      'AileronDeflPctLR': 1e-4, 'APPitchServo': 1e-4},
+            params=('trim_following', 'ap_following', 'ap_trim_only',
+                    'joystick_trim_follow_gain_physical_x', 'joystick_trim_follow_gain_physical_y',
+                    'joystick_trim_follow_gain_virtual_x', 'joystick_trim_follow_gain_virtual_y',
+                    'joystick_ap_follow_gain_physical_x', 'joystick_ap_follow_gain_physical_y'))
+        self._aero_springs = DependentComputation(
+            self._calculate_aero_spring_forces,
+            channels={'src': 0, 'IAS': 0.01, 'DynPressure': 0.2, 'AirDensity': 1e-4, 'PropThrust': 0.5,
+                      'AoA': 0.01, 'AoA_pred': 0.01, 'PredHorizonMs': 0, 'SideSlip': 0.01, 'StallAoA': 0.01,
+                      'SimOnGround': 0, 'Vne': 0.1, 'DesignSpeed': 0.1},
+            params=('prop_diameter', 'vne_override', 'aileron_expo', 'elevator_expo', 'max_aileron_coeff',
+                    'max_elevator_coeff', 'max_rudder_coeff', 'stall_aoa_ratio', 'xp_predict_aoa',
+                    'xp_predict_horizon_ms'))
+        self._stall_effects = DependentComputation(
+            self._calculate_stall_effects,
+            channels={'AoA': 0.01, 'AoA_pred': 0.01, 'PredHorizonMs': 0, 'StallAoA': 0.01, 'SimOnGround': 0},
+            params=('stall_aoa_ratio', 'stick_shaker_intensity', 'xp_predict_aoa', 'xp_predict_horizon_ms',
+                    'damper_coef'))
+        self._runway_rumble = DependentComputation(
+            self._calculate_runway_rumble,
+            channels={'SimOnGround': 0, 'GroundSpeed': 0.01},
+            params=('runway_rumble_intensity',))
+        self._test_effects = DependentComputation(self._calculate_test_effects, params=('test1', 'test2'))
+        self._computations = {'spring_offsets': self._spring_offsets, 'aero_springs': self._aero_springs,
+                              'stall_effects': self._stall_effects, 'runway_rumble': self._runway_rumble,
+                              'test_effects': self._test_effects}
+
     def update_parameter(self, name, value):
-        """Thread-safe method to update a single parameter."""
+        """
+        Thread-safe method to update a single parameter. The update is queued and
+        applied at the start of the next process_frame(), never during one.
+        """
         if name in self.params:
-            self.params[name]['value'] = value
+            self._pending_params.append((name, value))
         else:
             print(f"Warning: Attempted to update non-existent parameter '{name}'")
 
+    def _apply_parameter_updates(self):
+        """Applies the queued parameter updates, on the thread running process_frame()."""
+        while self._pending_params:
+            name, value = self._pending_params.popleft()
+            self.params[name]['value'] = value
+            self._scaled_params = None
+            for computation in self._computations.values():
+                computation.invalidate(name)
+
     def get_stick_forces(self):
         """Returns the current stick force values."""
         return self.stick_forces.copy()
 
+    def get_stage_stats(self):
+        """Returns the runs, skipped runs and cost estimate of every process_frame stage."""
+        return self.stage_budget.get_stats()
+
+    def get_cache_stats(self):
+        """Returns how often each cached computation reran and how often its result was reused."""
+        return {name: {'runs': c.runs, 'hits': c.hits} for name, c in self._computations.items()}
+
     def get_debug_data(self):
         """Returns collected debug data from the last frame."""
         return self.debug_data.copy()
@@ -95,10 +173,15 @@ class FFBCalculator:
         p['elevator_expo'] /= 100.0
         p['max_aileron_coeff'] /= 100.0
         p['max_elevator_coeff'] /= 100.0
+        p['max_rudder_coeff'] /= 100.0
+        p['rudder_damper_coef'] /= 100.0
+        p['collective_spring_coef'] /= 100.0
+        p['collective_friction_coef'] /= 100.0
         p['g_force_gain'] /= 100.0
         p['elevator_droop_moment'] /= 500.0
         #p['lateral_force_gain'] /= 100.0
         p['stick_shaker_intensity'] /= 100.0
+        p['xp_force_gain'] /= 100.0
         p['runway_rumble_intensity'] /= 100.0
 
         # --- Trim Following ---
@@ -122,6 +205,21 @@ class FFBCalculator:
 
         return p
 
+    def _predicted(self, p, name):
+        """True when the checkbox `name` selects a prediction and the horizon is not 0."""
+        return bool(p[name]) and p['xp_predict_horizon_ms'] > 0
+
+    def _input(self, telem, key, default, predicted=False):
+        """
+        Returns a telemetry input, or its prediction when `predicted` is set and the
+        plugin is predicting (PredHorizonMs > 0) and publishes one ("<key>_pred": [value, error bound]).
+        """
+        if predicted and telem.get('PredHorizonMs', 0) > 0:
+            prediction = telem.get(key + '_pred')
+            if isinstance(prediction, list) and prediction:
+                return prediction[0]
+        return telem.get(key, default)
+
     def _calculate_time_derivative(self, current_value, variable_name, dt):
         """
         Calculate the time derivative of a variable.
@@ -148,17 +246,22 @@ class FFBCalculator:
         
         return derivative
 
-    def process_frame(self, telemetry, joystick_axes):
+    def process_frame(self, telemetry, joystick_axes, deadline=None):
         """
         Calculates all force feedback effects and simulator control inputs.
 
         Args:
             telemetry (dict): A dictionary of telemetry data from the simulator.
             joystick_axes (dict): Current position of the joystick axes.
+            deadline (float): time.perf_counter() by which the frame should be done, or None.
+                              Stages that are not critical are skipped if they would miss it.
 
         Returns:
             (dict, dict, dict): A tuple containing (ffb_effects, simulator_axes, virtual_offsets)
         """
+        if self._pending_params:
+            self._apply_parameter_updates()
+
         if not telemetry:
             self.debug_data = {}
             return {}, {}, {}
@@ -174,29 +277,46 @@ class FFBCalculator:
         self.stick_forces['yaw'] = telemetry.get('StickForceYaw', 0.0)
 
         # Get all scaled parameters at the beginning of the frame
-        p = self._get_scaled_params()
+        p = self._scaled_params
+        if p is None:
+            p = self._scaled_params = self._get_scaled_params()
 
         is_msfs = telemetry.get('src') != 'XPLANE'
         ap_active = (telemetry.get("APMaster", 0) or p['PMDG_AP_On']) if is_msfs else telemetry.get("APServos", 0)
 
+        budget = self.stage_budget
+
         # 1. Calculate spring center offsets from trim and autopilot
-        phys_offsets, virtual_offsets = self._calculate_spring_offsets(telemetry, ap_active, is_msfs, p)
+        phys_offsets, virtual_offsets = budget.run(
+            'spring_offsets', deadline, None, self._spring_offsets, telemetry, ap_active, is_msfs, p)
 
         # 2. Calculate final axis values to send to the simulator
-        sim_axes = self._calculate_final_sim_axes(joystick_axes, virtual_offsets, phys_offsets, ap_active)
+        sim_axes = budget.run(
+            'sim_axes', deadline, None, self._calculate_final_sim_axes, joystick_axes, virtual_offsets, phys_offsets, ap_active)
 
         # 3. Calculate Aerodynamic Forces (Springs)
-        spring_effects, aero_debug_data = self._calculate_aero_spring_forces(telemetry, phys_offsets, p)
-        self.debug_data = aero_debug_data
+        spring_effects, aero_debug_data = budget.run(
+            'aero_springs', deadline, None, self._aero_springs, telemetry, phys_offsets, p)
+        self.debug_data = dict(aero_debug_data)  # Cached: the constant forces add to a copy
+
+        # 3b. Springs, damper and friction of the pedals and collective, when connected
+        device_effects = {}
+        if 'px' in joystick_axes or 'cy' in joystick_axes:
+            device_effects = budget.run(
+                'pedal_collective', deadline, {}, self._calculate_pedal_collective_effects,
+                telemetry, joystick_axes, aero_debug_data['spring_coeff_rudder'], p)
 
         # 4. Calculate Constant Forces (G-force, droop, wind derivatives)
-        constant_effects = self._calculate_constant_forces(telemetry, joystick_axes, p, dt, ap_active)
+        constant_effects = budget.run(
+            'constant_forces', deadline, None, self._calculate_constant_forces, telemetry, joystick_axes, p, dt, ap_active)
 
-        # 5. Calculate Vibrations and Other Effects
-        vibration_effects = self._calculate_vibration_effects(telemetry, p)
+        # 5. Calculate Vibrations and Other Effects, or keep the last ones if out of time
+        vibration_effects = budget.run(
+            'vibrations', deadline, self._last_vibration_effects, self._calculate_vibration_effects, telemetry, p)
+        self._last_vibration_effects = vibration_effects
         
         # Combine all effects into a single dictionary
-        ffb_effects = {**spring_effects, **constant_effects, **vibration_effects}
+        ffb_effects = {**spring_effects, **device_effects, **constant_effects, **vibration_effects}
         
         return ffb_effects, sim_axes, virtual_offsets
 
@@ -275,7 +395,10 @@ class FFBCalculator:
             sim_x = -(phys_x - virtual_offsets['x'])
             sim_y = phys_y - virtual_offsets['y']
         
-        return {'jx': sim_x, 'jy': sim_y, 'px': joystick_axes.get('px', 0)}
+        sim_axes = {'jx': sim_x, 'jy': sim_y, 'px': joystick_axes.get('px', 0)}
+        if 'cy' in joystick_axes:
+            sim_axes['cy'] = joystick_axes['cy']  # Collective, only when a device provides it
+        return sim_axes
 
     def _calculate_aero_spring_forces(self, telem, phys_offsets, p):
         """Calculates the main aerodynamic spring forces on the control surfaces."""
@@ -330,11 +453,13 @@ class FFBCalculator:
         max_elevator_coeff = p['max_elevator_coeff']
         final_aileron_coeff = scale_clamp(aileron_coeff, (0, 1), (0, max_aileron_coeff))
         final_elevator_coeff = scale_clamp(elevator_coeff, (0, 1), (0, max_elevator_coeff))
+        # The rudder sees the aileron's dynamic pressure and expo, without the stall fade
+        final_rudder_coeff = scale_clamp(aileron_coeff, (0, 1), (0, p['max_rudder_coeff']))
 
         # --- 5. Calculate Stall Effects ---
 
         stall_aoa = telem.get('StallAoA', 0) * p['stall_aoa_ratio']
-        aoa = telem.get('AoA', 0)
+        aoa = self._input(telem, 'AoA', 0, self._predicted(p, 'xp_predict_aoa'))
 
         if (aoa > stall_aoa) & (not telem.get('SimOnGround', False)):
             final_aileron_coeff *= np.exp(-(aoa-stall_aoa)/5)
@@ -363,6 +488,7 @@ class FFBCalculator:
         debug_data = {
             'spring_coeff_x': final_aileron_coeff,
             'spring_coeff_y': final_elevator_coeff,
+            'spring_coeff_rudder': final_rudder_coeff,
             'elev_dyn_pressure': elev_dyn_pressure,
             'aileron_dyn_pressure': aileron_dyn_pressure,
             'mixing_factor': mixing_factor,
@@ -372,11 +498,32 @@ class FFBCalculator:
         
         return spring_effects, debug_data
 
+    def _calculate_pedal_collective_effects(self, telem, joystick_axes, rudder_coeff, p):
+        """
+        Calculates the effects of the pedals (axis 'px') and the collective (axis 'cy'),
+        for the devices that provide them; DeviceManager routes them by role.
+        """
+        effects = {}
+        if 'px' in joystick_axes:
+            rudder_trim = telem.get('RudderTrimPct', 0) if p['trim_following'] else 0
+            effects['spring_rudder'] = {'coefficient': rudder_coeff, 'cp_offset': clamp(rudder_trim, -1, 1)}
+            effects['damper_rudder'] = {'coef_x': p['rudder_damper_coef'], 'coef_y': 0}
+        if 'cy' in joystick_axes:
+            effects['spring_collective'] = {'coefficient': p['collective_spring_coef'], 'cp_offset': 0}
+            effects['friction_collective'] = {'coef_x': 0, 'coef_y': p['collective_friction_coef']}
+        return effects
+
     def _calculate_constant_forces(self, telem, joystick_axes, p, dt, ap_active):
         """Calculates constant forces like G-force, control surface droop, and wind derivatives."""
+        # The wind filters advance every frame, also under passthrough, so switching it
+        # off continues from settled filters instead of stepping the force
+        filtered_wind_x_derivative, filtered_wind_y_derivative, wind_y = self._update_wind_derivatives(telem, dt)
+
+        if p['xp_force_passthrough'] and 'XPForce' in telem:
+            return self._passthrough_constant_force(telem['XPForce'], p, ap_active)
         
         accel_body = telem.get('AccBody', (0, 0, 0)) # Y-component for Gs
-        g_force = telem.get('G', 1.0)
+        g_force = self._input(telem, 'G', 1.0, self._predicted(p, 'xp_predict_g_force'))
         dyn_pressure = telem.get('DynPressure', 0)
         
         g_force_gain = p['g_force_gain'] # Scale from 0-100 slider
@@ -385,28 +532,6 @@ class FFBCalculator:
 
         elevator_droop_moment = p['elevator_droop_moment']
         elevator_droop_term = elevator_droop_moment * g_force / (1 + dyn_pressure)
-        
-        # Calculate time derivative of WindX
-        wind_x = telem.get('WindX', 0.0) # East/West
-        wind_x_derivative = self._calculate_time_derivative(wind_x, 'WindX', dt)
-
-        wind_z = telem.get('WindZ', 0.0) # North/South
-        wind_z_derivative = self._calculate_time_derivative(wind_z, 'WindZ', dt)
-
-        wind_y = telem.get('WindY', 0.0) # vertical 
-        wind_y_derivative = self._calculate_time_derivative(wind_y, 'WindY', dt)
-
-        angle = telem.get('Heading', 0) * RAD_TO_DEG
-
-        #wind_on_aircraft_x = wind_x * math.cos(angle * DEG_TO_RAD) - wind_z * math.sin(angle * DEG_TO_RAD)
-        #wind_on_aircraft_z = wind_z * math.cos(angle * DEG_TO_RAD) + wind_x * math.sin(angle * DEG_TO_RAD)
-
-        wind_on_aircraft_x_derivative = wind_x_derivative * math.cos(angle * DEG_TO_RAD) - wind_z_derivative * math.sin(angle * DEG_TO_RAD)
-        wind_on_aircraft_z_derivative = wind_z_derivative * math.cos(angle * DEG_TO_RAD) + wind_x_derivative * math.sin(angle * DEG_TO_RAD)
-        
-        # Filter the derivatives
-        filtered_wind_x_derivative = self.wind_x_derivative_filter.process(wind_on_aircraft_x_derivative, dt)
-        filtered_wind_y_derivative = self.wind_y_derivative_filter.process(wind_y_derivative, dt)
 
         wind_derivative_x_term = filtered_wind_x_derivative * p['wind_gain_x']
         wind_derivative_y_term = filtered_wind_y_derivative * p['wind_gain_y']
@@ -447,12 +572,72 @@ class FFBCalculator:
             }
         }
 
+    def _update_wind_derivatives(self, telem, dt):
+        """
+        Advances the wind derivatives and their filters by one frame.
+
+        Returns:
+            (float, float, float): Filtered lateral and vertical wind derivatives, and the vertical wind.
+        """
+        # Calculate time derivative of WindX
+        wind_x = telem.get('WindX', 0.0) # East/West
+        wind_x_derivative = self._calculate_time_derivative(wind_x, 'WindX', dt)
+
+        wind_z = telem.get('WindZ', 0.0) # North/South
+        wind_z_derivative = self._calculate_time_derivative(wind_z, 'WindZ', dt)
+
+        wind_y = telem.get('WindY', 0.0) # vertical 
+        wind_y_derivative = self._calculate_time_derivative(wind_y, 'WindY', dt)
+
+        angle = telem.get('Heading', 0) * RAD_TO_DEG
+
+        #wind_on_aircraft_x = wind_x * math.cos(angle * DEG_TO_RAD) - wind_z * math.sin(angle * DEG_TO_RAD)
+        #wind_on_aircraft_z = wind_z * math.cos(angle * DEG_TO_RAD) + wind_x * math.sin(angle * DEG_TO_RAD)
+
+        wind_on_aircraft_x_derivative = wind_x_derivative * math.cos(angle * DEG_TO_RAD) - wind_z_derivative * math.sin(angle * DEG_TO_RAD)
+        wind_on_aircraft_z_derivative = wind_z_derivative * math.cos(angle * DEG_TO_RAD) + wind_x_derivative * math.sin(angle * DEG_TO_RAD)
+        
+        # Filter the derivatives
+        filtered_wind_x_derivative = self.wind_x_derivative_filter.process(wind_on_aircraft_x_derivative, dt)
+        filtered_wind_y_derivative = self.wind_y_derivative_filter.process(wind_y_derivative, dt)
+
+        return filtered_wind_x_derivative, filtered_wind_y_derivative, wind_y
+
+    def _passthrough_constant_force(self, xp_force, p, ap_active):
+        """
+        Maps the plugin's normalized X-Plane control forces (roll, pitch, yaw) straight
+        onto the constant force. Filtering, scaling and limiting already ran in the plugin.
+        """
+        roll_force = clamp(-xp_force[0] * p['xp_force_gain'], -1.0, 1.0)
+        pitch_force = clamp(xp_force[1] * p['xp_force_gain'], -1.0, 1.0)
+
+        magnitude, direction = Vector2D(roll_force, pitch_force).to_polar()
+        if ap_active:
+            magnitude = 0
+
+        self.debug_data.update({
+            'xp_force_roll': roll_force,
+            'xp_force_pitch': pitch_force,
+            'ap_active': ap_active,
+        })
+
+        return {
+            'constant_force': {
+                'magnitude': magnitude,
+                'direction': direction * RAD_TO_DEG
+            }
+        }
+
     def _calculate_vibration_effects(self, telem, p):
         """Calculates vibration effects like stall, runway rumble, etc."""
+        return {**self._stall_effects(telem, p), **self._runway_rumble(telem, p), **self._test_effects(telem, p)}
+
+    def _calculate_stall_effects(self, telem, p):
+        """Stick shakers past the stall AoA, and the damper / inertia / friction effects."""
         effects = {}
 
         # aileron stall
-        aoa = telem.get('AoA', 0)
+        aoa = self._input(telem, 'AoA', 0, self._predicted(p, 'xp_predict_aoa'))
         stall_aoa = telem.get('StallAoA', 0) * p['stall_aoa_ratio']
         if (aoa > stall_aoa) & (not telem.get('SimOnGround', False)):
             shaker_intensity = (1 - abs(aoa-(stall_aoa*1.2))/(stall_aoa*0.3)) * p['stick_shaker_intensity']
@@ -478,7 +663,22 @@ class FFBCalculator:
                 'magnitude': shaker_intensity,
                 'direction': 90
             }
-            
+
+        # --- Damper, Inertia, Friction ---
+
+        damper_aileron += p['damper_coef'] / 100.0
+        damper_aileron = clamp(damper_aileron, 0, 0.8)
+
+        effects['damper'] = {'coef_x': damper_aileron, 'coef_y': p['damper_coef'] / 100.0}
+        effects['inertia'] = {'coef_x': 0, 'coef_y': 0}
+        effects['friction'] = {'coef_x': 0, 'coef_y': 0}
+
+        return effects
+
+    def _calculate_runway_rumble(self, telem, p):
+        """Runway rumble on the ground, rising with ground speed."""
+        effects = {}
+
         if telem.get('SimOnGround', False):
             speed_kts = telem.get('GroundSpeed', 0) * MS_TO_KT
             if speed_kts > 5:
@@ -507,6 +707,12 @@ class FFBCalculator:
                     'direction': 180
                 }
 
+        return effects
+
+    def _calculate_test_effects(self, telem, p):
+        """Fixed test vibrations, switched by parameters."""
+        effects = {}
+
         if p['test1']:
             effects['test1'] = {
                 'type': 'periodic',
@@ -524,14 +730,4 @@ class FFBCalculator:
                 'direction': 90
             }
 
-
-        # --- Damper, Inertia, Friction ---
-
-        damper_aileron += p['damper_coef'] / 100.0
-        damper_aileron = clamp(damper_aileron, 0, 0.8)
-
-        effects['damper'] = {'coef_x': damper_aileron, 'coef_y': p['damper_coef'] / 100.0}
-        effects['inertia'] = {'coef_x': 0, 'coef_y': 0}
-        effects['friction'] = {'coef_x': 0, 'coef_y': 0}
-
         return effects 
\ No newline at end of file
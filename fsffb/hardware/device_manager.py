@@ -0,0 +1,273 @@
+#
+# This program is largely based on the TelemFFB distribution (https://github.com/walmis/TelemFFB).
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, version 3.
+#
+# This program is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+# General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <http://www.gnu.org/licenses/>.
+#
+
+"""
+DeviceManager Module
+
+Drives several force feedback devices at once (stick, pedals, collective).
+
+Every device has its own JoystickManager (HID reader thread and effect slot
+state) and its own writer thread. The backend hands each frame's effects to
+DeviceManager.apply_effects(), which only posts them to the writers: a writer
+that is still busy with a slow USB write finds the newest effects when it is
+done and skips the frames in between. One slow device therefore never delays
+the backend loop or another device.
+
+Routing maps the calculator outputs to devices:
+  - axis_map renames the device's axes to calculator axes, e.g. pedals {'jx': 'px'}.
+  - effects maps the device's effect names to calculator effect names, e.g. pedals
+    {'spring_x': 'spring_rudder'}. None sends every calculator effect unchanged.
+"""
+
+import time
+import logging
+from threading import Thread, Condition
+
+from .joystick_manager import JoystickManager
+
+# Default routing by device role
+ROLE_ROUTES = {
+    'stick': {
+        'axis_map': {'jx': 'jx', 'jy': 'jy'},
+        'effects': None,
+    },
+    'pedals': {
+        'axis_map': {'jx': 'px'},
+        'effects': {'spring_x': 'spring_rudder', 'damper': 'damper_rudder',
+                    'runway_rumble_1': 'runway_rumble_1', 'runway_rumble_2': 'runway_rumble_2'},
+    },
+    'collective': {
+        'axis_map': {'jy': 'cy'},
+        'effects': {'spring_y': 'spring_collective', 'friction': 'friction_collective'},
+    },
+}
+
+# Effects holding every device while the sim is paused (no telemetry)
+IDLE_EFFECTS = {
+    'spring_x': {'coefficient': 0.3, 'cp_offset': 0},
+    'spring_y': {'coefficient': 0.3, 'cp_offset': 0},
+    'constant_force': {'magnitude': 0, 'direction': 0},
+    'spring_rudder': {'coefficient': 0.3, 'cp_offset': 0},
+    'spring_collective': {'coefficient': 0, 'cp_offset': 0},
+    'friction_collective': {'coef_x': 0, 'coef_y': 0.3},
+}
+
+
+class DeviceConfig:
+    """Describes one FFB device and how calculator outputs are routed to it."""
+
+    def __init__(self, name, role='stick', vendor_id=0xFFFF, product_id=0x2055, serial=None,
+                 axis_map=None, effects=None, device=None):
+        """
+        Args:
+            name (str): Name used in logs and stats.
+            role (str): 'stick', 'pedals' or 'collective', selects the default routing.
+            vendor_id (int), product_id (int): HID IDs of the device.
+            serial (str): HID serial number, to tell apart devices with the same IDs.
+            axis_map (dict): Device axis -> calculator axis, overrides the role default.
+            effects (dict): Device effect -> calculator effect, overrides the role default.
+            device: An already open device (e.g. StubHidDevice) instead of a HID search.
+        """
+        route = ROLE_ROUTES.get(role, ROLE_ROUTES['stick'])
+        self.name = name
+        self.role = role
+        self.vendor_id = vendor_id
+        self.product_id = product_id
+        self.serial = serial
+        self.axis_map = axis_map if axis_map is not None else dict(route['axis_map'])
+        self.effects = effects if effects is not None else route['effects']
+        self.device = device
+
+    @classmethod
+    def parse(cls, text):
+        """Parses "role:vid:pid[:serial]" (IDs in hex), e.g. "pedals:ffff:2060"."""
+        parts = text.split(':')
+        if len(parts) < 3:
+            raise ValueError(f"Device '{text}' is not role:vid:pid[:serial]")
+        role = parts[0]
+        if role not in ROLE_ROUTES:
+            raise ValueError(f"Device '{text}' has an unknown role, expected one of {', '.join(ROLE_ROUTES)}")
+        try:
+            vendor_id, product_id = int(parts[1], 16), int(parts[2], 16)
+        except ValueError:
+            raise ValueError(f"Device '{text}' does not have hex vendor and product IDs") from None
+        serial = parts[3] if len(parts) > 3 else None
+        return cls(role, role=role, vendor_id=vendor_id, product_id=product_id, serial=serial)
+
+
+class FFBDevice(Thread):
+    """Writer thread of one device; applies the newest posted effects (latest wins)."""
+
+    def __init__(self, config, scheduling=None, recorder=None):
+        super().__init__(daemon=True, name=f"ffb-writer-{config.name}")
+        self.config = config
+        self.scheduling = scheduling or {}
+        self.joystick = JoystickManager(config.vendor_id, config.product_id, scheduling=scheduling,
+                                        device=config.device, serial=config.serial, recorder=recorder)
+        self._condition = Condition()
+        self._pending = None        # Newest effects not yet written
+        self._stop_pending = False  # stop_all_effects() requested
+        self._quit = False
+        self.stats = {'posted': 0, 'applied': 0, 'skipped': 0, 'errors': 0, 'write_time_max_ms': 0.0}
+        self.start()
+
+    @property
+    def is_connected(self):
+        return self.joystick.is_connected
+
+    def post(self, effects, stop_first=False):
+        """Queues effects for the writer, replacing any not written yet. Never blocks on I/O."""
+        with self._condition:
+            if self._pending is not None:
+                self.stats['skipped'] += 1
+            self._pending = self._route(effects)
+            self._stop_pending = self._stop_pending or stop_first
+            self.stats['posted'] += 1
+            self._condition.notify()
+
+    def post_stop(self):
+        """Queues a stop of all effects."""
+        with self._condition:
+            self._pending = None
+            self._stop_pending = True
+            self._condition.notify()
+
+    def read_axes(self):
+        """Returns the device axes renamed to calculator axes."""
+        axes = self.joystick.read_axes()
+        return {target: axes.get(source, 0.0) for source, target in self.config.axis_map.items()}
+
+    def _route(self, effects):
+        routes = self.config.effects
+        if routes is None:
+            return effects
+        return {device_name: effects[calc_name] for device_name, calc_name in routes.items() if calc_name in effects}
+
+    def run(self):
+        if self.scheduling:
+            from ..scheduling import apply_thread_scheduling
+            apply_thread_scheduling(self.name, self.scheduling.get('priority', 'normal'), self.scheduling.get('cpus'))
+
+        while True:
+            with self._condition:
+                while self._pending is None and not self._stop_pending and not self._quit:
+                    self._condition.wait()
+                if self._quit:
+                    return
+                effects, stop = self._pending, self._stop_pending
+                self._pending, self._stop_pending = None, False
+
+            # HID writes happen outside the lock so post() never waits for them
+            start = time.perf_counter()
+            try:
+                if stop:
+                    self.joystick.stop_all_effects()
+                if effects is not None:
+                    self.joystick.apply_effects(effects)
+            except Exception:
+                # A bad frame must not kill the writer; the next posted frame is tried as usual
+                logging.exception(f"Error applying effects to {self.config.name}")
+                self.stats['errors'] += 1
+            if effects is not None:
+                self.stats['applied'] += 1
+            elapsed_ms = (time.perf_counter() - start) * 1000.0
+            self.stats['write_time_max_ms'] = max(self.stats['write_time_max_ms'], elapsed_ms)
+
+    def close(self):
+        with self._condition:
+            self._quit = True
+            self._condition.notify()
+        self.join()
+        self.joystick.close()
+
+
+class DeviceManager:
+    """Routes calculator outputs to several FFB devices, each with independent I/O."""
+
+    def __init__(self, configs=None, scheduling=None, recorder=None):
+        """
+        Args:
+            configs (list): DeviceConfig per device, default a single VPforce Rhino stick.
+            scheduling (dict): Optional 'priority' and 'cpus' for the device threads.
+            recorder (HidRecorder): Optional recorder of the HID traffic, devices are
+                                    told apart by their index in `configs`.
+        """
+        configs = configs or [DeviceConfig('stick')]
+        self.devices = [FFBDevice(config, scheduling, recorder.channel(index) if recorder else None)
+                        for index, config in enumerate(configs)]
+
+    @property
+    def is_connected(self):
+        """True while at least one device is connected."""
+        return any(device.is_connected for device in self.devices)
+
+    def read_axes(self):
+        """Merges the axes of all devices, keyed by calculator axis."""
+        axes = {}
+        for device in self.devices:
+            if device.is_connected:
+                axes.update(device.read_axes())
+        return axes
+
+    def apply_effects(self, effects):
+        """Posts the frame's effects to every connected device."""
+        for device in self.devices:
+            if device.is_connected:
+                device.post(effects)
+
+    def stop_all_effects(self):
+        for device in self.devices:
+            if device.is_connected:
+                device.post_stop()
+
+    def get_stats(self):
+        """Per-device counters: posted, applied and skipped (superseded) frames, slowest write."""
+        return {device.config.name: dict(device.stats) for device in self.devices}
+
+    def close(self):
+        for device in self.devices:
+            device.close()
+
+
+if __name__ == '__main__':
+    # Two stub devices, the pedals with a slow USB link, driven at 100 Hz
+    from .stub_device import StubHidDevice
+
+    logging.basicConfig(level=logging.WARNING)
+    stick = StubHidDevice(write_latency=0.0002)
+    pedals = StubHidDevice(write_latency=0.02)
+    manager = DeviceManager([DeviceConfig('stick', device=stick),
+                             DeviceConfig('pedals', role='pedals', device=pedals)])
+
+    frames = 200
+    post_times = []
+    for frame in range(frames):
+        start = time.perf_counter()
+        manager.apply_effects({
+            'spring_x': {'coefficient': 0.5, 'cp_offset': 0},
+            'spring_y': {'coefficient': 0.5, 'cp_offset': 0},
+            'spring_rudder': {'coefficient': 0.3, 'cp_offset': 0},
+            'constant_force': {'magnitude': frame / frames, 'direction': 0},
+        })
+        post_times.append((time.perf_counter() - start) * 1000.0)
+        time.sleep(0.01)
+    time.sleep(0.1)
+
+    print(f"Backend post time: max {max(post_times):.3f} ms over {frames} frames")
+    for name, stats in manager.get_stats().items():
+        print(f"{name:>7}: posted {stats['posted']}, applied {stats['applied']}, "
+              f"skipped {stats['skipped']}, errors {stats['errors']}, slowest write {stats['write_time_max_ms']:.1f} ms")
+    manager.close()
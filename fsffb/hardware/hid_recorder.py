@@ -0,0 +1,198 @@
+#
+# This program is largely based on the TelemFFB distribution (https://github.com/walmis/TelemFFB).
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, version 3.
+#
+# This program is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+# General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <http://www.gnu.org/licenses/>.
+#
+
+"""
+HID Recorder Module
+
+Records the HID traffic of the FFB devices: every output report written by
+JoystickManager, every input report read, and a marker for every telemetry
+frame the backend receives, each with a monotonic timestamp. Analyze the
+result with fsffb.tools.hid_analyzer.
+
+Records go into a preallocated ring buffer, so recording costs a lock and a
+struct.pack_into per report. With a path a flusher thread appends the ring to
+the file: the writers fill one half while it writes the other outside the
+lock, so a slow disk never blocks an HID write. If the flusher falls a full
+ring behind, new records are dropped and counted in `lost`. Without a path
+the ring keeps the newest `capacity` records in memory, to be saved with
+dump() after a problem.
+
+File format: b"FSFFBHID1\\n", then fixed size records of
+struct '<dBBH' (seconds since the recording started, kind, device index,
+report length) followed by REPORT_SIZE bytes of report (zero padded).
+"""
+
+import time
+import struct
+import logging
+from threading import Condition, Lock, Thread
+
+HID_RECORDING_MAGIC = b"FSFFBHID1\n"
+KIND_OUTPUT = 0
+KIND_INPUT = 1
+KIND_FRAME = 2
+REPORT_SIZE = 64
+_RECORD_HEADER = struct.Struct('<dBBH')
+_RECORD = struct.Struct(f'<dBBH{REPORT_SIZE}s')
+
+
+class HidRecorderChannel:
+    """The recorder as seen by one device: output() and input() tagged with its index."""
+
+    def __init__(self, recorder, device):
+        self.recorder = recorder
+        self.device = device
+
+    def output(self, data):
+        self.recorder.record(KIND_OUTPUT, self.device, data)
+
+    def input(self, data):
+        self.recorder.record(KIND_INPUT, self.device, data)
+
+
+class HidRecorder:
+    """Ring buffer of timestamped HID reports and telemetry frame markers."""
+
+    def __init__(self, path=None, capacity=65536):
+        """
+        Args:
+            path (str): File to stream the records to, or None to keep them in memory only.
+            capacity (int): Records held by the ring buffer.
+        """
+        self.path = path
+        self.capacity = capacity
+        self._buffer = bytearray(capacity * _RECORD.size)
+        self._count = 0     # Records since start
+        self._flushed = 0   # Records written to the file, the ring never overwrites any after them
+        self.lost = 0       # Records dropped because the flusher fell behind
+        self._lock = Lock()
+        self._flush_needed = Condition(self._lock)
+        self._closing = False
+        self._start = time.perf_counter()
+        self._file = None
+        self._flusher = None
+        if path:
+            self._file = open(path, 'wb')
+            self._file.write(HID_RECORDING_MAGIC)
+            self._flusher = Thread(target=self._flush_loop, name="hid-recorder", daemon=True)
+            self._flusher.start()
+            logging.info(f"Recording HID reports to {path}")
+
+    def channel(self, device):
+        """Returns the recorder interface for device number `device`."""
+        return HidRecorderChannel(self, device)
+
+    def record(self, kind, device, data):
+        data = bytes(data[:REPORT_SIZE])
+        with self._lock:
+            if self._flusher:
+                if self._count - self._flushed >= self.capacity:
+                    self.lost += 1  # The flusher is still writing this slot
+                    return
+                if self._count - self._flushed == self.capacity // 2:
+                    self._flush_needed.notify()
+            _RECORD.pack_into(self._buffer, (self._count % self.capacity) * _RECORD.size,
+                              time.perf_counter() - self._start, kind, device, len(data), data)
+            self._count += 1
+
+    def output(self, data):
+        self.record(KIND_OUTPUT, 0, data)
+
+    def input(self, data):
+        self.record(KIND_INPUT, 0, data)
+
+    def frame(self, seq=0):
+        """Marks the arrival of telemetry frame `seq` (for the frame to HID write latency)."""
+        self.record(KIND_FRAME, 0, struct.pack('<I', seq & 0xFFFFFFFF))
+
+    def _records(self, first, last):
+        """Bytes of records first..last-1, which must still be in the ring."""
+        chunks = []
+        while first < last:
+            slot = first % self.capacity
+            count = min(last - first, self.capacity - slot)
+            chunks.append(self._buffer[slot * _RECORD.size:(slot + count) * _RECORD.size])
+            first += count
+        return b''.join(chunks)
+
+    def _flush_loop(self):
+        """Flusher thread: writes the records from _flushed on whenever half the ring is used."""
+        lost = 0
+        while True:
+            with self._lock:
+                self._flush_needed.wait_for(
+                    lambda: self._closing or self._count - self._flushed >= self.capacity // 2, timeout=1.0)
+                first, last, closing = self._flushed, self._count, self._closing
+            # Writers do not touch records first..last-1 until _flushed moves past them
+            self._file.write(self._records(first, last))
+            with self._lock:
+                self._flushed = last
+                if self.lost > lost:
+                    logging.warning(f"HID recorder overrun, {self.lost - lost} records lost")
+                    lost = self.lost
+            if closing:
+                return
+
+    def dump(self, path):
+        """Saves the records still in the ring buffer to `path`."""
+        with self._lock:
+            data = self._records(max(0, self._count - self.capacity), self._count)
+        with open(path, 'wb') as f:
+            f.write(HID_RECORDING_MAGIC)
+            f.write(data)
+
+    def close(self):
+        """Writes the remaining records and closes the file."""
+        if not self._flusher:
+            return
+        with self._lock:
+            self._closing = True
+            self._flush_needed.notify()
+        self._flusher.join()
+        self._flusher = None
+        self._file.close()
+        self._file = None
+        logging.info(f"HID recording {self.path} closed, {self._count} records"
+                     + (f", {self.lost} lost" if self.lost else ""))
+
+
+def read_hid_recording(path):
+    """
+    Reads a HID recording.
+
+    Yields:
+        tuple: (time, kind, device, report bytes) for every complete record.
+    """
+    with open(path, 'rb') as f:
+        if f.read(len(HID_RECORDING_MAGIC)) != HID_RECORDING_MAGIC:
+            raise ValueError(f"{path} is not a HID recording")
+        while True:
+            record = f.read(_RECORD.size)
+            if len(record) < _RECORD.size:
+                return
+            receive_time, kind, device, length = _RECORD_HEADER.unpack_from(record)
+            yield receive_time, kind, device, record[_RECORD_HEADER.size:_RECORD_HEADER.size + length]
+
+
+if __name__ == '__main__':
+    # Recording overhead per report
+    recorder = HidRecorder(capacity=4096)
+    report = bytes(17)
+    count = 100000
+    start = time.perf_counter()
+    for _ in range(count):
+        recorder.output(report)
+    print(f"{(time.perf_counter() - start) / count * 1e6:.2f} us per recorded report")
@@ -27,6 +27,8 @@ import time
 import ctypes
 from threading import Thread, Lock, Event
 
+from ..scheduling import apply_thread_scheduling
+
 # --- FFB Report Structures from ffb_rhino.py ---
 HID_REPORT_ID_SET_EFFECT = 101
 HID_REPORT_ID_EFFECT_OPERATION = 110
@@ -47,6 +49,12 @@ AXIS_ENABLE_DIR = 4
 AXIS_ENABLE_X = 1
 AXIS_ENABLE_Y = 2
 
+# --- Periodic effect pooling ---
+PERIODIC_POOL_SIZE = 4          # Slots created and started up front, idle at zero magnitude
+PERIODIC_MIN_HOLD = 0.3         # Seconds an effect keeps its slot once started
+PERIODIC_RELEASE_DELAY = 0.15   # Seconds an effect must be absent before its slot goes back to the pool
+MAGNITUDE_QUANTUM = 32          # Magnitude steps (of 4096) below which no update is sent
+
 class FFBReport_SetEffect(ctypes.LittleEndianStructure):
     _pack_ = 1
     _fields_ = [("reportId", ctypes.c_uint8), ("effectBlockIndex", ctypes.c_uint8),
@@ -99,20 +107,47 @@ class FFBReport_SetCondition(ctypes.LittleEndianStructure):
 class JoystickManager(Thread):
     """Manages communication with a VPforce Rhino FFB joystick."""
 
-    def __init__(self, vendor_id=0xFFFF, product_id=0x2055):
+    def __init__(self, vendor_id=0xFFFF, product_id=0x2055, scheduling=None, device=None, serial=None,
+                 recorder=None):
+        """
+        Args:
+            vendor_id (int): HID vendor ID of the joystick.
+            product_id (int): HID product ID of the joystick.
+            scheduling (dict): Optional 'priority' and 'cpus' for the HID reader thread
+                               (see fsffb.scheduling.apply_thread_scheduling).
+            device: An already open device with the hid.device read/write interface to use
+                    instead of searching for the joystick, e.g. a StubHidDevice.
+            serial (str): HID serial number to pick one of several devices with the same IDs.
+            recorder: Optional HidRecorder (or HidRecorderChannel) logging every report written and read.
+        """
         super().__init__(daemon=True)
+        self.scheduling = scheduling or {}
+        self.effective_scheduling = None
         self.vendor_id = vendor_id
         self.product_id = product_id
-        self.device = None
-        self.is_connected = False
+        self.serial = serial
+        self.device = device
+        self.is_connected = device is not None
+        # HID output reports written since start, see fsffb.hardware.stub_device for a benchmark
+        self.reports_written = 0
+        self.recorder = recorder
         self.axes = {'jx': 0.0, 'jy': 0.0}
         # --- vibration management state ---
-        # key -> state dict containing slot / pending / last_props
+        # key -> state dict containing slot / sent (quantized parameters) / started / last_seen
         self._periodic_states = {}
+        # Idle periodic slots, configured and running at zero magnitude: slot -> sent parameters
+        self._periodic_pool = {}
         self._used_slots = set()
         # Condition effect state (damper / inertia / friction)
         self._condition_states = {}
+        # Running constant force effect (slot 2): last direction and magnitude sent, None if stopped
+        self._constant_state = None
         self.lock = Lock()
+        # Effect state is only touched by the thread applying effects, under this lock. The
+        # reader thread (lost device) and failed writes set _effects_stale instead, and the
+        # next apply_effects() rebuilds the effects.
+        self._effects_lock = Lock()
+        self._effects_stale = False
         self._quit_event = Event()
         
         self.start()
@@ -132,6 +167,7 @@ class JoystickManager(Thread):
             joystick_devices = [
                 dev for dev in all_devices
                 if dev['interface_number'] == 0 and dev['usage_page'] == 1 and dev['usage'] == 4
+                and (self.serial is None or dev.get('serial_number') == self.serial)
             ]
 
             if not joystick_devices:
@@ -155,6 +191,10 @@ class JoystickManager(Thread):
             
     def run(self):
         """Threaded loop to continuously read axis data."""
+        if self.scheduling:
+            self.effective_scheduling = apply_thread_scheduling(
+                "hid-reader", self.scheduling.get('priority', 'normal'), self.scheduling.get('cpus'))
+
         while not self._quit_event.is_set():
             if not self.is_connected:
                 if self._connect_to_device():
@@ -169,6 +209,8 @@ class JoystickManager(Thread):
                 # Read data from the device. Now non-blocking.
                 report = self.device.read(64) 
                 if report:
+                    if self.recorder:
+                        self.recorder.input(report)
                     self._parse_input_report(report)
             except (IOError, ValueError) as e:
                 logging.error(f"Error reading from joystick, disconnecting: {e}")
@@ -176,6 +218,7 @@ class JoystickManager(Thread):
                 if self.device:
                     self.device.close()
                 self.device = None
+                self._effects_stale = True  # Effects are recreated on the reconnected device
             
             time.sleep(0.001)
 
@@ -199,7 +242,12 @@ class JoystickManager(Thread):
     def apply_effects(self, effects):
         if not self.is_connected:
             return
+        with self._effects_lock:
+            if self._effects_stale:
+                self._resync_effects()
+            self._apply_effects(effects)
 
+    def _apply_effects(self, effects):
         # Handle *all* periodic vibration effects generically
         self._update_periodic_effects(effects)
 
@@ -208,18 +256,23 @@ class JoystickManager(Thread):
 
         if 'constant_force' in effects:
             self._send_constant_force_effect(effects['constant_force'])
-        else:
-            self.stop_effect(2) # Stop constant force effect if not present
+        elif self._constant_state is not None:
+            if self.stop_effect(2): # Stop constant force effect if not present
+                self._constant_state = None
 
         # Springs are always sent
         self._send_spring_effect(axis=0, props=effects.get('spring_x', {'coefficient': 0, 'cp_offset': 0}))
         self._send_spring_effect(axis=1, props=effects.get('spring_y', {'coefficient': 0, 'cp_offset': 0}))
 
     def _send_constant_force_effect(self, props):
-        """Constructs and sends a constant force effect."""
+        """
+        Updates the constant force effect. The effect is created and started once and
+        then kept running: an update writes the magnitude only when the quantized value
+        changed, and the effect header only when the quantized direction changed.
+        """
         effect_id = 2 # Use slot 2 for constant force
         magnitude = int(props.get('magnitude', 0) * 4096)
-        
+
         # --- Axis Correction ---
         # The joystick hardware appears to have a reflected coordinate system for forces.
         # We correct this by transforming the angle: new_angle = 90 - old_angle.
@@ -227,21 +280,29 @@ class JoystickManager(Thread):
         corrected_direction = (90 - original_direction) % 360
         direction_hid = int(corrected_direction * 255 / 360)
 
-        # 1. Set the basic effect type and direction
-        set_effect_report = FFBReport_SetEffect(
-            effectBlockIndex=effect_id, effectType=EFFECT_CONSTANT,
-            axesEnable=AXIS_ENABLE_DIR, directionX=direction_hid
-        )
-        self._write_report(bytes(set_effect_report))
-
-        # 2. Set the magnitude
-        set_force_report = FFBReport_SetConstantForce(
-            effectBlockIndex=effect_id, magnitude=magnitude
-        )
-        self._write_report(bytes(set_force_report))
-
-        # 3. Start the effect
-        self.start_effect(effect_id)
+        state = self._constant_state
+        written = True
+        if state is None or state['direction'] != direction_hid:
+            # 1. Set the basic effect type and direction (in place if already running)
+            set_effect_report = FFBReport_SetEffect(
+                effectBlockIndex=effect_id, effectType=EFFECT_CONSTANT,
+                axesEnable=AXIS_ENABLE_DIR, directionX=direction_hid
+            )
+            written = self._write_report(bytes(set_effect_report))
+
+        # 2. Set the magnitude, if it changed
+        if state is None or state['magnitude'] != magnitude:
+            set_force_report = FFBReport_SetConstantForce(
+                effectBlockIndex=effect_id, magnitude=magnitude
+            )
+            written = self._write_report(bytes(set_force_report)) and written
+
+        # 3. Start the effect, once
+        if state is None:
+            written = self.start_effect(effect_id) and written
+
+        # After a failed write the device state is unknown: create and start it again next frame
+        self._constant_state = {'direction': direction_hid, 'magnitude': magnitude} if written else None
 
     # ------------------------------------------------------------------
     # Multi-vibration support (generic periodic effects)
@@ -264,8 +325,81 @@ class JoystickManager(Thread):
     def _release_dynamic_slot(self, slot):
         self._used_slots.discard(slot)
 
+    def _periodic_parameters(self, props):
+        """Quantized (effect type, direction, magnitude, period) of a periodic effect."""
+        target_mag = int(props.get('magnitude', 0) * 4096)
+        target_mag = int(round(target_mag / MAGNITUDE_QUANTUM)) * MAGNITUDE_QUANTUM
+        freq = props.get('frequency', 0)
+        period = int(round(1000 / freq)) if freq > 0 else 0
+
+        waveform = props.get('waveform', 'sine')
+        if waveform == 'square':
+            et_type = EFFECT_SQUARE  # device interprets as square
+        elif waveform == 'sine':
+            et_type = EFFECT_SINE
+        elif waveform == 'saw_up':
+            et_type = EFFECT_SAWTOOTHUP
+        elif waveform == 'saw_down':
+            et_type = EFFECT_SAWTOOTHDOWN
+        else:
+            et_type = EFFECT_SINE
+
+        # Axis correction
+        orig_dir = props.get('direction', 0)
+        corr_dir = (90 - orig_dir) % 360
+        dir_hid = int(corr_dir * 255 / 360)
+        return (et_type, dir_hid, target_mag, period)
+
+    def _write_periodic(self, slot, sent, wanted):
+        """Writes only the reports whose quantized parameters changed; returns `wanted`."""
+        et_type, dir_hid, mag, period = wanted
+        if sent is None or sent[:2] != wanted[:2]:
+            # Header: waveform or direction changed (in place on a running effect)
+            self._write_report(bytes(FFBReport_SetEffect(
+                effectBlockIndex=slot, effectType=et_type,
+                axesEnable=AXIS_ENABLE_DIR, directionX=dir_hid)))
+        if sent is None or sent[2:] != wanted[2:]:
+            self._write_report(bytes(FFBReport_SetPeriodic(
+                effectBlockIndex=slot, magnitude=mag, period=period, phase=0)))
+        return wanted
+
+    def _acquire_periodic_slot(self, wanted):
+        """Takes an idle pooled slot (preferring one with the same waveform), or creates one."""
+        for slot, sent in self._periodic_pool.items():
+            if sent[0] == wanted[0]:
+                return slot, self._periodic_pool.pop(slot)
+        if self._periodic_pool:
+            slot = next(iter(self._periodic_pool))
+            return slot, self._periodic_pool.pop(slot)
+        slot = self._allocate_dynamic_slot()
+        if slot is None:
+            return None, None
+        # New slot: configure at zero magnitude and start, it keeps running from now on
+        sent = self._write_periodic(slot, None, wanted[:2] + (0, wanted[3]))
+        self.start_effect(slot)
+        return slot, sent
+
+    def _fill_periodic_pool(self):
+        """Creates the pooled periodic slots up front so the first vibrations cost no setup."""
+        while len(self._periodic_pool) + len(self._periodic_states) < PERIODIC_POOL_SIZE:
+            slot = self._allocate_dynamic_slot()
+            if slot is None:
+                return
+            self._periodic_pool[slot] = self._write_periodic(slot, None, (EFFECT_SINE, 0, 0, 0))
+            self.start_effect(slot)
+
     def _update_periodic_effects(self, effects_dict):
-        """Ensure all requested periodic vibration effects are running and update/stop as required."""
+        """
+        Plays the requested periodic vibration effects on pooled slots.
+
+        Slots are never stopped while connected: an effect that goes away keeps its slot
+        for at least PERIODIC_MIN_HOLD after it started and PERIODIC_RELEASE_DELAY after it
+        was last requested, then drops to zero magnitude and returns to the pool. Updates
+        are only written when the quantized parameters change, so a steady vibration
+        costs no HID traffic.
+        """
+        now = time.monotonic()
+        self._fill_periodic_pool()
 
         # Collect requested vibration effects (stick_shaker, runway_rumble, + any future ones that declare 'frequency')
         requested = {
@@ -273,80 +407,32 @@ class JoystickManager(Thread):
             if isinstance(props, dict) and 'frequency' in props
         }
 
-        # Stop effects that are no longer requested
+        # Release effects that have been absent long enough (hysteresis against flicker)
         for name in list(self._periodic_states.keys()):
-            if name not in requested:
-                state = self._periodic_states.pop(name)
-                self.stop_effect(state['slot'])
-                self._release_dynamic_slot(state['slot'])
+            if name in requested:
+                continue
+            state = self._periodic_states[name]
+            if now - state['started'] < PERIODIC_MIN_HOLD or now - state['last_seen'] < PERIODIC_RELEASE_DELAY:
+                continue  # Keeps playing its last parameters for now
+            del self._periodic_states[name]
+            sent = state['sent']
+            self._periodic_pool[state['slot']] = self._write_periodic(state['slot'], sent, sent[:2] + (0, sent[3]))
 
         # Update or start requested effects
         for name, props in requested.items():
+            wanted = self._periodic_parameters(props)
             state = self._periodic_states.get(name)
 
-            # --- common calculations ---
-            target_mag = int(props.get('magnitude', 0) * 4096)
-            freq = props.get('frequency', 0)
-            period = int(1000 / freq) if freq > 0 else 0
-
-            waveform = props.get('waveform', 'sine')
-            if waveform == 'square':
-                et_type = EFFECT_SQUARE  # device interprets as square
-            elif waveform == 'sine':
-                et_type = EFFECT_SINE
-            elif waveform == 'saw_up':
-                et_type = EFFECT_SAWTOOTHUP
-            elif waveform == 'saw_down':
-                et_type = EFFECT_SAWTOOTHDOWN
-            else:
-                et_type = EFFECT_SINE
-
-            # Axis correction
-            orig_dir = props.get('direction', 0)
-            corr_dir = (90 - orig_dir) % 360
-            dir_hid = int(corr_dir * 255 / 360)
-
-            def _configure(effect_id, effect_type, dir_val, mag):
-                # 1. Header
-                self._write_report(bytes(FFBReport_SetEffect(
-                    effectBlockIndex=effect_id, effectType=effect_type,
-                    axesEnable=AXIS_ENABLE_DIR, directionX=dir_val)))
-
-                # 2. Periodic params
-                self._write_report(bytes(FFBReport_SetPeriodic(
-                    effectBlockIndex=effect_id, magnitude=mag,
-                    period=period, phase=0)))
-
             if state is None:
-                slot = self._allocate_dynamic_slot()
+                slot, sent = self._acquire_periodic_slot(wanted)
                 if slot is None:
                     logging.warning("No free vibration slots – skipping effect '%s'" % name)
                     continue
+                state = {'slot': slot, 'sent': sent, 'started': now}
+                self._periodic_states[name] = state
 
-                # Configure with zero magnitude and start immediately
-                _configure(slot, et_type, dir_hid, 0)
-                self.start_effect(slot)
-
-                self._periodic_states[name] = {
-                    'slot': slot,
-                    'pending': True,  # will get real magnitude on the next tick
-                    'props': props.copy()
-                }
-                continue
-
-            slot = state['slot']
-
-            # Apply real magnitude on the next tick
-            if state.get('pending'):
-                _configure(slot, et_type, dir_hid, target_mag)
-                state['pending'] = False
-                state['props'] = props.copy()
-                continue
-
-            # Property change?
-            if props != state.get('props'):
-                _configure(slot, et_type, dir_hid, target_mag)
-                state['props'] = props.copy()
+            state['last_seen'] = now
+            state['sent'] = self._write_periodic(state['slot'], state['sent'], wanted)
 
     # ------------------------------------------------------------------
     # Condition effects (Damper, Inertia, Friction)
@@ -449,24 +535,31 @@ class JoystickManager(Thread):
     def start_effect(self, effect_id):
         # USB PID specification: loopCount=1 means infinite when duration=0. Keeps compatibility with multiple effects.
         op = FFBReport_EffectOperation(effectBlockIndex=effect_id, operation=OP_START, loopCount=1)
-        self._write_report(bytes(op))
+        return self._write_report(bytes(op))
         
     def stop_effect(self, effect_id):
         op = FFBReport_EffectOperation(effectBlockIndex=effect_id, operation=3) # 3 = OP_STOP
-        self._write_report(bytes(op))
+        return self._write_report(bytes(op))
 
     def stop_all_effects(self):
         """Stops all active effects on the joystick."""
         if not self.is_connected:
             return
-        
-        logging.info("Stopping all joystick effects.")
+        with self._effects_lock:
+            logging.info("Stopping all joystick effects.")
+            self._stop_all_effects()
 
-        # Stop periodic effects
+    def _stop_all_effects(self):
+        """Stops every effect slot in use and releases it, with _effects_lock held."""
+        # Stop periodic effects, including the idle pooled slots
         for name in list(self._periodic_states.keys()):
             state = self._periodic_states.pop(name)
             self.stop_effect(state['slot'])
             self._release_dynamic_slot(state['slot'])
+        for slot in list(self._periodic_pool.keys()):
+            del self._periodic_pool[slot]
+            self.stop_effect(slot)
+            self._release_dynamic_slot(slot)
 
         # Stop condition effects
         for name in list(self._condition_states.keys()):
@@ -476,16 +569,46 @@ class JoystickManager(Thread):
         
         # Stop constant force (slot 2)
         self.stop_effect(2)
+        self._constant_state = None
 
-    def _write_report(self, data):
-        """Wrapper for device.write to handle errors."""
-        if not self.is_connected:
-            return
+    def _resync_effects(self):
+        """
+        Stops the effects that may still run with stale parameters and forgets their
+        state, after a failed write or a lost device; apply_effects() recreates them.
+        """
+        logging.info("Recreating joystick effects.")
+        self._stop_all_effects()
+        self._reset_effect_state()
+        self._effects_stale = False
+
+    def _reset_effect_state(self):
+        """Forgets all effect slots."""
+        self._periodic_states.clear()
+        self._periodic_pool.clear()
+        self._condition_states.clear()
+        self._used_slots.clear()
+        self._constant_state = None
+
+    def _write_report(self, data, settle=True):
+        """
+        Wrapper for device.write to handle errors. Returns True if the report was written,
+        so effect state is only kept for reports that reached the device.
+        """
+        device = self.device  # The reader thread drops it on a read error
+        if not self.is_connected or device is None:
+            return False
         try:
-            self.device.write(data)
-            time.sleep(0.001)  # Give the device time to process the report
+            device.write(data)
         except (IOError, ValueError) as e:
             logging.error(f"Error writing HID report: {e}")
+            self._effects_stale = True
+            return False
+        self.reports_written += 1
+        if self.recorder:
+            self.recorder.output(data)
+        if settle:
+            time.sleep(0.001)  # Give the device time to process the report
+        return True
 
     def _send_spring_effect(self, axis, props):
         """Constructs and sends a proper FFBReport_SetCondition for a spring."""
@@ -504,11 +627,8 @@ class JoystickManager(Thread):
             deadBand=0
         )
         
-        try:
-            # Convert the ctypes structure to bytes and send it
-            self.device.write(bytes(report))
-        except (IOError, ValueError) as e:
-            logging.error(f"Error sending spring effect: {e}")
+        # Springs are rewritten every frame, without the settle delay of the other reports
+        self._write_report(bytes(report), settle=False)
 
     def read_axes(self):
         """
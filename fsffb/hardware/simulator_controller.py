@@ -78,13 +78,24 @@ class SimulatorController:
         
         logging.debug(f"Sent axes {axes} to {'MSFS' if self.is_msfs else 'X-Plane'}")
 
+    def define_axis(self, name, datarefs, **kwargs):
+        """
+        Declares an additional axis for send_axis_data(), e.g. toe brakes from an FFB rudder.
+        Only supported for X-Plane, see XPlaneManager.define_axis for the arguments.
+        """
+        if self.is_xplane:
+            self.active_manager.define_axis(name, datarefs, **kwargs)
+        else:
+            logging.info(f"Axis definition '{name}' ignored for MSFS in this implementation.")
+
     def set_override(self, override_type, enabled):
         """
         Enables or disables control overrides in the simulator.
         This is primarily for X-Plane.
 
         Args:
-            override_type (str): The type of override ('joystick', 'pedals', 'collective').
+            override_type (str): The axis group ('joystick', 'pedals', 'collective' or a
+                                 group given to define_axis).
             enabled (bool): True to enable the override, False to disable.
         """
         if self.is_xplane:
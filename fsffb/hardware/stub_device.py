@@ -0,0 +1,137 @@
+#
+# This program is largely based on the TelemFFB distribution (https://github.com/walmis/TelemFFB).
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, version 3.
+#
+# This program is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+# General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <http://www.gnu.org/licenses/>.
+#
+
+"""
+Stub HID Device Module
+
+A stand-in for hid.device that records the output reports written to it, so
+the effect code in JoystickManager can be exercised and measured without a
+joystick attached:
+
+    device = StubHidDevice(write_latency=0.0002)
+    joystick = JoystickManager(device=device)
+
+Running this module benchmarks the per-frame HID traffic of apply_effects()
+with a constant force that changes every frame, and with a stick shaker that
+flickers on and off around its AoA threshold.
+"""
+
+import time
+from collections import Counter
+
+
+class StubHidDevice:
+    """Records written reports; reads return nothing (no axis input)."""
+
+    def __init__(self, write_latency=0.0):
+        """
+        Args:
+            write_latency (float): Seconds each write() blocks, to model the USB transfer.
+        """
+        self.write_latency = write_latency
+        self.reports = []
+        self.closed = False
+
+    def write(self, data):
+        if self.write_latency:
+            time.sleep(self.write_latency)
+        self.reports.append(bytes(data))
+        return len(data)
+
+    def read(self, size):
+        return []
+
+    def set_nonblocking(self, enabled):
+        pass
+
+    def get_product_string(self):
+        return "Stub FFB device"
+
+    def close(self):
+        self.closed = True
+
+    def report_counts(self):
+        """Returns the number of written reports by report ID."""
+        return Counter(report[0] for report in self.reports)
+
+    def clear(self):
+        self.reports.clear()
+
+
+if __name__ == '__main__':
+    import math
+    import logging
+
+    from fsffb.hardware.joystick_manager import (
+        JoystickManager, FFBReport_SetEffect, FFBReport_SetConstantForce,
+        EFFECT_CONSTANT, AXIS_ENABLE_DIR)
+
+    logging.basicConfig(level=logging.WARNING)
+    FRAMES = 300
+
+    def restarting_constant_force(joystick, props):
+        """The previous behaviour: reconfigure and restart the effect every frame."""
+        direction_hid = int(((90 - props.get('direction', 0)) % 360) * 255 / 360)
+        joystick.stop_effect(2)
+        joystick._write_report(bytes(FFBReport_SetEffect(
+            effectBlockIndex=2, effectType=EFFECT_CONSTANT, axesEnable=AXIS_ENABLE_DIR, directionX=direction_hid)))
+        joystick._write_report(bytes(FFBReport_SetConstantForce(
+            effectBlockIndex=2, magnitude=int(props.get('magnitude', 0) * 4096))))
+        joystick.start_effect(2)
+
+    def run(label, restart):
+        device = StubHidDevice(write_latency=0.0002)
+        joystick = JoystickManager(device=device)
+        if restart:
+            joystick._send_constant_force_effect = lambda props: restarting_constant_force(joystick, props)
+        start = time.perf_counter()
+        for frame in range(FRAMES):
+            # Magnitude changes every frame, direction flips with the sign of a slow G oscillation
+            g = math.sin(frame / 20.0)
+            joystick.apply_effects({
+                'constant_force': {'magnitude': abs(g) * 0.5, 'direction': 0 if g >= 0 else 180},
+                'spring_x': {'coefficient': 0.5, 'cp_offset': 0},
+                'spring_y': {'coefficient': 0.5, 'cp_offset': 0},
+            })
+        elapsed = time.perf_counter() - start
+        written = joystick.reports_written
+        counts = device.report_counts()
+        joystick.close()
+        print(f"{label}: {written / FRAMES:.2f} reports/frame, "
+              f"{elapsed / FRAMES * 1000:.2f} ms/frame "
+              f"(SetEffect {counts[101]}, SetConstantForce {counts[105]}, EffectOperation {counts[110]})")
+
+    def run_vibration():
+        device = StubHidDevice()
+        joystick = JoystickManager(device=device)
+        joystick.apply_effects({})
+        start_written = joystick.reports_written
+        for frame in range(FRAMES):
+            effects = {}
+            if (frame // 3) % 2 == 0:
+                # Shaker toggling every 3 frames with a slightly noisy magnitude
+                effects['stick_shaker_1'] = {'waveform': 'sine', 'frequency': 13,
+                                             'magnitude': 0.3 + 0.001 * math.sin(frame), 'direction': 0}
+            joystick.apply_effects(effects)
+            time.sleep(0.005)
+        # Springs are written every frame, count the vibration reports only
+        periodic = joystick.reports_written - start_written - 2 * FRAMES
+        joystick.close()
+        print(f"Flickering shaker: {periodic} periodic reports over {FRAMES} frames")
+
+    run("Restart every frame", restart=True)
+    run("Persistent effect  ", restart=False)
+    run_vibration()
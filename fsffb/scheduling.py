@@ -0,0 +1,353 @@
+#
+# This program is largely based on the TelemFFB distribution (https://github.com/walmis/TelemFFB).
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, version 3.
+#
+# This program is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+# General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <http://www.gnu.org/licenses/>.
+#
+
+"""
+Scheduling Module
+
+This module sets the priority and CPU affinity of the real-time threads
+(backend compute loop, HID reader) on Windows and Linux, and provides a
+jitter histogram to measure how regular a loop actually runs.
+
+Settings are applied to the calling thread. Anything the OS refuses (e.g. a
+real-time policy without the needed privileges) falls back to the closest
+permitted setting, and the effective result is returned and logged.
+"""
+
+import os
+import sys
+import math
+import time
+import logging
+import threading
+
+PRIORITIES = ('normal', 'above_normal', 'high', 'realtime')
+
+# Stage priorities of StageBudget: critical stages always run, the others only if they fit
+STAGE_CRITICAL = 0
+STAGE_NORMAL = 1
+STAGE_LOW = 2
+# Estimated cost multiple a stage must fit in before the deadline, by priority
+_STAGE_MARGIN = {STAGE_NORMAL: 1.5, STAGE_LOW: 3.0}
+
+# Windows thread priority levels (SetThreadPriority)
+_WIN_THREAD_PRIORITY = {
+    'normal': 0,            # THREAD_PRIORITY_NORMAL
+    'above_normal': 1,      # THREAD_PRIORITY_ABOVE_NORMAL
+    'high': 2,              # THREAD_PRIORITY_HIGHEST
+    'realtime': 15,         # THREAD_PRIORITY_TIME_CRITICAL
+}
+
+# Linux nice values for the non real-time levels, SCHED_FIFO priority for 'realtime'
+_LINUX_NICE = {'normal': 0, 'above_normal': -5, 'high': -10}
+_LINUX_FIFO_PRIORITY = 50
+
+
+def parse_cpu_list(text):
+    """Parses a CPU list such as "2,3" or "0-3" into a sorted list of CPU indices."""
+    cpus = set()
+    if not text:
+        return []
+    for part in text.split(','):
+        part = part.strip()
+        if '-' in part:
+            first, last = part.split('-', 1)
+            cpus.update(range(int(first), int(last) + 1))
+        elif part:
+            cpus.add(int(part))
+    return sorted(cpus)
+
+
+def cpu_mask(cpus):
+    """Returns the affinity bit mask for a list of CPU indices (0 = no restriction)."""
+    mask = 0
+    for cpu in cpus or []:
+        mask |= 1 << cpu
+    return mask
+
+
+def apply_thread_scheduling(name, priority='normal', cpus=None):
+    """
+    Applies priority and CPU affinity to the calling thread.
+
+    Args:
+        name (str): Thread name used in the log report.
+        priority (str): One of 'normal', 'above_normal', 'high', 'realtime'.
+        cpus (list): CPU indices to pin the thread to, or None/empty for no restriction.
+
+    Returns:
+        dict: The effective settings: 'priority', 'cpus' and 'fallback' (True when
+              the requested setting was not permitted and a lower one is in effect).
+    """
+    if priority not in PRIORITIES:
+        logging.warning(f"Unknown thread priority '{priority}' for {name}, using 'normal'")
+        priority = 'normal'
+
+    if sys.platform == 'win32':
+        effective = _apply_windows(priority, cpus)
+    elif sys.platform.startswith('linux'):
+        effective = _apply_linux(priority, cpus)
+    else:
+        effective = {'priority': 'normal', 'cpus': [], 'fallback': priority != 'normal' or bool(cpus)}
+
+    level = logging.WARNING if effective['fallback'] else logging.INFO
+    logging.log(level, f"Thread '{name}' scheduling: priority={effective['priority']}, "
+                       f"cpus={effective['cpus'] or 'all'}"
+                       f"{' (requested ' + priority + ' not permitted)' if effective['fallback'] else ''}")
+    return effective
+
+
+def _apply_windows(priority, cpus):
+    import ctypes
+    kernel32 = ctypes.windll.kernel32
+    kernel32.GetCurrentThread.restype = ctypes.c_void_p
+    kernel32.SetThreadPriority.argtypes = [ctypes.c_void_p, ctypes.c_int]
+    kernel32.SetThreadAffinityMask.argtypes = [ctypes.c_void_p, ctypes.c_size_t]
+    kernel32.SetThreadAffinityMask.restype = ctypes.c_size_t
+    thread = kernel32.GetCurrentThread()
+
+    # Step down one level at a time, like on Linux, until the OS accepts one
+    fallback = False
+    effective_priority = 'normal'
+    for level in reversed(PRIORITIES[:PRIORITIES.index(priority) + 1]):
+        if kernel32.SetThreadPriority(thread, _WIN_THREAD_PRIORITY[level]):
+            effective_priority = level
+            break
+        fallback = True
+
+    effective_cpus = []
+    if cpus:
+        if kernel32.SetThreadAffinityMask(thread, cpu_mask(cpus)):
+            effective_cpus = list(cpus)
+        else:
+            fallback = True
+
+    return {'priority': effective_priority, 'cpus': effective_cpus, 'fallback': fallback}
+
+
+def _apply_linux(priority, cpus):
+    tid = threading.get_native_id()
+    fallback = False
+    effective_priority = 'normal'
+
+    if priority == 'realtime':
+        try:
+            os.sched_setscheduler(tid, os.SCHED_FIFO, os.sched_param(_LINUX_FIFO_PRIORITY))
+            effective_priority = 'realtime'
+        except (PermissionError, OSError):
+            # No CAP_SYS_NICE / rtprio limit: fall back to the best nice level we can get
+            fallback = True
+            priority = 'high'
+
+    if effective_priority != 'realtime':
+        for level in ('high', 'above_normal', 'normal'):
+            if PRIORITIES.index(level) > PRIORITIES.index(priority):
+                continue
+            try:
+                os.setpriority(os.PRIO_PROCESS, tid, _LINUX_NICE[level])
+                effective_priority = level
+                break
+            except (PermissionError, OSError):
+                fallback = True
+
+    effective_cpus = []
+    if cpus:
+        try:
+            os.sched_setaffinity(tid, cpus)
+            effective_cpus = sorted(os.sched_getaffinity(tid))
+        except (PermissionError, OSError, ValueError):
+            fallback = True
+
+    return {'priority': effective_priority, 'cpus': effective_cpus, 'fallback': fallback}
+
+
+class JitterHistogram:
+    """
+    Histogram of loop periods, used to compare scheduling settings.
+
+    Periods are bucketed by their deviation from the median period on a log scale,
+    so the tail (late wakeups, preemption) stays visible next to the bulk.
+    """
+
+    # Upper edges of the deviation buckets in milliseconds
+    BUCKET_EDGES_MS = (0.1, 0.25, 0.5, 1.0, 2.0, 4.0, 8.0, 16.0, math.inf)
+
+    def __init__(self, max_samples=10000):
+        self.max_samples = max_samples
+        self.reset()
+
+    def reset(self):
+        """Clears all recorded periods."""
+        self.periods = []
+        self._last_time = None
+
+    def tick(self, now):
+        """Records the period since the previous tick (time in seconds)."""
+        if self._last_time is not None and len(self.periods) < self.max_samples:
+            self.periods.append((now - self._last_time) * 1000.0)
+        self._last_time = now
+
+    def summary(self):
+        """Returns count, median, mean, standard deviation, p99 and max of the periods in ms."""
+        if not self.periods:
+            return None
+        ordered = sorted(self.periods)
+        count = len(ordered)
+        mean = sum(ordered) / count
+        variance = sum((p - mean) ** 2 for p in ordered) / count
+        return {
+            'count': count,
+            'median': ordered[count // 2],
+            'mean': mean,
+            'stdev': math.sqrt(variance),
+            'p99': ordered[min(count - 1, int(count * 0.99))],
+            'max': ordered[-1],
+        }
+
+    def buckets(self):
+        """Returns (edge_ms, count) pairs of the deviation from the median period."""
+        stats = self.summary()
+        counts = [0] * len(self.BUCKET_EDGES_MS)
+        if stats:
+            for period in self.periods:
+                deviation = abs(period - stats['median'])
+                for i, edge in enumerate(self.BUCKET_EDGES_MS):
+                    if deviation <= edge:
+                        counts[i] += 1
+                        break
+        return list(zip(self.BUCKET_EDGES_MS, counts))
+
+    def format(self, title):
+        """Formats the summary and histogram as text for the log."""
+        stats = self.summary()
+        if not stats:
+            return f"{title}: no samples"
+        lines = [f"{title}: {stats['count']} periods, median {stats['median']:.2f} ms, "
+                 f"stdev {stats['stdev']:.2f} ms, p99 {stats['p99']:.2f} ms, max {stats['max']:.2f} ms"]
+        for edge, count in self.buckets():
+            label = f"<= {edge:g} ms" if edge != math.inf else "> 16 ms"
+            bar = '#' * int(round(40 * count / stats['count']))
+            lines.append(f"  {label:>10} {count:6d} {bar}")
+        return "\n".join(lines)
+
+
+class FlowMeter:
+    """
+    Measures the achieved frame rate and the capacity of a processing loop, the
+    rate it could reach if it never waited for input (frames per busy second).
+    Reported to the X-Plane plugin for flow control, see XPlaneManager.report_flow().
+    """
+
+    def __init__(self, interval=0.25):
+        self.interval = interval
+        self._start = None
+        self._frames = 0
+        self._busy = 0.0
+
+    def frame_done(self, now, busy_seconds):
+        """Counts one processed frame that took `busy_seconds` of work."""
+        if self._start is None:
+            self._start = now
+        self._frames += 1
+        self._busy += busy_seconds
+
+    def poll(self, now):
+        """Returns (achieved_hz, capacity_hz) once per interval, else None."""
+        if self._start is None or now - self._start < self.interval:
+            return None
+        achieved = self._frames / (now - self._start)
+        capacity = self._frames / self._busy if self._busy > 0 else 0.0
+        self._start = now
+        self._frames = 0
+        self._busy = 0.0
+        return achieved, capacity
+
+
+class StageBudget:
+    """
+    Priority and running cost estimate of the stages of a frame. Each frame has a
+    deadline; a stage that is not critical runs only if its estimated cost (with a
+    margin that grows as the priority drops) still fits before it, so the critical
+    force output stays on time when the CPU is contended.
+
+    A skipped stage is never measured, so its estimate decays on every skip and the
+    stage is run anyway after `max_skips` skips in a row; one stall cannot starve it.
+    """
+
+    def __init__(self, stages, smoothing=0.1, skip_decay=0.9, max_skips=50):
+        """
+        Args:
+            stages (dict): Stage name -> (priority, initial cost estimate in seconds).
+            smoothing (float): Weight of a new measurement in the cost estimate.
+            skip_decay (float): Factor applied to the cost estimate of a skipped stage.
+            max_skips (int): Consecutive skips after which a stage runs regardless of the deadline.
+        """
+        self.smoothing = smoothing
+        self.skip_decay = skip_decay
+        self.max_skips = max_skips
+        self.priority = {name: priority for name, (priority, _) in stages.items()}
+        self.cost = {name: cost for name, (_, cost) in stages.items()}
+        self.runs = dict.fromkeys(stages, 0)
+        self.skipped = dict.fromkeys(stages, 0)
+        self._skip_streak = dict.fromkeys(stages, 0)
+
+    def admit(self, name, deadline):
+        """True if stage `name` should run before `deadline` (perf_counter seconds, None = no limit)."""
+        priority = self.priority[name]
+        if deadline is None or priority == STAGE_CRITICAL:
+            return True
+        if time.perf_counter() + self.cost[name] * _STAGE_MARGIN[priority] <= deadline:
+            return True
+        if self._skip_streak[name] >= self.max_skips:
+            return True
+        self.skipped[name] += 1
+        self._skip_streak[name] += 1
+        self.cost[name] *= self.skip_decay
+        return False
+
+    def measured(self, name, seconds):
+        """Adds a measured run of stage `name` to its cost estimate."""
+        self.runs[name] += 1
+        self._skip_streak[name] = 0
+        self.cost[name] += (seconds - self.cost[name]) * self.smoothing
+
+    def run(self, name, deadline, skipped_result, function, *args):
+        """Runs `function(*args)` as stage `name` if admitted, else returns `skipped_result`."""
+        if not self.admit(name, deadline):
+            return skipped_result
+        start = time.perf_counter()
+        result = function(*args)
+        self.measured(name, time.perf_counter() - start)
+        return result
+
+    def get_stats(self):
+        """Per stage: runs, skipped runs and the cost estimate in microseconds."""
+        return {name: {'runs': self.runs[name], 'skipped': self.skipped[name],
+                       'cost_us': round(self.cost[name] * 1e6, 1)} for name in self.priority}
+
+
+if __name__ == '__main__':
+    logging.basicConfig(level=logging.INFO)
+
+    def measure(label):
+        histogram = JitterHistogram()
+        for _ in range(500):
+            histogram.tick(time.perf_counter())
+            time.sleep(0.002)
+        print(histogram.format(label))
+
+    measure("Default scheduling")
+    apply_thread_scheduling("demo", priority='realtime', cpus=[0])
+    measure("Requested realtime on CPU 0")
@@ -0,0 +1,407 @@
+#
+# This program is largely based on the TelemFFB distribution (https://github.com/walmis/TelemFFB).
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, version 3.
+#
+# This program is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+# General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <http://www.gnu.org/licenses/>.
+#
+
+"""
+Telemetry Archive Module
+
+A compressed columnar file format for long telemetry recordings. Frames are
+written incrementally from the live stream in chunks; each chunk stores every
+channel as a column, compressed losslessly:
+
+  - 'xor': Gorilla-style float compression. Each value is XORed with the previous
+    one and only the bytes between the leading and trailing zero bytes are kept,
+    with a control byte per value (leading zero bytes << 4 | kept bytes).
+  - 'decN': for values that are exact decimals with N places (most sim channels
+    are sent with a fixed precision), the scaled integers are delta coded,
+    zigzagged and byte-trimmed the same way.
+
+The smaller of the two is used per column and chunk. Both are byte aligned, so
+encoding and decoding are vectorized numpy operations rather than bit loops.
+Arrays are stored as one column per element, text channels run-length coded.
+
+Layout:
+    b"FSFFBARC1\\n"
+    chunk*:  b"CHNK" uint32 header length, JSON header, column data
+    footer:  b"INDX" JSON index of all chunk headers, uint64 index length, b"FSFAEND\\n"
+
+The index holds each chunk's time range and column offsets. A reader maps the
+file and decodes only the chunks and columns it is asked for, straight from the
+mapping. A file without footer (recording interrupted) is indexed by scanning
+the chunk headers instead.
+
+    python main.py --archive flight.fsfa                                   # live, X-Plane
+    python -m fsffb.telemetry.archive convert flight.rec flight.fsfa       # from main.py --record
+    python -m fsffb.telemetry.archive flight.fsfa                          # summary
+
+    with ArchiveReader('flight.fsfa') as archive:
+        times, aoa = archive.read('AoA', 120.0, 180.0)
+"""
+
+import os
+import json
+import mmap
+import time
+import struct
+import logging
+
+import numpy as np
+
+ARCHIVE_MAGIC = b"FSFFBARC1\n"
+ARCHIVE_END = b"FSFAEND\n"
+TIME_COLUMN = '__time__'
+_CHUNK_TAG = b"CHNK"
+_INDEX_TAG = b"INDX"
+_U32 = struct.Struct('<I')
+_U64 = struct.Struct('<Q')
+_COLUMNS = np.arange(8)
+
+
+def _trim_encode(words):
+    """Byte-trims uint64 words: returns (control bytes, payload bytes)."""
+    data = words.astype('>u8').view(np.uint8).reshape(-1, 8)
+    nonzero = data != 0
+    any_nonzero = nonzero.any(axis=1)
+    leading = np.where(any_nonzero, nonzero.argmax(axis=1), 8)
+    trailing = np.where(any_nonzero, nonzero[:, ::-1].argmax(axis=1), 0)
+    kept = 8 - leading - trailing
+    mask = (_COLUMNS >= leading[:, None]) & (_COLUMNS < (leading + kept)[:, None])
+    control = ((leading << 4) | kept).astype(np.uint8)
+    return control.tobytes(), data[mask].tobytes()
+
+
+def _trim_decode(control, payload):
+    """Inverse of _trim_encode, `control` and `payload` are uint8 arrays."""
+    leading = (control >> 4).astype(np.int64)
+    kept = (control & 0x0F).astype(np.int64)
+    mask = (_COLUMNS >= leading[:, None]) & (_COLUMNS < (leading + kept)[:, None])
+    data = np.zeros((len(control), 8), dtype=np.uint8)
+    data[mask] = payload
+    return data.view('>u8').ravel().astype(np.uint64)
+
+
+def _decimal_places(values, max_places=6):
+    """Smallest number of decimal places the values are exact at, or None."""
+    if not np.all(np.isfinite(values)) or np.any(np.abs(values) > 1e12):
+        return None
+    for places in range(max_places + 1):
+        scale = 10.0 ** places
+        if np.array_equal(np.round(values * scale) / scale, values):
+            return places
+    return None
+
+
+def encode_column(values):
+    """Compresses a float64 column, returns (encoding, control bytes, payload bytes)."""
+    values = np.ascontiguousarray(values, dtype=np.float64)
+    words = values.view(np.uint64)
+    xor = words ^ np.concatenate(([np.uint64(0)], words[:-1]))
+    best = ('xor',) + _trim_encode(xor)
+
+    places = _decimal_places(values)
+    if places is not None:
+        integers = np.round(values * 10.0 ** places).astype(np.int64)
+        deltas = np.diff(integers, prepend=np.int64(0))
+        zigzag = ((deltas << 1) ^ (deltas >> 63)).astype(np.uint64)
+        candidate = (f'dec{places}',) + _trim_encode(zigzag)
+        if len(candidate[2]) < len(best[2]):
+            best = candidate
+    return best
+
+
+def decode_column(encoding, control, payload):
+    """Decompresses a column from uint8 arrays, returns float64 values."""
+    words = _trim_decode(control, payload)
+    if encoding == 'xor':
+        return np.bitwise_xor.accumulate(words).view(np.float64)
+    places = int(encoding[3:])
+    deltas = (words >> np.uint64(1)).astype(np.int64) ^ -(words & np.uint64(1)).astype(np.int64)
+    return np.cumsum(deltas) / 10.0 ** places
+
+
+class ArchiveWriter:
+    """Writes telemetry frames to an archive, one chunk every `chunk_frames` frames."""
+
+    def __init__(self, path, chunk_frames=1024):
+        self.path = path
+        self.chunk_frames = chunk_frames
+        self._file = open(path, 'wb')
+        self._file.write(ARCHIVE_MAGIC)
+        self._index = []
+        self._times = []
+        self._frames = []
+        self.frames = 0
+        self._start = time.perf_counter()
+        logging.info(f"Archiving telemetry to {path}")
+
+    def append(self, frame, receive_time=None):
+        """
+        Adds one telemetry frame (dict of numbers, lists of numbers and text).
+
+        Args:
+            frame (dict): The telemetry of the frame.
+            receive_time (float): Seconds since the start of the recording, default now.
+        """
+        if self._file is None:
+            return
+        if receive_time is None:
+            receive_time = time.perf_counter() - self._start
+        self._times.append(receive_time)
+        self._frames.append(frame)
+        self.frames += 1
+        if len(self._frames) >= self.chunk_frames:
+            self.flush()
+
+    def flush(self):
+        """Writes the buffered frames as a chunk."""
+        if not self._frames or self._file is None:
+            return
+        count = len(self._frames)
+        numeric = {}
+        text = {}
+        for i, frame in enumerate(self._frames):
+            for key, value in frame.items():
+                if isinstance(value, str):
+                    text.setdefault(key, [None] * count)[i] = value
+                else:
+                    numeric.setdefault(key, {})[i] = value
+
+        blocks = []
+        columns = {}
+        offset = 0
+
+        def add_block(values):
+            nonlocal offset
+            encoding, control, payload = encode_column(values)
+            blocks.extend((control, payload))
+            block = [encoding, offset, len(payload)]
+            offset += len(control) + len(payload)
+            return block
+
+        columns[TIME_COLUMN] = [add_block(np.array(self._times, dtype=np.float64))]
+        for key, samples in numeric.items():
+            width = max(len(v) if isinstance(v, (list, tuple)) else 1 for v in samples.values())
+            array = np.full((count, width), np.nan)
+            for i, value in samples.items():
+                if isinstance(value, (list, tuple)):
+                    array[i, :len(value)] = value
+                else:
+                    array[i, 0] = value
+            columns[key] = [add_block(array[:, element]) for element in range(width)]
+            if width > 1 or any(isinstance(v, (list, tuple)) for v in samples.values()):
+                columns[key].insert(0, 'array')
+
+        runs = {}
+        for key, values in text.items():
+            run = []
+            for value in values:
+                if run and run[-1][0] == value:
+                    run[-1][1] += 1
+                else:
+                    run.append([value, 1])
+            runs[key] = run
+
+        header = {'t0': self._times[0], 't1': self._times[-1], 'n': count, 'columns': columns, 'text': runs}
+        header_bytes = json.dumps(header, separators=(',', ':')).encode('utf-8')
+        self._file.write(_CHUNK_TAG + _U32.pack(len(header_bytes)) + header_bytes)
+        header['base'] = self._file.tell()
+        for block in blocks:
+            self._file.write(block)
+        self._file.flush()
+        self._index.append(header)
+        self._times = []
+        self._frames = []
+
+    def close(self):
+        """Writes the last chunk and the index."""
+        if self._file is None:
+            return
+        self.flush()
+        index = json.dumps(self._index, separators=(',', ':')).encode('utf-8')
+        self._file.write(_INDEX_TAG + index + _U64.pack(len(index)) + ARCHIVE_END)
+        self._file.close()
+        self._file = None
+        logging.info(f"Telemetry archive {self.path} closed, {self.frames} frames")
+
+
+class ArchiveReader:
+    """Reads channels of an archive by time range, decoding only the chunks needed."""
+
+    def __init__(self, path):
+        self.path = path
+        self._file = open(path, 'rb')
+        self._map = mmap.mmap(self._file.fileno(), 0, access=mmap.ACCESS_READ)
+        if self._map[:len(ARCHIVE_MAGIC)] != ARCHIVE_MAGIC:
+            self.close()
+            raise ValueError(f"{path} is not a telemetry archive")
+        self.chunks = self._read_index()
+        self._t0 = np.array([chunk['t0'] for chunk in self.chunks])
+        self._t1 = np.array([chunk['t1'] for chunk in self.chunks])
+
+    def _read_index(self):
+        size = len(self._map)
+        tail = len(ARCHIVE_END) + _U64.size
+        if size >= len(ARCHIVE_MAGIC) + tail and self._map[size - len(ARCHIVE_END):] == ARCHIVE_END:
+            length = _U64.unpack_from(self._map, size - tail)[0]
+            start = size - tail - length
+            return json.loads(self._map[start:start + length].decode('utf-8'))
+
+        # No footer: the recording was interrupted, walk the chunk headers
+        logging.warning(f"{self.path} has no index, scanning chunks")
+        chunks = []
+        position = len(ARCHIVE_MAGIC)
+        while position + 8 <= size and self._map[position:position + 4] == _CHUNK_TAG:
+            length = _U32.unpack_from(self._map, position + 4)[0]
+            if position + 8 + length > size:
+                break  # Header cut short
+            header = json.loads(self._map[position + 8:position + 8 + length].decode('utf-8'))
+            header['base'] = position + 8 + length
+            data_length = sum(header['n'] + block[2] for blocks in header['columns'].values()
+                              for block in blocks if block != 'array')
+            if header['base'] + data_length > size:
+                break  # Chunk cut short
+            chunks.append(header)
+            position = header['base'] + data_length
+        return chunks
+
+    @property
+    def channels(self):
+        names = set()
+        for chunk in self.chunks:
+            names.update(chunk['columns'])
+            names.update(chunk['text'])
+        names.discard(TIME_COLUMN)
+        return sorted(names)
+
+    @property
+    def time_range(self):
+        if not self.chunks:
+            return None
+        return float(self._t0.min()), float(self._t1.max())
+
+    def _chunks_in(self, t0, t1):
+        selected = np.ones(len(self.chunks), dtype=bool)
+        if t0 is not None:
+            selected &= self._t1 >= t0
+        if t1 is not None:
+            selected &= self._t0 <= t1
+        return [self.chunks[i] for i in np.nonzero(selected)[0]]
+
+    def _decode(self, chunk, block):
+        encoding, offset, payload_length = block
+        count = chunk['n']
+        start = chunk['base'] + offset
+        control = np.frombuffer(self._map, dtype=np.uint8, count=count, offset=start)
+        payload = np.frombuffer(self._map, dtype=np.uint8, count=payload_length, offset=start + count)
+        return decode_column(encoding, control, payload)
+
+    def read(self, channel, t0=None, t1=None):
+        """
+        Returns (times, values) of a channel between t0 and t1 (seconds, inclusive).
+        Values are float64, (n, width) for arrays; frames without the channel are NaN.
+        Text channels return a list of strings (None where absent).
+        """
+        times, values = [], []
+        is_text = False
+        for chunk in self._chunks_in(t0, t1):
+            chunk_times = self._decode(chunk, chunk['columns'][TIME_COLUMN][0])
+            if channel in chunk['text']:
+                is_text = True
+                expanded = []
+                for value, count in chunk['text'][channel]:
+                    expanded.extend([value] * count)
+                chunk_values = expanded
+            elif channel in chunk['columns']:
+                blocks = chunk['columns'][channel]
+                if blocks[0] == 'array':
+                    chunk_values = np.column_stack([self._decode(chunk, block) for block in blocks[1:]])
+                else:
+                    chunk_values = self._decode(chunk, blocks[0])
+            else:
+                chunk_values = None
+
+            keep = np.ones(len(chunk_times), dtype=bool)
+            if t0 is not None:
+                keep &= chunk_times >= t0
+            if t1 is not None:
+                keep &= chunk_times <= t1
+            times.append(chunk_times[keep])
+            if chunk_values is None:
+                values.append((None, int(keep.sum())))
+            elif isinstance(chunk_values, list):
+                values.append([v for v, k in zip(chunk_values, keep) if k])
+            else:
+                values.append(chunk_values[keep])
+
+        times = np.concatenate(times) if times else np.array([])
+        if is_text:
+            flat = []
+            for part in values:
+                flat.extend([None] * part[1] if isinstance(part, tuple) else part)
+            return times, flat
+        width = max((part.shape[1] for part in values if not isinstance(part, tuple) and part.ndim == 2), default=None)
+        arrays = []
+        for part in values:
+            if isinstance(part, tuple):
+                arrays.append(np.full((part[1], width) if width else part[1], np.nan))
+            elif width and part.ndim == 1:
+                arrays.append(np.column_stack([part] + [np.full(len(part), np.nan)] * (width - 1)))
+            elif width and part.shape[1] < width:
+                arrays.append(np.pad(part, ((0, 0), (0, width - part.shape[1])), constant_values=np.nan))
+            else:
+                arrays.append(part)
+        return times, (np.concatenate(arrays) if arrays else np.array([]))
+
+    def close(self):
+        if self._map is not None:
+            self._map.close()
+            self._map = None
+        if self._file is not None:
+            self._file.close()
+            self._file = None
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+
+def convert_recording(recording_path, archive_path, chunk_frames=1024):
+    """Converts a raw datagram recording (recording.py) into an archive."""
+    from fsffb.telemetry.recording import read_frames
+    writer = ArchiveWriter(archive_path, chunk_frames)
+    for receive_time, frame in read_frames(recording_path):
+        writer.append(frame, receive_time)
+    writer.close()
+    return writer.frames
+
+
+if __name__ == '__main__':
+    import sys
+
+    if len(sys.argv) >= 4 and sys.argv[1] == 'convert':
+        frames = convert_recording(sys.argv[2], sys.argv[3])
+        source, target = os.path.getsize(sys.argv[2]), os.path.getsize(sys.argv[3])
+        print(f"{frames} frames: {source} bytes recorded -> {target} bytes archived ({target / max(source, 1):.1%})")
+    elif len(sys.argv) >= 2:
+        with ArchiveReader(sys.argv[1]) as reader:
+            print(f"{len(reader.chunks)} chunks, {sum(c['n'] for c in reader.chunks)} frames, "
+                  f"time range {reader.time_range}")
+            for channel in reader.channels:
+                times, values = reader.read(channel)
+                print(f"  {channel}: {len(times)} samples" + ("" if isinstance(values, list) else f", shape {values.shape}"))
+    else:
+        print("Usage: archive.py <archive> | archive.py convert <recording> <archive>")
@@ -22,7 +22,8 @@ It manages communication with MSFS via SimConnect to retrieve aircraft telemetry
 """
 
 from SimConnect import *
-from ctypes import byref, cast, sizeof
+from ctypes import byref, addressof, c_char
+from fsffb.telemetry.simconnect_layout import SimConnectLayout
 import time
 import threading
 import logging
@@ -137,6 +138,7 @@ class MSFSManager(threading.Thread):
         self.req_id = os.getpid()
         self.def_id = os.getpid()
         self.sv_dict = {}
+        self.layout = None
         self.connected_version = None
         self.sim_vars = self._get_default_simvars()
 
@@ -275,6 +277,8 @@ class MSFSManager(threading.Thread):
                 self.subscribed_vars.append(sv)
                 i += 1
         self.current_var_tracker = self.new_var_tracker
+        # Packets are decoded with a layout compiled once per data definition
+        self.layout = SimConnectLayout(self.subscribed_vars, tagged=True)
 
         self.sc.RequestDataOnSimObject(
             self.req_id, self.def_id, OBJECT_ID_USER,
@@ -355,7 +359,7 @@ class MSFSManager(threading.Thread):
             elif isinstance(recv, RECV_EVENT):
                 self._handle_event(recv)
             elif isinstance(recv, RECV_SIMOBJECT_DATA):
-                self._handle_simobject_data(recv)
+                self._handle_simobject_data(recv, nSize.value)
             else:
                 logging.warning(f"Received unknown simconnect message: {recv}")
 
@@ -379,34 +383,18 @@ class MSFSManager(threading.Thread):
             data = getattr(recv, data_attr) if data_attr else None
             self.event_callback(event_name, data)
 
-    def _handle_simobject_data(self, recv):
+    def _handle_simobject_data(self, recv, size):
         """Handle telemetry data packets from SimConnect."""
-        if recv.dwRequestID != self.req_id or recv.dwDefineID != self.def_id:
+        if recv.dwRequestID != self.req_id or recv.dwDefineID != self.def_id or self.layout is None:
             return
 
         data = {"SimPaused": self._sim_paused}
-        offset = RECV_SIMOBJECT_DATA.dwData.offset
-        for _ in range(recv.dwDefineCount):
-            try:
-                idx = cast(byref(recv, offset), POINTER(DWORD))[0]
-                offset += sizeof(DWORD)
-                var: SimVar = self.subscribed_vars[idx]
-                c_type = var.c_type
-                if var.datatype == DATATYPE_STRING128:
-                    val = str(cast(byref(recv, offset), POINTER(c_type))[0].value, "utf-8")
-                else:
-                    val = cast(byref(recv, offset), POINTER(c_type))[0]
-                offset += sizeof(c_type)
-                val = var._calculate(val)
-
-                if var.parent:
-                    var.parent.values[var.index] = val
-                    data[var.parent.name] = var.parent.values
-                else:
-                    data[var.name] = val
-            except (IndexError, AttributeError) as e:
-                logging.error(f"Error parsing SimConnect data: {e}")
-                continue
+        packet = (c_char * size).from_address(addressof(recv))
+        try:
+            data.update(self.layout.decode(packet, recv.dwDefineCount, RECV_SIMOBJECT_DATA.dwData.offset))
+        except (ValueError, UnicodeDecodeError) as e:
+            logging.error(f"Error parsing SimConnect data: {e}")
+            return
 
         in_menus = data.get('CameraState', 0) not in (2, 3, 4, 5)
         is_stopped = self._sim_paused or data.get("Parked", 0) or data.get("Slew", 0) or in_menus
@@ -0,0 +1,156 @@
+#
+# This program is largely based on the TelemFFB distribution (https://github.com/walmis/TelemFFB).
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, version 3.
+#
+# This program is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+# General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <http://www.gnu.org/licenses/>.
+#
+
+"""
+Telemetry Recording Module
+
+Records the raw telemetry datagrams received from the sim to a file so flights
+can be replayed offline, e.g. to benchmark telemetry prediction or tune effects
+without the sim running.
+
+File format: the header b"FSFFBREC1\\n", then one record per datagram: a
+little-endian double receive time (seconds since the recording started), a
+uint32 payload length and the payload bytes as received.
+"""
+
+import struct
+import time
+import logging
+
+RECORDING_MAGIC = b"FSFFBREC1\n"
+_RECORD_HEADER = struct.Struct('<dI')
+
+
+class TelemetryRecorder:
+    """Appends raw telemetry datagrams to a recording file."""
+
+    def __init__(self, path):
+        self.path = path
+        self._file = open(path, 'wb')
+        self._file.write(RECORDING_MAGIC)
+        self._start = time.perf_counter()
+        self.records = 0
+        logging.info(f"Recording telemetry to {path}")
+
+    def write(self, data):
+        """Writes one datagram (bytes) with the current receive time."""
+        if self._file is None:
+            return
+        self._file.write(_RECORD_HEADER.pack(time.perf_counter() - self._start, len(data)))
+        self._file.write(data)
+        self.records += 1
+
+    def close(self):
+        """Flushes and closes the recording."""
+        if self._file is not None:
+            self._file.close()
+            self._file = None
+            logging.info(f"Telemetry recording {self.path} closed, {self.records} datagrams")
+
+
+def read_recording(path):
+    """
+    Iterates over the datagrams of a recording.
+
+    Yields:
+        tuple: (receive_time, data_string) for every record. A record cut short
+               (recording not closed cleanly) ends the iteration.
+    """
+    with open(path, 'rb') as f:
+        if f.read(len(RECORDING_MAGIC)) != RECORDING_MAGIC:
+            raise ValueError(f"{path} is not a telemetry recording")
+        while True:
+            header = f.read(_RECORD_HEADER.size)
+            if len(header) < _RECORD_HEADER.size:
+                return
+            receive_time, length = _RECORD_HEADER.unpack(header)
+            data = f.read(length)
+            if len(data) < length:
+                return
+            yield receive_time, data.decode('utf-8', errors='replace')
+
+
+def parse_frame(data_string):
+    """
+    Parses a telemetry datagram ("key=value;" pairs, arrays joined by "~") into a dict.
+    Values that are not numbers are kept as text. Plugin replies ("TYPE:...") return None.
+    """
+    if ':' in data_string.split(';', 1)[0].split('=', 1)[0]:
+        return None
+    frame = {}
+    for pair in data_string.strip(';').split(';'):
+        if '=' not in pair:
+            continue
+        key, value = pair.split('=', 1)
+        try:
+            if '~' in value:
+                frame[key] = [float(v) for v in value.split('~')]
+            else:
+                frame[key] = float(value)
+        except ValueError:
+            frame[key] = value
+    return frame
+
+
+def read_frames(path):
+    """
+    Iterates over the telemetry frames of a recording, skipping plugin replies and
+    joining fragmented frames ("Frag=i/n") back together.
+
+    Yields:
+        tuple: (receive_time, frame dict) of complete frames.
+    """
+    pending = None
+    pending_seq = None
+    for receive_time, data_string in read_recording(path):
+        frame = parse_frame(data_string)
+        if frame is None:
+            continue
+        fragment = frame.pop('Frag', None)
+        if fragment is None:
+            yield receive_time, frame
+            continue
+        index, count = (int(part) for part in str(fragment).split('/'))
+        if index == 1 or frame.get('Seq') != pending_seq:
+            pending = {}
+            pending_seq = frame.get('Seq')
+        pending.update(frame)
+        if index == count:
+            yield receive_time, pending
+            pending = None
+            pending_seq = None
+
+
+if __name__ == '__main__':
+    import sys
+
+    if len(sys.argv) < 2:
+        print("Usage: recording.py <recording>")
+        sys.exit(1)
+
+    count = 0
+    keys = set()
+    first = last = None
+    for receive_time, frame in read_frames(sys.argv[1]):
+        count += 1
+        keys.update(frame.keys())
+        first = receive_time if first is None else first
+        last = receive_time
+    if count:
+        print(f"{count} frames over {last - first:.1f} s")
+        print("Channels: " + ", ".join(sorted(keys)))
+    else:
+        print("No telemetry frames")
@@ -0,0 +1,255 @@
+#
+# This program is largely based on the TelemFFB distribution (https://github.com/walmis/TelemFFB).
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, version 3.
+#
+# This program is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+# General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <http://www.gnu.org/licenses/>.
+#
+
+"""
+SimConnect Layout Module
+
+Decodes SimConnect SIMOBJECT_DATA payloads with a layout computed once per
+subscription instead of walking the packet datum by datum.
+
+The layout compiles the data definition into a single struct.Struct, so a packet
+holding every datum decodes in one unpack_from() call. Numeric values are then
+scaled as one numpy vector and split back into scalars and array channels by
+precomputed index maps. Only mutators and strings are handled per value.
+
+Tagged packets ("datum id, value" pairs) that do not hold the full definition in
+order, e.g. when SimConnect only sends changed values, fall back to a per-datum
+walk with precompiled per-type structs.
+
+The module has no SimConnect dependency so it can be tested with synthetic
+buffers (tests/test_simconnect_layout.py checks it against the ctypes loop it
+replaces); run it directly to benchmark both.
+"""
+
+import struct
+import operator
+
+import numpy as np
+
+# struct codes by SIMCONNECT_DATATYPE value (INT32=1, FLOAT32=3, FLOAT64=4,
+# STRING32=6, STRING128=8). Other types are read as FLOAT64, like SimVar.c_type.
+_FORMATS = {1: 'i', 3: 'f', 4: 'd', 6: '32s', 8: '128s'}
+_TAG = struct.Struct('<I')
+
+
+def _format(datatype):
+    return _FORMATS.get(int(datatype), 'd')
+
+
+class SimConnectLayout:
+    """
+    Precomputed decoder for one SimConnect data definition.
+
+    Args:
+        simvars (list): The SimVar objects in data definition order (datum id = index).
+                        SimVars with a parent are elements of that SimVarArray.
+        tagged (bool): True for DATA_REQUEST_FLAG_TAGGED packets.
+    """
+
+    def __init__(self, simvars, tagged=True):
+        self.simvars = list(simvars)
+        self.tagged = tagged
+        formats = [_format(sv.datatype) for sv in self.simvars]
+        self._datum_structs = [struct.Struct('<' + f) for f in formats]
+        fields = ''.join(('I' + f) if tagged else f for f in formats)
+        self._struct = struct.Struct('<' + fields)
+        self.size = self._struct.size
+        self._expected_tags = tuple(range(len(self.simvars)))
+
+        # Values not touched by numpy: unscaled integers keep their type, strings are decoded,
+        # mutated datums go through SimVar._calculate (mutator before scale)
+        scaled, plain, strings, mutated = [], [], [], []
+        for i, (sv, f) in enumerate(zip(self.simvars, formats)):
+            if f.endswith('s'):
+                strings.append(i)
+            elif sv.mutator:
+                mutated.append(i)
+            elif f == 'i' and not sv.scale:
+                plain.append(i)
+            else:
+                scaled.append(i)
+        self._scaled = scaled
+        self._strings = strings
+        self._get_scaled = operator.itemgetter(*scaled) if len(scaled) > 1 else None
+        self._scales = np.array([self.simvars[i].scale or 1.0 for i in scaled])
+        self._mutated = mutated
+
+        # Output slots: scalars by name, arrays as (name, [(element index, datum)...])
+        self._scalars = []
+        arrays = {}
+        for i, sv in enumerate(self.simvars):
+            if sv.parent is not None:
+                arrays.setdefault(sv.parent.name, (sv.parent, []))[1].append((sv.index, i))
+            else:
+                self._scalars.append((sv.name, i))
+        self._arrays = [(name, len(parent.vars), elements) for name, (parent, elements) in arrays.items()]
+        # Last values of every array, so a partial packet keeps the elements it does not carry
+        self._array_values = {name: [0] * length for name, length, _ in self._arrays}
+
+    def decode(self, buffer, count, offset=0):
+        """
+        Decodes one packet.
+
+        Args:
+            buffer: Any buffer (bytes, memoryview, ctypes array) holding the dwData payload.
+            count (int): dwDefineCount of the packet.
+            offset (int): Byte offset of dwData in `buffer`.
+
+        Returns:
+            dict: Telemetry values by name, arrays as lists.
+        """
+        if count == len(self.simvars) and len(buffer) - offset >= self.size:
+            raw = self._struct.unpack_from(buffer, offset)
+            if not self.tagged:
+                return self._finish(list(raw))
+            if raw[0::2] == self._expected_tags:
+                return self._finish(list(raw[1::2]))
+        if not self.tagged:
+            return {}  # Untagged packets always carry the full definition
+        return self._decode_tagged(buffer, count, offset)
+
+    def _finish(self, values):
+        """Scales, mutates and maps a complete list of raw datum values."""
+        if self._get_scaled:
+            scaled = (np.fromiter(self._get_scaled(values), float, len(self._scaled)) * self._scales).tolist()
+            for i, value in zip(self._scaled, scaled):
+                values[i] = value
+        elif self._scaled:
+            i = self._scaled[0]
+            values[i] = values[i] * float(self._scales[0])
+        for i in self._strings:
+            values[i] = self.simvars[i]._calculate(values[i].split(b'\0', 1)[0].decode('utf-8'))
+        for i in self._mutated:
+            values[i] = self.simvars[i]._calculate(values[i])
+
+        data = {name: values[i] for name, i in self._scalars}
+        for name, length, elements in self._arrays:
+            array = [0] * length
+            for element, i in elements:
+                array[element] = values[i]
+            self._array_values[name] = array
+            data[name] = array
+        return data
+
+    def _decode_tagged(self, buffer, count, offset):
+        """Per-datum walk for tagged packets that do not match the full layout."""
+        data = {}
+        arrays = {}
+        end = len(buffer)
+        for _ in range(count):
+            if offset + _TAG.size > end:
+                break
+            index = _TAG.unpack_from(buffer, offset)[0]
+            offset += _TAG.size
+            if index >= len(self.simvars):
+                break  # Unknown datum, the rest of the packet cannot be located
+            sv = self.simvars[index]
+            datum = self._datum_structs[index]
+            if offset + datum.size > end:
+                break
+            value = datum.unpack_from(buffer, offset)[0]
+            offset += datum.size
+            if isinstance(value, bytes):
+                value = value.split(b'\0', 1)[0].decode('utf-8')
+            value = sv._calculate(value)
+            if sv.parent is not None:
+                name = sv.parent.name
+                if name not in arrays:
+                    arrays[name] = list(self._array_values[name])
+                arrays[name][sv.index] = value
+            else:
+                data[sv.name] = value
+        for name, array in arrays.items():
+            self._array_values[name] = array
+            data[name] = array
+        return data
+
+
+if __name__ == '__main__':
+    # Benchmark against the ctypes loop MSFSManager used before, on synthetic packets
+    import ctypes
+    import timeit
+
+    class _SimVar:
+        def __init__(self, name, datatype, scale=None, mutator=None, parent=None, index=None):
+            self.name, self.datatype, self.scale, self.mutator = name, datatype, scale, mutator
+            self.parent, self.index = parent, index
+
+        def _calculate(self, value):
+            if self.mutator:
+                value = self.mutator(value)
+            if self.scale:
+                value = value * self.scale
+            return value
+
+    class _Array:
+        def __init__(self, name, count, scale=None):
+            self.name = name
+            self.vars = [_SimVar(name, 4, scale, parent=self, index=i) for i in range(count)]
+            self.values = [0] * count
+
+    simvars = [_SimVar('T', 4), _SimVar('N', 8), _SimVar('G', 4)]
+    for array in (_Array('VelRotBody', 3), _Array('AccBody', 3, scale=0.031081), _Array('PropThrust', 4)):
+        simvars.extend(array.vars)
+    simvars += [_SimVar(f'Var{i}', 4) for i in range(30)]
+    simvars += [_SimVar('SimOnGround', 1), _SimVar('CameraState', 1),
+                _SimVar('SurfaceType', 1, mutator=lambda x: {0: 'Concrete', 4: 'Asphalt'}.get(x, 'unknown'))]
+
+    c_types = {1: ctypes.c_int32, 3: ctypes.c_float, 4: ctypes.c_double, 8: ctypes.c_char * 128}
+
+    def make_packet(values):
+        data = b''
+        for i, (sv, value) in enumerate(zip(simvars, values)):
+            data += struct.pack('<I', i) + struct.pack('<' + _format(sv.datatype), value)
+        return (ctypes.c_char * len(data)).from_buffer_copy(data)
+
+    def decode_loop(packet, count):
+        """The previous MSFSManager._handle_simobject_data loop."""
+        data = {}
+        offset = 0
+        for _ in range(count):
+            idx = ctypes.cast(ctypes.byref(packet, offset), ctypes.POINTER(ctypes.c_uint32))[0]
+            offset += 4
+            var = simvars[idx]
+            c_type = c_types[var.datatype]
+            if var.datatype == 8:
+                val = str(ctypes.cast(ctypes.byref(packet, offset), ctypes.POINTER(c_type))[0].value, "utf-8")
+            else:
+                val = ctypes.cast(ctypes.byref(packet, offset), ctypes.POINTER(c_type))[0]
+            offset += ctypes.sizeof(c_type)
+            val = var._calculate(val)
+            if var.parent:
+                var.parent.values[var.index] = val
+                data[var.parent.name] = list(var.parent.values)
+            else:
+                data[var.name] = val
+        return data
+
+    values = [12.5, b'Cessna 172'] + [float(i) * 0.5 for i in range(2, len(simvars) - 3)] + [1, 2, 4]
+    packet = make_packet(values)
+    layout = SimConnectLayout(simvars)
+
+    # Partial tagged packet: G and one AccBody element only
+    partial = struct.pack('<Id', 2, 3.0) + struct.pack('<Id', 7, 9.81)
+
+    print(f"{len(simvars)} datums, {layout.size} bytes per packet")
+    runs = 20000
+    loop_us = timeit.timeit(lambda: decode_loop(packet, len(simvars)), number=runs) / runs * 1e6
+    layout_us = timeit.timeit(lambda: layout.decode(packet, len(simvars)), number=runs) / runs * 1e6
+    partial_us = timeit.timeit(lambda: layout.decode(partial, 2), number=runs) / runs * 1e6
+    print(f"ctypes loop:    {loop_us:8.2f} us/packet")
+    print(f"layout:         {layout_us:8.2f} us/packet ({loop_us / layout_us:.1f}x)")
+    print(f"layout partial: {partial_us:8.2f} us/packet (2 datums)")
@@ -25,18 +25,39 @@ and send control inputs.
 import socket
 import threading
 import logging
+import time
 from collections import deque
 
+from fsffb.telemetry.recording import TelemetryRecorder
+from fsffb.telemetry.archive import ArchiveWriter
+
+# Unanswered SUBSCRIBE / AXISDEF / QUERY commands are sent again after this long (seconds), a few times
+REQUEST_RETRY_INTERVAL = 1.0
+REQUEST_MAX_RETRIES = 3
+
+# Round trip time probe interval (seconds)
+PING_INTERVAL = 1.0
+
 class XPlaneManager(threading.Thread):
     """Manages communication with the X-Plane plugin."""
 
-    def __init__(self, telemetry_callback, event_callback):
+    # Plugin replies share the telemetry socket and are told apart by their "TYPE:" prefix
+    REPLY_PREFIXES = ('SUBSCRIBED:', 'SUBSCRIBED_PATTERN:', 'THREAD:', 'PONG:', 'AXISDEFINED:', 'RESULT:')
+
+    def __init__(self, telemetry_callback, event_callback, sim_host=None, telemetry_port=34390, command_port=34391,
+                 record_path=None, archive_path=None):
         """
         Initializes the XPlaneManager.
 
         Args:
             telemetry_callback (callable): Function to call with new telemetry data.
             event_callback (callable): Function to call with system events.
+            sim_host (str): Host running X-Plane when the plugin is in remote mode
+                            (remote_host set in FSFFB_Config.txt). None for the local setup.
+            telemetry_port (int): Port to receive telemetry on (plugin telemetry_port).
+            command_port (int): Port the plugin receives commands on (plugin command_port).
+            record_path (str): File to record the received telemetry to (see recording.py), or None.
+            archive_path (str): File to archive the parsed telemetry frames to (see archive.py), or None.
         """
         threading.Thread.__init__(self, daemon=True)
         self.telemetry_callback = telemetry_callback
@@ -45,21 +66,57 @@ class XPlaneManager(threading.Thread):
         self.rx_socket = None
         self.tx_socket = None
         self.command_queue = deque()
+        # Resolved dataref schema reported by the plugin, keyed by telemetry tag
+        self.dataref_schema = {}
+
+        self.sim_host = sim_host
+        self.sim_address = None
+        self.telemetry_port = telemetry_port
+        self.command_port = command_port
+
+        # Link quality counters, see get_link_stats()
+        self.link_stats = {'frames': 0, 'lost_frames': 0, 'incomplete_frames': 0,
+                           'rejected_packets': 0, 'rtt_ms': None}
+        self._last_seq = None
+        self._fragments = {}            # Telemetry of the frame being reassembled
+        self._fragment_seq = None
+        self._fragment_count = 0
+        self._fragments_received = 0
+        self._pending_requests = {}  # dataref or axis name -> [command, last sent, retries]
+        # Axes defined in the plugin, name -> {'id': ..., 'targets': ...}
+        self.axes = {}
+        # Outstanding QUERY requests, id -> {'callback': ..., 'values': {...}, 'parts': set()}
+        self._queries = {}
+        self._query_id = 0
+        self._ping_id = 0
+        self._ping_sent = {}
+        self._last_ping = 0.0
+        self.recorder = TelemetryRecorder(record_path) if record_path else None
+        self.archive = ArchiveWriter(archive_path) if archive_path else None
 
         self._setup_sockets()
 
     def _setup_sockets(self):
         """Initializes the UDP sockets for receiving and sending data."""
         try:
+            if self.sim_host:
+                # Remote mode: telemetry is unicast to us, accept it from the sim host only
+                self.sim_address = socket.gethostbyname(self.sim_host)
+                bind_address = '0.0.0.0'
+            else:
+                self.sim_address = '127.0.0.1'
+                bind_address = '127.0.0.1'
+
             # RX Socket (Telemetry from X-Plane)
             self.rx_socket = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
-            self.rx_socket.bind(('127.0.0.1', 34390))
-            self.rx_socket.settimeout(1.0)
-            logging.info("X-Plane telemetry socket listening on port 34390.")
+            self.rx_socket.bind((bind_address, self.telemetry_port))
+            # Short timeout so queued commands, retries and pings go out without waiting for telemetry
+            self.rx_socket.settimeout(0.1)
+            logging.info(f"X-Plane telemetry socket listening on port {self.telemetry_port}.")
 
             # TX Socket (Commands to X-Plane)
             self.tx_socket = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
-            logging.info("X-Plane command socket ready to send on port 34391.")
+            logging.info(f"X-Plane command socket ready to send to {self.sim_address}:{self.command_port}.")
 
         except OSError as e:
             logging.error(f"Error setting up X-Plane sockets: {e}")
@@ -80,11 +137,27 @@ class XPlaneManager(threading.Thread):
                 command = self.command_queue.popleft()
                 self._send_command(command)
 
+            self._resend_pending_requests()
+            self._send_ping()
+
             # Receive incoming telemetry
             try:
-                data, _ = self.rx_socket.recvfrom(4096)
-                telemetry = self._parse_telemetry(data.decode('utf-8'))
+                data, address = self.rx_socket.recvfrom(65536)
+                if self.sim_host and address[0] != self.sim_address:
+                    self.link_stats['rejected_packets'] += 1
+                    continue
+                if self.recorder:
+                    self.recorder.write(data)
+                data_string = data.decode('utf-8')
+                if data_string.startswith(self.REPLY_PREFIXES):
+                    self._handle_reply(data_string)
+                    continue
+                telemetry = self._parse_telemetry(data_string)
+                if telemetry:
+                    telemetry = self._reassemble(telemetry)
                 if telemetry:
+                    if self.archive:
+                        self.archive.append(telemetry)
                     self.telemetry_callback(telemetry)
             except socket.timeout:
                 continue
@@ -107,6 +180,146 @@ class XPlaneManager(threading.Thread):
             logging.warning(f"Could not parse telemetry string: '{data_string}'. Error: {e}")
             return None
 
+    def _reassemble(self, telemetry):
+        """
+        Counts lost frames from the "Seq" field and reassembles fragmented frames.
+
+        Returns the complete frame, or None while fragments are still missing. A frame
+        with a lost fragment is dropped when the next frame starts.
+        """
+        seq = telemetry.get('Seq')
+        fragment = telemetry.pop('Frag', None)
+
+        if isinstance(seq, int) and seq != self._last_seq:
+            if self._last_seq is not None and seq > self._last_seq:
+                self.link_stats['lost_frames'] += seq - self._last_seq - 1
+            self._last_seq = seq
+            self.link_stats['frames'] += 1
+
+        if self._fragment_seq is not None and seq != self._fragment_seq:
+            if self._fragments_received < self._fragment_count:
+                self.link_stats['incomplete_frames'] += 1
+            self._fragment_seq = None
+
+        if fragment is None:
+            return telemetry
+
+        _, _, count = str(fragment).partition('/')
+        if seq != self._fragment_seq:
+            self._fragment_seq = seq
+            self._fragment_count = int(count)
+            self._fragments_received = 0
+            self._fragments = {}
+
+        self._fragments.update(telemetry)
+        self._fragments_received += 1
+        if self._fragments_received == self._fragment_count:
+            return self._fragments
+        return None
+
+    def _resend_pending_requests(self):
+        """Sends SUBSCRIBE / AXISDEF / QUERY commands again that the plugin has not answered yet."""
+        now = time.time()
+        for key, pending in list(self._pending_requests.items()):
+            command, sent, retries = pending
+            if now - sent < REQUEST_RETRY_INTERVAL:
+                continue
+            if retries >= REQUEST_MAX_RETRIES:
+                logging.warning(f"No reply from X-Plane for '{key}'")
+                del self._pending_requests[key]
+                if key.startswith('query:'):
+                    self._queries.pop(int(key[len('query:'):]), None)
+                continue
+            self._send_command(command)
+            self._pending_requests[key] = [command, now, retries + 1]
+
+    def _send_ping(self):
+        """Periodically sends a PING to measure the round trip time to the plugin."""
+        now = time.perf_counter()
+        if now - self._last_ping < PING_INTERVAL:
+            return
+        self._last_ping = now
+        self._ping_id += 1
+        self._ping_sent = {self._ping_id: now}  # Only the latest ping counts, older ones are lost
+        self._send_command(f"PING:id={self._ping_id}")
+
+    def get_link_stats(self):
+        """
+        Returns link quality counters: frames received, lost_frames (gaps in the
+        frame sequence), incomplete_frames (dropped for a missing fragment),
+        rejected_packets (from other hosts in remote mode) and rtt_ms (last
+        round trip time, None before the first PONG).
+        """
+        return dict(self.link_stats)
+
+    def _handle_reply(self, data_string):
+        """Handles a "TYPE:key=value,..." reply message from the plugin."""
+        reply_type, _, payload = data_string.partition(':')
+        fields = {}
+        for pair in payload.split(','):
+            if '=' in pair:
+                key, value = pair.split('=', 1)
+                fields[key] = self._convert_value(value)
+
+        if reply_type == 'SUBSCRIBED':
+            if fields.get('type') == 'none':
+                logging.warning(f"X-Plane could not subscribe to DataRef '{fields.get('dataref')}'")
+            else:
+                self.dataref_schema[fields.get('tag')] = fields
+                logging.info(f"Subscribed to DataRef '{fields.get('dataref')}' as {fields.get('type')} "
+                             f"(size {fields.get('size')}, tag '{fields.get('tag')}')")
+            self._pending_requests.pop(fields.get('dataref'), None)
+            self.event_callback("DataRefSubscribed", fields)
+        elif reply_type == 'SUBSCRIBED_PATTERN':
+            self._pending_requests.pop(fields.get('pattern'), None)
+            logging.info(f"DataRef pattern '{fields.get('pattern')}' matched {fields.get('count')} new DataRefs")
+            self.event_callback("DataRefPatternSubscribed", fields)
+        elif reply_type == 'THREAD':
+            level = logging.WARNING if fields.get('fallback') else logging.INFO
+            logging.log(level, f"X-Plane plugin thread '{fields.get('name')}' scheduling: "
+                               f"priority={fields.get('priority')}, affinity=0x{fields.get('affinity', 0):x}")
+            self.event_callback("PluginThreadScheduling", fields)
+        elif reply_type == 'AXISDEFINED':
+            self._pending_requests.pop(f"axis:{fields.get('name')}", None)
+            if fields.get('targets'):
+                self.axes[fields.get('name')] = fields
+                logging.info(f"X-Plane axis '{fields.get('name')}' defined with {fields.get('targets')} target(s)")
+            else:
+                logging.warning(f"X-Plane axis '{fields.get('name')}' has no writable DataRef")
+            self.event_callback("AxisDefined", fields)
+        elif reply_type == 'RESULT':
+            self._handle_query_result(payload)
+        elif reply_type == 'PONG':
+            sent = self._ping_sent.pop(fields.get('id'), None)
+            if sent is not None:
+                self.link_stats['rtt_ms'] = (time.perf_counter() - sent) * 1000.0
+
+    def _handle_query_result(self, payload):
+        """Collects the parts of a RESULT reply and reports the query once complete."""
+        fields = {}
+        for pair in payload.split(','):
+            if '=' in pair:
+                key, value = pair.split('=', 1)
+                fields[key] = self._convert_value(value) if value else None
+
+        query_id = fields.pop('id', None)
+        part = str(fields.pop('part', '1/1'))
+        query = self._queries.get(query_id)
+        if query is None:
+            return  # Duplicate answer to a resent query
+
+        query['values'].update(fields)
+        query['parts'].add(part)
+        if len(query['parts']) < int(part.partition('/')[2]):
+            return
+
+        del self._queries[query_id]
+        self._pending_requests.pop(f"query:{query_id}", None)
+        result = {'id': query_id, 'values': query['values']}
+        if query['callback']:
+            query['callback'](query['values'])
+        self.event_callback("QueryResult", result)
+
     def _convert_value(self, value_str):
         """Tries to convert a string value to a more appropriate type."""
         if '~' in value_str:
@@ -122,7 +335,7 @@ class XPlaneManager(threading.Thread):
         """Sends a command string to the X-Plane plugin."""
         if self.tx_socket:
             try:
-                self.tx_socket.sendto(command_str.encode('utf-8'), ('127.0.0.1', 34391))
+                self.tx_socket.sendto(command_str.encode('utf-8'), (self.sim_address, self.command_port))
             except Exception as e:
                 logging.error(f"Error sending command to X-Plane: {e}")
 
@@ -141,24 +354,157 @@ class XPlaneManager(threading.Thread):
         Enables or disables control overrides in X-Plane.
 
         Args:
-            override_type (str): The type of override ('joystick', 'pedals', 'collective').
+            override_type (str): The axis group ('joystick', 'pedals', 'collective' or a group given to define_axis).
             enabled (bool): True to enable the override, False to disable.
         """
         self.command_queue.append(f"OVERRIDE:{override_type}={str(enabled).lower()}")
         
-    def subscribe_dataref(self, dataref, type, tag, precision=3, conversion=1.0):
+    def define_axis(self, name, datarefs, group=None, index=None, override=None,
+                    in_range=(-1.0, 1.0), out_range=(-1.0, 1.0)):
+        """
+        Declares an axis that send_axis_data() can drive, e.g. toe brakes or throttles.
+
+        The built-in axes 'jx', 'jy' (group 'joystick'), 'px' ('pedals') and 'cy'
+        ('collective') are always defined. Defining an existing name updates it.
+
+        Args:
+            name (str): Key used in send_axis_data(), e.g. 'lbrake'.
+            datarefs (str or list): DataRef(s) written with the axis value.
+            group (str): Override group enabled with set_override(group, True). Defaults to the name.
+            index (int): Element to write for array DataRefs (e.g. a throttle per engine).
+            override (str): Override DataRef set to 1 while the group is enabled.
+            in_range (tuple): Range of the values passed to send_axis_data().
+            out_range (tuple): DataRef range the input range is mapped onto (values are clamped).
+        """
+        if not isinstance(datarefs, str):
+            datarefs = "|".join(datarefs)
+        fields = {'name': name, 'dataref': datarefs, 'group': group or name,
+                  'in_min': in_range[0], 'in_max': in_range[1], 'out_min': out_range[0], 'out_max': out_range[1]}
+        if index is not None:
+            fields['index'] = index
+        if override:
+            fields['override'] = override
+        command = "AXISDEF:" + ",".join(f"{key}={value}" for key, value in fields.items())
+        self._pending_requests[f"axis:{name}"] = [command, time.time(), 0]
+        self.command_queue.append(command)
+
+    def query_datarefs(self, datarefs, callback=None):
+        """
+        Reads DataRefs once instead of subscribing to them, e.g. aircraft geometry on load.
+
+        The plugin reads them all on its next frame and answers in one batch. The values
+        ({path: value}, None for unknown DataRefs) are passed to `callback` and reported
+        as a "QueryResult" event with the request id.
+
+        Args:
+            datarefs (list): DataRef paths to read.
+            callback (callable): Optional function called with the values.
+
+        Returns:
+            int: The request id.
+        """
+        self._query_id += 1
+        query_id = self._query_id
+        self._queries[query_id] = {'callback': callback, 'values': {}, 'parts': set()}
+        command = f"QUERY:id={query_id},datarefs={'|'.join(datarefs)}"
+        self._pending_requests[f"query:{query_id}"] = [command, time.time(), 0]
+        self.command_queue.append(command)
+        return query_id
+
+    def subscribe_dataref(self, dataref, type='auto', tag=None, precision=3, conversion=1.0, priority='normal',
+                          reduce=None):
         """
         Requests the plugin to subscribe to an additional DataRef.
-        
+
+        The plugin detects the DataRef type and array size and replies with the
+        resolved schema, which is stored in `dataref_schema` and reported through
+        the event callback as a "DataRefSubscribed" event.
+
         Args:
-            dataref (str): The X-Plane DataRef path (e.g., "sim/flightmodel/position/latitude").
-            type (str): The data type ('float', 'int', 'double').
-            tag (str): The key to use for this value in the telemetry data.
-            precision (int): The floating point precision.
+            dataref (str): The X-Plane DataRef path (e.g., "sim/flightmodel/position/latitude"),
+                           or a glob pattern such as "aw109/controls/*" to subscribe to every
+                           matching DataRef. Patterns are expanded again after each aircraft load.
+            type (str): The data type ('auto', 'float', 'int', 'double', 'float[]', 'int[]').
+                        'auto' lets the plugin pick the best native type.
+            tag (str): The key to use for this value in the telemetry data. Defaults to the DataRef path.
+                       For patterns it is a prefix, followed by the part of each path after the
+                       pattern's literal prefix (e.g. tag "AW109_" gives "AW109_aileron_trim_req").
+            precision (int): The floating point precision. 'double' datarefs are read and
+                             encoded as 64-bit values, so use enough decimals for the
+                             magnitude (e.g. 8 for latitude/longitude).
             conversion (float): A factor to multiply the value by.
+            priority (str): Collection tier ('critical', 'normal', 'low'). Critical DataRefs are read
+                            every frame; the others are read within the plugin's collection budget
+                            and low priority ones are slowed down first when it is exceeded.
+            reduce (str): Reduction used when the send rate is below the sim rate, see set_reduction().
+        """
+        tag = tag or ''
+        payload = (f"dataref={dataref},type={type},tag={tag},precision={precision},"
+                   f"conversion={conversion},priority={priority}")
+        if reduce:
+            payload += f",reduce={reduce}"
+        command = f"SUBSCRIBE:{payload}"
+        # Sent again until the plugin replies, the request may be lost on a remote link
+        self._pending_requests[dataref] = [command, time.time(), 0]
+        self.command_queue.append(command)
+
+    def set_reduction(self, **modes):
+        """
+        Sets how channels are reduced when telemetry is sent below the sim rate
+        (configure_plugin(send_hz=...)). Reductions run in the plugin at sim rate.
+
+        Args:
+            **modes: Channel key and mode: 'last' (plain sampling), 'mean', 'min', 'max',
+                     'peak' (largest magnitude, sign kept) or 'lowpass' (filtered at half
+                     the send rate). G, Gaxil, Gside and StickForce* default to 'peak',
+                     WeightOnWheels to 'max'.
+        """
+        payload = ",".join([f"{key}={mode}" for key, mode in modes.items()])
+        self.command_queue.append(f"REDUCE:{payload}")
+
+    def set_prediction(self, horizon_ms=None, **modes):
+        """
+        Makes the plugin publish short-horizon predictions of channels, extrapolated at
+        sim rate to compensate the latency between the sim frame and the force output.
+        A predicted channel arrives as "<key>_pred": [predicted value, error bound], where
+        the bound is the running mean absolute error of past predictions.
+
+        Args:
+            horizon_ms (int): Prediction horizon in milliseconds (plugin default 20), or None to keep it.
+            **modes: Channel key and mode: 'linear', 'quadratic' or 'off'.
+        """
+        if horizon_ms is not None:
+            self.configure_plugin(predict_horizon_ms=int(horizon_ms))
+        if modes:
+            payload = ",".join([f"{key}={mode}" for key, mode in modes.items()])
+            self.command_queue.append(f"PREDICT:{payload}")
+
+    def report_flow(self, achieved_hz, queue_depth, capacity_hz):
+        """
+        Reports the backend's processing rate to the plugin's flow control, which adapts
+        the telemetry send rate to it (enabled with configure_plugin(flow_control=1)).
+
+        Args:
+            achieved_hz (float): Telemetry frames processed per second.
+            queue_depth (int): Frames received but not processed yet.
+            capacity_hz (float): Frames per second the backend could process (see FlowMeter).
+        """
+        self.command_queue.append(f"FLOW:rate={achieved_hz:.1f},queue={queue_depth},capacity={capacity_hz:.1f}")
+
+    def configure_plugin(self, **settings):
+        """
+        Changes runtime settings of the X-Plane plugin.
+
+        Args:
+            **settings: Setting names and values, e.g. collect_budget_us=500 for the
+                        per-frame telemetry collection budget in microseconds,
+                        send_hz=60 to send telemetry at 60 Hz instead of every frame, or
+                        io_priority='high' and io_affinity=<cpu mask> for the plugin's I/O thread, or
+                        flow_control=1, flow_min_hz=20, flow_max_hz=0 to adapt the send rate to
+                        report_flow() within these bounds (0 = up to the sim frame rate).
         """
-        payload = f"dataref={dataref},type={type},tag={tag},precision={precision},conversion={conversion}"
-        self.command_queue.append(f"SUBSCRIBE:{payload}")
+        payload = ",".join([f"{key}={value}" for key, value in settings.items()])
+        self.command_queue.append(f"CONFIG:{payload}")
 
     def quit(self):
         """Signals the manager to shut down."""
@@ -170,11 +516,15 @@ class XPlaneManager(threading.Thread):
             self.rx_socket.close()
         if self.tx_socket:
             self.tx_socket.close()
+        if self.recorder:
+            self.recorder.close()
+        if self.archive:
+            self.archive.close()
         logging.info("X-Plane manager shut down.")
 
 
 if __name__ == '__main__':
-    import time
+    import sys
 
     logging.basicConfig(level=logging.INFO)
 
@@ -185,7 +535,13 @@ if __name__ == '__main__':
     def on_event(event, *args):
         print(f"Received event: {event}, args: {args}")
 
-    xp_manager = XPlaneManager(on_telemetry, on_event)
+    # Optional: sim host, telemetry port and command port, e.g. "127.0.0.1 44390 44391" to
+    # test remote mode on loopback against a plugin configured with the same ports
+    if len(sys.argv) > 1:
+        xp_manager = XPlaneManager(on_telemetry, on_event, sim_host=sys.argv[1],
+                                   telemetry_port=int(sys.argv[2]), command_port=int(sys.argv[3]))
+    else:
+        xp_manager = XPlaneManager(on_telemetry, on_event)
     xp_manager.start()
 
     # Example: send some axis data after a few seconds
@@ -197,6 +553,7 @@ if __name__ == '__main__':
     try:
         while True:
             time.sleep(1)
+            print(f"Link: {xp_manager.get_link_stats()}")
     except KeyboardInterrupt:
         print("Shutting down...")
         xp_manager.quit()
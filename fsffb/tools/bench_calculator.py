@@ -0,0 +1,228 @@
+#
+# This program is largely based on the TelemFFB distribution (https://github.com/walmis/TelemFFB).
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, version 3.
+#
+# This program is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+# General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <http://www.gnu.org/licenses/>.
+#
+
+"""
+FFBCalculator Microbenchmarks
+
+Runs the FFBCalculator stages and the fsffb.utils helpers over a telemetry
+corpus and reports the time and memory each call costs:
+
+    python -m fsffb.tools.bench_calculator                       # synthetic MSFS flight
+    python -m fsffb.tools.bench_calculator --src XPLANE
+    python -m fsffb.tools.bench_calculator --recording flight.rec   # main.py --record
+    python -m fsffb.tools.bench_calculator --save baseline.json
+    python -m fsffb.tools.bench_calculator --compare baseline.json --tolerance 0.25
+
+"us/call" is the best of --repeats passes over the corpus, divided by the calls.
+"alloc B/call" is the peak memory (tracemalloc) one call allocates on top of what
+was live before it, averaged over the corpus; a stage that only works on floats
+reports close to 0. --compare exits with status 1 if any benchmark got slower
+than the baseline by more than the tolerance, so it can guard against regressions.
+"""
+
+import sys
+import math
+import json
+import time
+import argparse
+import tracemalloc
+
+from fsffb.core.aircraft import get_aircraft_params
+from fsffb.core.ffb_calculator import FFBCalculator
+from fsffb.utils import expocurve, scale_clamp, LowPassFilter, Vector2D
+
+
+def synthetic_corpus(frames=2000, src='MSFS', rate_hz=60.0):
+    """
+    A synthetic flight covering the branches the stages take: taxi and takeoff roll
+    (ground rumble), climb and turns in wind, a stall approach past the stall AoA
+    (shaker, aileron fade) and an autopilot segment (AP following).
+    """
+    corpus = []
+    for i in range(frames):
+        t = i / rate_hz
+        phase = i / frames
+        on_ground = phase < 0.15
+        ias = 5 + 400 * phase if on_ground else 70 + 20 * math.sin(t / 7)
+        stall = 0.6 < phase < 0.7
+        aoa = 2 + 3 * math.sin(t / 3) + (14 * (phase - 0.6) / 0.1 if stall else 0)
+        frame = {
+            'src': src,
+            'T': t,
+            'IAS': ias,
+            'TAS': ias * 1.05,
+            'DynPressure': 0.5 * 1.225 * ias ** 2,
+            'AirDensity': 1.225 - 0.1 * phase,
+            'PropThrust': [400 + 200 * math.sin(t), 0.0, 0.0, 0.0],
+            'AoA': aoa,
+            'StallAoA': 15.0,
+            'SideSlip': 2 * math.sin(t / 2),
+            'G': 1 + 0.4 * math.sin(t / 1.5),
+            'AccBody': [0.1 * math.sin(t), 1 + 0.4 * math.sin(t / 1.5), 0.0],
+            'WindX': 3 * math.sin(t / 5), 'WindY': 0.5 * math.sin(t), 'WindZ': 2 * math.cos(t / 4),
+            'Heading': (t / 30) % (2 * math.pi),
+            'ElevTrimPct': 0.1 * math.sin(t / 20),
+            'AileronTrimPct': 0.02,
+            'ElevDeflPct': 0.2 * math.sin(t / 4),
+            'AileronDeflPctLR': [0.1 * math.sin(t / 3), -0.1 * math.sin(t / 3)],
+            'SimOnGround': on_ground,
+            'GroundSpeed': ias if on_ground else 0.0,
+            'SurfaceType': 'Asphalt',
+            'APMaster': 0.8 < phase < 0.9,
+        }
+        if src == 'XPLANE':
+            frame['Vne'] = 160.0
+            frame['DesignSpeed'] = [110.0, 0.0, 0.0]
+            frame['APServos'] = frame['APMaster']
+            frame['APPitchServo'] = 0.1
+            frame['StickForcePitch'] = 5 * math.sin(t)
+            frame['StickForceRoll'] = 2 * math.cos(t)
+        corpus.append(frame)
+    return corpus
+
+
+def recorded_corpus(path):
+    """Telemetry frames of a recording made with main.py --record."""
+    from fsffb.telemetry.recording import read_frames
+    corpus = []
+    for _, frame in read_frames(path):
+        frame.setdefault('src', 'XPLANE')
+        corpus.append(frame)
+    return corpus
+
+
+def _stage_calls(corpus):
+    """(name, callable, argument tuples) of every benchmark, arguments prepared outside the timing."""
+    params = get_aircraft_params("default")
+    calc = FFBCalculator(params)
+    p = calc._get_scaled_params()
+    joystick_axes = {'jx': 0.1, 'jy': -0.2, 'px': 0.0}
+    dt = 1 / 60.0
+
+    offsets_args, aero_args, constant_args, vibration_args, frame_args = [], [], [], [], []
+    for telem in corpus:
+        is_msfs = telem.get('src') != 'XPLANE'
+        ap_active = bool(telem.get('APMaster', 0)) if is_msfs else bool(telem.get('APServos', 0))
+        phys_offsets, _ = calc._calculate_spring_offsets(telem, ap_active, is_msfs, p)
+        offsets_args.append((telem, ap_active, is_msfs, p))
+        aero_args.append((telem, phys_offsets, p))
+        constant_args.append((telem, joystick_axes, p, dt, ap_active))
+        vibration_args.append((telem, p))
+        frame_args.append((telem, joystick_axes))
+
+    values = [frame.get('AoA', 0.0) / 20.0 for frame in corpus]
+    lowpass = LowPassFilter(time_constant=0.4)
+    return [
+        ('_get_scaled_params', calc._get_scaled_params, [()] * len(corpus)),
+        ('_calculate_spring_offsets', calc._calculate_spring_offsets, offsets_args),
+        ('_calculate_aero_spring_forces', calc._calculate_aero_spring_forces, aero_args),
+        ('_calculate_constant_forces', calc._calculate_constant_forces, constant_args),
+        ('_calculate_vibration_effects', calc._calculate_vibration_effects, vibration_args),
+        ('process_frame', calc.process_frame, frame_args),
+        ('utils.expocurve', expocurve, [(v, 0.4) for v in values]),
+        ('utils.scale_clamp', scale_clamp, [(v, (0, 1), (0, 0.8)) for v in values]),
+        ('LowPassFilter.process', lowpass.process, [(v, dt) for v in values]),
+        ('Vector2D.to_polar', lambda x, y: Vector2D(x, y).to_polar(), [(v, 1 - v) for v in values]),
+    ]
+
+
+def _time_per_call(function, calls, repeats):
+    best = math.inf
+    for _ in range(repeats):
+        start = time.perf_counter()
+        for args in calls:
+            function(*args)
+        best = min(best, time.perf_counter() - start)
+    return best / len(calls) * 1e6
+
+
+def _alloc_per_call(function, calls):
+    tracemalloc.start()
+    total = 0
+    try:
+        for args in calls:
+            before, _ = tracemalloc.get_traced_memory()
+            tracemalloc.reset_peak()
+            function(*args)
+            _, peak = tracemalloc.get_traced_memory()
+            total += peak - before
+    finally:
+        tracemalloc.stop()
+    return total / len(calls)
+
+
+def run_benchmarks(corpus, repeats=5):
+    """Returns {benchmark name: {'us': time per call, 'alloc_bytes': peak allocation per call}}."""
+    results = {}
+    for name, function, calls in _stage_calls(corpus):
+        for args in calls[:50]:
+            function(*args)  # Warm up caches and filters
+        results[name] = {
+            'us': _time_per_call(function, calls, repeats),
+            'alloc_bytes': _alloc_per_call(function, calls),
+        }
+    return results
+
+
+def find_regressions(results, baseline, tolerance):
+    """Names of the benchmarks in both `results` and `baseline` that got slower by more than `tolerance`."""
+    return [name for name, result in results.items()
+            if name in baseline and result['us'] / baseline[name]['us'] - 1.0 > tolerance]
+
+
+def main(argv=None):
+    parser = argparse.ArgumentParser(description="Microbenchmarks of the FFBCalculator stages and utils.")
+    parser.add_argument('--recording', help="Telemetry recording to use as the corpus (main.py --record).")
+    parser.add_argument('--src', choices=('MSFS', 'XPLANE'), default='MSFS', help="Synthetic corpus flavour.")
+    parser.add_argument('--frames', type=int, default=2000, help="Synthetic corpus length.")
+    parser.add_argument('--repeats', type=int, default=5, help="Timing passes, the best one counts.")
+    parser.add_argument('--save', metavar='FILE', help="Write the results as JSON, e.g. as a baseline.")
+    parser.add_argument('--compare', metavar='FILE', help="Compare against a saved baseline.")
+    parser.add_argument('--tolerance', type=float, default=0.25, help="Allowed slowdown against the baseline (0.25 = 25%%).")
+    args = parser.parse_args(argv)
+
+    corpus = recorded_corpus(args.recording) if args.recording else synthetic_corpus(args.frames, args.src)
+    if not corpus:
+        print("Empty corpus")
+        return 1
+    results = run_benchmarks(corpus, args.repeats)
+
+    baseline = {}
+    if args.compare:
+        with open(args.compare) as f:
+            baseline = json.load(f)
+
+    print(f"{len(corpus)} frames ({'recording' if args.recording else 'synthetic ' + args.src})")
+    print(f"{'benchmark':>32} {'us/call':>9} {'alloc B/call':>13} {'baseline':>9} {'change':>8}")
+    for name, result in results.items():
+        line = f"{name:>32} {result['us']:9.3f} {result['alloc_bytes']:13.0f}"
+        if name in baseline:
+            change = result['us'] / baseline[name]['us'] - 1.0
+            line += f" {baseline[name]['us']:9.3f} {change:+8.1%}"
+        print(line)
+    regressions = find_regressions(results, baseline, args.tolerance)
+
+    if args.save:
+        with open(args.save, 'w') as f:
+            json.dump(results, f, indent=2)
+    if regressions:
+        print("Slower than the baseline: " + ", ".join(regressions))
+        return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,267 @@
+#
+# This program is largely based on the TelemFFB distribution (https://github.com/walmis/TelemFFB).
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, version 3.
+#
+# This program is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+# General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <http://www.gnu.org/licenses/>.
+#
+
+"""
+HID Stream Analyzer
+
+Shows what the FFB devices were actually told to do, from a recording made
+with main.py --record-hid (see fsffb.hardware.hid_recorder):
+
+    python -m fsffb.tools.hid_analyzer flight.hid
+    python -m fsffb.tools.hid_analyzer flight.hid --timeline 0:3    # device 0, effect slot 3
+
+Reports the output traffic per effect slot (effect type, writes, update rate,
+redundant writes that repeat the previous report unchanged, starts and stops),
+the latency from a telemetry frame arriving to the first HID write it caused,
+the writes per frame and the input report rate. The timeline reconstructs one
+slot's effect state and prints every change.
+"""
+
+import sys
+import struct
+import argparse
+from collections import defaultdict
+
+import numpy as np
+
+from fsffb.hardware.hid_recorder import read_hid_recording, KIND_OUTPUT, KIND_INPUT, KIND_FRAME
+
+# Output report layouts, as the ctypes structures in fsffb.hardware.joystick_manager
+REPORTS = {
+    101: ('SetEffect', struct.Struct('<BBBHHHHBBBBH'),
+          ('reportId', 'slot', 'effectType', 'duration', 'triggerRepeatInterval', 'samplePeriod', 'gain',
+           'triggerButton', 'axesEnable', 'directionX', 'directionY', 'startDelay')),
+    110: ('EffectOperation', struct.Struct('<BBBB'), ('reportId', 'slot', 'operation', 'loopCount')),
+    105: ('SetConstantForce', struct.Struct('<BBh'), ('reportId', 'slot', 'magnitude')),
+    104: ('SetPeriodic', struct.Struct('<BBHhBH'), ('reportId', 'slot', 'magnitude', 'offset', 'phase', 'period')),
+    103: ('SetCondition', struct.Struct('<BBBhhhHHH'),
+          ('reportId', 'slot', 'parameterBlockOffset', 'cpOffset', 'positiveCoefficient', 'negativeCoefficient',
+           'positiveSaturation', 'negativeSaturation', 'deadBand')),
+}
+
+# USB PID effect types
+EFFECT_TYPES = {1: 'constant', 2: 'ramp', 3: 'square', 4: 'sine', 5: 'triangle', 6: 'sawtooth up',
+                7: 'sawtooth down', 8: 'spring', 9: 'damper', 10: 'inertia', 11: 'friction'}
+OP_START, OP_STOP = 1, 3
+
+
+def decode_report(data):
+    """Returns (report name, fields dict) of an output report, or (None, None) if unknown."""
+    if not data or data[0] not in REPORTS:
+        return None, None
+    name, layout, fields = REPORTS[data[0]]
+    if len(data) < layout.size:
+        return name, None
+    return name, dict(zip(fields, layout.unpack_from(data)))
+
+
+class SlotState:
+    """Effect state of one slot, rebuilt from the reports written to it."""
+
+    def __init__(self):
+        self.effect_type = None
+        self.running = False
+        self.params = {}
+        self.writes = 0
+        self.redundant = 0
+        self.starts = 0
+        self.stops = 0
+        self.first = None
+        self.last = None
+
+    def apply(self, name, fields):
+        """Updates the state, returns the changed values as {field: (old, new)}."""
+        changes = {}
+
+        def set_value(key, value):
+            old = self.params.get(key)
+            if old != value:
+                changes[key] = (old, value)
+                self.params[key] = value
+
+        if name == 'SetEffect':
+            if self.effect_type != fields['effectType']:
+                changes['type'] = (EFFECT_TYPES.get(self.effect_type), EFFECT_TYPES.get(fields['effectType']))
+                self.effect_type = fields['effectType']
+            set_value('direction', fields['directionX'])
+        elif name == 'EffectOperation':
+            running = fields['operation'] == OP_START
+            if fields['operation'] == OP_START:
+                self.starts += 1
+            elif fields['operation'] == OP_STOP:
+                self.stops += 1
+            if running != self.running:
+                changes['running'] = (self.running, running)
+                self.running = running
+        elif name == 'SetConstantForce':
+            set_value('magnitude', fields['magnitude'])
+        elif name == 'SetPeriodic':
+            set_value('magnitude', fields['magnitude'])
+            set_value('period', fields['period'])
+        elif name == 'SetCondition':
+            axis = 'xy'[fields['parameterBlockOffset']] if fields['parameterBlockOffset'] < 2 else fields['parameterBlockOffset']
+            if self.effect_type is None:
+                self.effect_type = 8  # Springs are updated without a SetEffect header
+            set_value(f'coefficient_{axis}', fields['positiveCoefficient'])
+            set_value(f'cp_offset_{axis}', fields['cpOffset'])
+        return changes
+
+
+class HidAnalyzer:
+    """Rebuilds effect state and timing statistics from a HID recording."""
+
+    def __init__(self, timeline=None):
+        """
+        Args:
+            timeline (tuple): (device, slot) whose state changes are collected, or None.
+        """
+        self.timeline_slot = timeline
+        self.timeline = []
+        self.slots = defaultdict(SlotState)   # (device, slot) -> SlotState
+        self.last_report = {}                 # (device, report ID, slot, block) -> bytes
+        self.outputs = 0
+        self.output_bytes = 0
+        self.unknown = 0
+        self.inputs = defaultdict(list)       # device -> input report times
+        self.frames = 0
+        self.frames_without_writes = 0
+        self.latencies = []                   # Frame arrival to its first write
+        self.bursts = []                      # First to last write after a frame
+        self.writes_per_frame = []
+        self._frame_time = None               # Frame waiting for its first write
+        self._burst = None                    # [first write, last write, writes] of the current frame
+        self.start = None
+        self.end = None
+
+    def add(self, t, kind, device, data):
+        if self.start is None:
+            self.start = t
+        self.end = t
+        if kind == KIND_FRAME:
+            self._end_frame()
+            self.frames += 1
+            self._frame_time = t
+        elif kind == KIND_INPUT:
+            self.inputs[device].append(t)
+        elif kind == KIND_OUTPUT:
+            self._add_output(t, device, data)
+
+    def _end_frame(self):
+        if self._burst is not None:
+            self.bursts.append(self._burst[1] - self._burst[0])
+            self.writes_per_frame.append(self._burst[2])
+        elif self.frames:
+            self.frames_without_writes += 1
+            self.writes_per_frame.append(0)
+        self._burst = None
+
+    def _add_output(self, t, device, data):
+        self.outputs += 1
+        self.output_bytes += len(data)
+        if self._frame_time is not None:
+            self.latencies.append(t - self._frame_time)
+            self._frame_time = None
+            self._burst = [t, t, 0]
+        if self._burst is not None:
+            self._burst[1] = t
+            self._burst[2] += 1
+
+        name, fields = decode_report(data)
+        if fields is None:
+            self.unknown += 1
+            return
+        slot_key = (device, fields['slot'])
+        state = self.slots[slot_key]
+        state.writes += 1
+        state.first = t if state.first is None else state.first
+        state.last = t
+
+        report_key = (device, data[0], fields['slot'], fields.get('parameterBlockOffset'))
+        if self.last_report.get(report_key) == data:
+            state.redundant += 1
+        self.last_report[report_key] = data
+
+        changes = state.apply(name, fields)
+        if slot_key == self.timeline_slot:
+            self.timeline.append((t, name, changes))
+
+    def finish(self):
+        self._end_frame()
+
+    def report(self, out=sys.stdout):
+        duration = (self.end - self.start) if self.start is not None else 0.0
+        print(f"{duration:.1f} s, {self.outputs} output reports ({self.output_bytes} bytes, "
+              f"{self.outputs / duration if duration else 0:.0f}/s), {self.frames} telemetry frames", file=out)
+        if self.unknown:
+            print(f"{self.unknown} output reports of unknown type", file=out)
+
+        if self.latencies:
+            latency = np.array(self.latencies) * 1000.0
+            bursts = np.array(self.bursts) * 1000.0 if self.bursts else np.zeros(1)
+            writes = np.array(self.writes_per_frame)
+            print(f"Frame to first HID write: median {np.median(latency):.2f} ms, p95 {np.percentile(latency, 95):.2f} ms, "
+                  f"max {latency.max():.2f} ms", file=out)
+            print(f"Write burst per frame: median {np.median(bursts):.2f} ms, max {bursts.max():.2f} ms; "
+                  f"writes per frame: mean {writes.mean():.2f}, max {writes.max()}", file=out)
+        if self.frames:
+            print(f"Frames without HID writes: {self.frames_without_writes} "
+                  f"({self.frames_without_writes / self.frames:.1%})", file=out)
+
+        for device, times in sorted(self.inputs.items()):
+            if len(times) > 1:
+                intervals = np.diff(times) * 1000.0
+                print(f"Device {device} input: {len(times)} reports, median interval {np.median(intervals):.2f} ms "
+                      f"({1000.0 / np.median(intervals) if np.median(intervals) else 0:.0f} Hz), "
+                      f"max {intervals.max():.2f} ms", file=out)
+
+        print(f"\n{'dev':>3} {'slot':>4} {'type':>13} {'writes':>7} {'rate Hz':>8} {'redundant':>10} "
+              f"{'starts':>6} {'stops':>6}  state at end", file=out)
+        for (device, slot), state in sorted(self.slots.items()):
+            span = (state.last - state.first) if state.writes > 1 else 0.0
+            rate = (state.writes - 1) / span if span else 0.0
+            params = ", ".join(f"{key}={value}" for key, value in sorted(state.params.items()))
+            print(f"{device:>3} {slot:>4} {EFFECT_TYPES.get(state.effect_type, '?'):>13} {state.writes:>7} "
+                  f"{rate:8.1f} {state.redundant:>5} {state.redundant / state.writes:4.0%} {state.starts:>6} "
+                  f"{state.stops:>6}  {'running' if state.running else 'stopped'} {params}", file=out)
+
+        if self.timeline_slot is not None:
+            print(f"\nTimeline of device {self.timeline_slot[0]} slot {self.timeline_slot[1]}:", file=out)
+            for t, name, changes in self.timeline:
+                described = ", ".join(f"{key} {old} -> {new}" for key, (old, new) in changes.items()) or "unchanged"
+                print(f"  {t - self.start:9.4f} s {name:>16}: {described}", file=out)
+
+
+def main(argv=None):
+    parser = argparse.ArgumentParser(description="Analyzes a HID recording of the FFB devices.")
+    parser.add_argument('recording', help="Recording made with main.py --record-hid.")
+    parser.add_argument('--timeline', metavar='DEVICE:SLOT', help="Print the state changes of one effect slot.")
+    args = parser.parse_args(argv)
+
+    timeline = None
+    if args.timeline:
+        device, slot = args.timeline.split(':') if ':' in args.timeline else (0, args.timeline)
+        timeline = (int(device), int(slot))
+
+    analyzer = HidAnalyzer(timeline)
+    for record in read_hid_recording(args.recording):
+        analyzer.add(*record)
+    analyzer.finish()
+    analyzer.report()
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,182 @@
+#
+# This program is largely based on the TelemFFB distribution (https://github.com/walmis/TelemFFB).
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, version 3.
+#
+# This program is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+# General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <http://www.gnu.org/licenses/>.
+#
+
+"""
+Prediction Error Benchmark
+
+Measures how well telemetry predictions match what the sim actually did, over
+flights recorded with `main.py --record FILE`:
+
+    python -m fsffb.tools.prediction_error flight.rec
+    python -m fsffb.tools.prediction_error flight.rec --simulate quadratic --horizon-ms 30 --channels G,AoA
+
+Without --simulate, the "<key>_pred" channels the plugin published are scored.
+With --simulate, the plugin's estimator is rerun offline on the recorded channels,
+so modes and horizons can be compared on any recording. Recorded frames arrive at
+the send rate, so offline results are only comparable between runs on the same file.
+
+Every prediction made at sim time t is compared to the actual value at t + horizon
+(interpolated on the "T" channel). The "hold" column is the error of simply using
+the latest value, i.e. what the effects see without prediction.
+"""
+
+import sys
+import argparse
+
+import numpy as np
+
+from fsffb.telemetry.recording import read_frames
+
+
+def load_series(path):
+    """Returns (sim times, {key: values}, {key: (predictions, bounds)}, horizon_ms) of a recording."""
+    times = []
+    actual = {}
+    predicted = {}
+    horizon_ms = None
+    for _, frame in read_frames(path):
+        if 'T' not in frame:
+            continue
+        index = len(times)
+        times.append(frame['T'])
+        horizon_ms = frame.get('PredHorizonMs', horizon_ms)
+        for key, value in frame.items():
+            if key.endswith('_pred') and isinstance(value, list) and len(value) == 2:
+                predicted.setdefault(key[:-5], {})[index] = value
+            elif isinstance(value, float):
+                actual.setdefault(key, {})[index] = value
+
+    count = len(times)
+    times = np.array(times)
+
+    def dense(samples, width=None):
+        shape = (count,) if width is None else (count, width)
+        array = np.full(shape, np.nan)
+        for index, value in samples.items():
+            array[index] = value
+        return array
+
+    actual = {key: dense(samples) for key, samples in actual.items()}
+    predicted = {key: dense(samples, 2) for key, samples in predicted.items()}
+    return times, actual, predicted, horizon_ms
+
+
+def simulate(times, values, mode, horizon):
+    """Offline port of the plugin's UpdatePredictions() estimator, returns (predictions, bounds)."""
+    smoothing = 0.5
+    error_smoothing = 0.05
+    predictions = np.full(len(values), np.nan)
+    bounds = np.full(len(values), np.nan)
+    last_time = None
+    last_value = rate = accel = bound = 0.0
+    pending = []
+
+    for i, (t, value) in enumerate(zip(times, values)):
+        if np.isnan(value):
+            continue
+        dt = t - last_time if last_time is not None else 0.0
+        if last_time is None or dt <= 0.0 or dt > 0.5:
+            last_time, last_value, rate, accel, pending = t, value, 0.0, 0.0, []
+            continue
+        new_rate = (value - last_value) / dt
+        new_accel = (new_rate - rate) / dt
+        rate += smoothing * (new_rate - rate)
+        accel += smoothing * (new_accel - accel)
+        last_time, last_value = t, value
+
+        while pending and pending[0][0] <= t:
+            bound += error_smoothing * (abs(pending.pop(0)[1] - value) - bound)
+
+        prediction = value + rate * horizon
+        if mode == 'quadratic':
+            prediction += 0.5 * accel * horizon * horizon
+        pending.append((t + horizon, prediction))
+        predictions[i] = prediction
+        bounds[i] = bound
+
+    return predictions, bounds
+
+
+def score(times, values, predictions, bounds, horizon):
+    """Returns error statistics of the predictions and of holding the latest value."""
+    valid = ~np.isnan(values)
+    targets = times + horizon
+    # Only predictions whose target lies inside the recording, and not across a gap
+    usable = valid & ~np.isnan(predictions) & (targets <= times[valid][-1])
+    if not np.any(usable):
+        return None
+    truth = np.interp(targets[usable], times[valid], values[valid])
+    errors = np.abs(predictions[usable] - truth)
+    hold_errors = np.abs(values[usable] - truth)
+
+    stats = {'count': int(np.count_nonzero(usable))}
+    for name, e in (('pred', errors), ('hold', hold_errors)):
+        stats[name] = {
+            'mean': float(np.mean(e)),
+            'rms': float(np.sqrt(np.mean(e ** 2))),
+            'p95': float(np.percentile(e, 95)),
+            'max': float(np.max(e)),
+        }
+    bound = bounds[usable]
+    stats['within_bound'] = float(np.mean(errors <= bound))
+    stats['within_2x_bound'] = float(np.mean(errors <= 2 * bound))
+    return stats
+
+
+def main(argv=None):
+    parser = argparse.ArgumentParser(description="Scores telemetry predictions over a recorded flight.")
+    parser.add_argument('recording', help="Recording made with main.py --record.")
+    parser.add_argument('--simulate', choices=('linear', 'quadratic'),
+                        help="Rerun the estimator offline with this mode instead of scoring the plugin's predictions.")
+    parser.add_argument('--horizon-ms', type=float, help="Prediction horizon (default: the recorded PredHorizonMs, or 20).")
+    parser.add_argument('--channels', default='G,AoA', help="Channels to simulate (default G,AoA).")
+    args = parser.parse_args(argv)
+
+    times, actual, predicted, recorded_horizon = load_series(args.recording)
+    if len(times) < 2:
+        print("Recording has no usable telemetry")
+        return 1
+
+    if args.simulate:
+        horizon_ms = args.horizon_ms or recorded_horizon or 20.0
+        predicted = {}
+        for key in args.channels.split(','):
+            if key in actual:
+                predictions, bounds = simulate(times, actual[key], args.simulate, horizon_ms / 1000.0)
+                predicted[key] = np.column_stack((predictions, bounds))
+        print(f"Offline {args.simulate} prediction, horizon {horizon_ms:g} ms")
+    else:
+        horizon_ms = args.horizon_ms or recorded_horizon or 20.0
+        if not predicted:
+            print("Recording has no predicted channels, use --simulate")
+            return 1
+        print(f"Plugin predictions, horizon {horizon_ms:g} ms")
+
+    print(f"{'channel':>12} {'n':>7} {'mean':>9} {'rms':>9} {'p95':>9} {'max':>9} {'hold rms':>9} {'in bound':>9} {'in 2x':>7}")
+    for key in sorted(predicted):
+        if key not in actual:
+            continue
+        stats = score(times, actual[key], predicted[key][:, 0], predicted[key][:, 1], horizon_ms / 1000.0)
+        if stats is None:
+            continue
+        pred, hold = stats['pred'], stats['hold']
+        print(f"{key:>12} {stats['count']:7d} {pred['mean']:9.4f} {pred['rms']:9.4f} {pred['p95']:9.4f} "
+              f"{pred['max']:9.4f} {hold['rms']:9.4f} {stats['within_bound']:9.1%} {stats['within_2x_bound']:7.1%}")
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
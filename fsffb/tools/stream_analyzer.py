@@ -0,0 +1,277 @@
+#
+# This program is largely based on the TelemFFB distribution (https://github.com/walmis/TelemFFB).
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, version 3.
+#
+# This program is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+# General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <http://www.gnu.org/licenses/>.
+#
+
+"""
+Telemetry Stream Analyzer
+
+Reports what the X-Plane telemetry stream actually contains, to decide which
+channels to delta-encode, quantize, decimate or drop:
+
+    python -m fsffb.tools.stream_analyzer flight.rec           # recording (main.py --record)
+    python -m fsffb.tools.stream_analyzer --listen 34390 --seconds 60
+
+Listening needs the port to be free, i.e. the FSFFB backend not running (or
+running with its telemetry on another port).
+
+Per channel: how often it is present and how often its value changes, the
+Shannon entropy of its values (bits per frame), the bytes it contributes to the
+stream and its array lengths. Per stream: the packet size distribution, the
+inter-arrival jitter and the gaps, with what changed across each gap (pause,
+aircraft, sequence numbers lost).
+"""
+
+import sys
+import math
+import time
+import socket
+import argparse
+from collections import Counter, defaultdict
+
+import numpy as np
+
+from fsffb.telemetry.recording import read_recording
+
+REPLY_SEPARATOR = ':'
+
+
+class FieldStats:
+    """Running statistics of one telemetry channel."""
+
+    MAX_DISTINCT = 65536  # Entropy is estimated from the first distinct values beyond this
+
+    def __init__(self):
+        self.present = 0
+        self.changes = 0
+        self.bytes = 0
+        self.last = None
+        self.values = Counter()
+        self.lengths = Counter()
+        self.numeric = True
+        self.deltas = []
+
+    def add(self, key, value):
+        self.present += 1
+        self.bytes += len(key) + len(value) + 2  # "key=value;"
+        if self.last is not None and value != self.last:
+            self.changes += 1
+            if self.numeric:
+                try:
+                    self.deltas.append(abs(float(value) - float(self.last)))
+                except ValueError:
+                    pass  # Arrays and text
+        if value in self.values or len(self.values) < self.MAX_DISTINCT:
+            self.values[value] += 1
+        parts = value.split('~')
+        self.lengths[len(parts)] += 1
+        if self.numeric:
+            try:
+                float(parts[0])
+            except ValueError:
+                self.numeric = False
+        self.last = value
+
+    def entropy(self):
+        total = sum(self.values.values())
+        if not total:
+            return 0.0
+        return max(0.0, -sum(n / total * math.log2(n / total) for n in self.values.values()))
+
+    def hint(self):
+        """A suggestion for the wire format, from change rate, entropy and value range."""
+        change_rate = self.changes / max(self.present - 1, 1)
+        if self.changes == 0:
+            return 'drop (constant)'
+        if change_rate < 0.1:
+            return 'send on change'
+        if not self.numeric:
+            return 'text'
+        if self.deltas:
+            try:
+                span = max(abs(float(v)) for v in list(self.values)[:1000])
+            except ValueError:
+                span = 0.0
+            median_delta = float(np.median(self.deltas))
+            if span > 0 and median_delta < span * 0.01:
+                return 'delta-encode'
+        if self.entropy() > 10:
+            return 'quantize'
+        return 'decimate' if change_rate < 0.5 else ''
+
+
+class StreamAnalyzer:
+    """Collects stream and per-channel statistics from telemetry datagrams."""
+
+    def __init__(self, gap_seconds=0.25):
+        self.gap_seconds = gap_seconds
+        self.fields = defaultdict(FieldStats)
+        self.packet_sizes = []
+        self.arrivals = []
+        self.frames = 0
+        self.replies = 0
+        self.fragments = 0
+        self.lost = 0
+        self.gaps = []
+        self.transitions = []  # Pause and aircraft changes: (time, key, value, interval before)
+        self._last_seq = None
+        self._last_time = None
+        self._last_context = {}
+
+    def add(self, receive_time, data_string):
+        """Adds one datagram as received."""
+        head = data_string.split(';', 1)[0]
+        if REPLY_SEPARATOR in head.split('=', 1)[0]:
+            self.replies += 1
+            return
+        self.packet_sizes.append(len(data_string.encode('utf-8')))
+
+        pairs = {}
+        for pair in data_string.strip(';').split(';'):
+            if '=' in pair:
+                key, value = pair.split('=', 1)
+                pairs[key] = value
+
+        fragment = pairs.pop('Frag', None)
+        if fragment is not None:
+            self.fragments += 1
+            if not fragment.startswith('1/'):
+                # Continuation of a frame: fields only, no new arrival
+                for key, value in pairs.items():
+                    if key != 'Seq':
+                        self.fields[key].add(key, value)
+                return
+
+        self.frames += 1
+        seq = pairs.get('Seq')
+        if seq is not None and self._last_seq is not None:
+            try:
+                missing = int(seq) - self._last_seq - 1
+                if missing > 0:
+                    self.lost += missing
+            except ValueError:
+                pass
+        if seq is not None:
+            try:
+                self._last_seq = int(seq)
+            except ValueError:
+                pass
+
+        context = {key: pairs.get(key) for key in ('N', 'SimPaused')}
+        if self._last_time is not None:
+            interval = receive_time - self._last_time
+            self.arrivals.append(interval)
+            changed = [key for key in context if context[key] != self._last_context.get(key)]
+            for key in changed:
+                self.transitions.append((receive_time, key, context[key], interval))
+            if interval > self.gap_seconds:
+                self.gaps.append((self._last_time, interval, changed, context))
+        self._last_time = receive_time
+        self._last_context = context
+
+        for key, value in pairs.items():
+            if key != 'Seq':
+                self.fields[key].add(key, value)
+
+    def report(self, out=sys.stdout):
+        if not self.frames:
+            print("No telemetry frames", file=out)
+            return
+
+        sizes = np.array(self.packet_sizes)
+        total_bytes = int(sizes.sum())
+        print(f"{self.frames} frames, {self.replies} replies, {self.fragments} fragments, "
+              f"{self.lost} frames lost (Seq), {total_bytes} bytes", file=out)
+        print(f"Packet size: min {sizes.min()}, median {int(np.median(sizes))}, p95 {int(np.percentile(sizes, 95))}, "
+              f"max {sizes.max()} bytes", file=out)
+        edges = [256, 512, 1024, 1472, 4096, 65536]
+        counts = np.histogram(sizes, bins=[0] + edges)[0]
+        print("  " + ", ".join(f"<={edge}: {count}" for edge, count in zip(edges, counts)), file=out)
+
+        if self.arrivals:
+            intervals = np.array(self.arrivals) * 1000.0
+            steady = intervals[intervals <= self.gap_seconds * 1000.0]
+            if len(steady):
+                median = np.median(steady)
+                print(f"Inter-arrival: median {median:.2f} ms ({1000.0 / median if median else 0:.1f} Hz), "
+                      f"jitter (stdev) {steady.std():.2f} ms, p99 {np.percentile(steady, 99):.2f} ms, "
+                      f"max {steady.max():.2f} ms", file=out)
+        if self.gaps:
+            print(f"Gaps over {self.gap_seconds * 1000:.0f} ms:", file=out)
+            for start, interval, changed, context in self.gaps[:20]:
+                reason = ", ".join(f"{key} -> {context[key]}" for key in changed) or "no pause or aircraft change"
+                print(f"  at {start:9.3f} s: {interval * 1000:8.1f} ms ({reason})", file=out)
+            if len(self.gaps) > 20:
+                print(f"  ... {len(self.gaps) - 20} more", file=out)
+
+        if self.transitions:
+            print("Pause and aircraft changes:", file=out)
+            for when, key, value, interval in self.transitions[:20]:
+                print(f"  at {when:9.3f} s: {key} -> {value}, {interval * 1000:.1f} ms after the previous frame", file=out)
+
+        print(f"\n{'channel':>24} {'present':>8} {'change/fr':>9} {'entropy':>8} {'bytes':>9} {'share':>6} "
+              f"{'lengths':>10}  hint", file=out)
+        field_bytes = sum(stats.bytes for stats in self.fields.values()) or 1
+        for key, stats in sorted(self.fields.items(), key=lambda item: -item[1].bytes):
+            change_rate = stats.changes / max(stats.present - 1, 1)
+            lengths = "/".join(str(length) for length in sorted(stats.lengths))
+            print(f"{key[:24]:>24} {stats.present:8d} {change_rate:9.2f} {stats.entropy():8.2f} {stats.bytes:9d} "
+                  f"{stats.bytes / field_bytes:6.1%} {lengths[:10]:>10}  {stats.hint()}", file=out)
+
+
+def listen(port, seconds, bind):
+    """Yields (receive_time, data_string) from the telemetry port for `seconds`."""
+    rx = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    rx.bind((bind, port))
+    rx.settimeout(0.5)
+    start = time.perf_counter()
+    try:
+        while time.perf_counter() - start < seconds:
+            try:
+                data, _ = rx.recvfrom(65536)
+            except socket.timeout:
+                continue
+            yield time.perf_counter() - start, data.decode('utf-8', errors='replace')
+    finally:
+        rx.close()
+
+
+def main(argv=None):
+    parser = argparse.ArgumentParser(description="Analyzes the telemetry stream of the X-Plane plugin.")
+    parser.add_argument('recording', nargs='?', help="Recording made with main.py --record.")
+    parser.add_argument('--listen', type=int, metavar='PORT', help="Listen on the telemetry port instead.")
+    parser.add_argument('--bind', default='127.0.0.1', help="Address to listen on (0.0.0.0 for remote mode).")
+    parser.add_argument('--seconds', type=float, default=30.0, help="How long to listen.")
+    parser.add_argument('--gap-ms', type=float, default=250.0, help="Inter-arrival time reported as a gap.")
+    args = parser.parse_args(argv)
+
+    if args.listen:
+        source = listen(args.listen, args.seconds, args.bind)
+    elif args.recording:
+        source = read_recording(args.recording)
+    else:
+        parser.error("Give a recording or --listen PORT")
+
+    analyzer = StreamAnalyzer(gap_seconds=args.gap_ms / 1000.0)
+    try:
+        for receive_time, data_string in source:
+            analyzer.add(receive_time, data_string)
+    except KeyboardInterrupt:
+        pass
+    analyzer.report()
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -10,7 +10,7 @@ from PyQt6.QtWidgets import (
     QGroupBox, QSplitter, QPushButton, QInputDialog, QMessageBox
 )
 from PyQt6.QtCore import Qt, pyqtSignal
-from .widgets import FourQuadrantPlot
+from .widgets import FourQuadrantPlot, HistoryPlot
 from ..core.aircraft import get_available_presets, get_preset_info, save_current_as_preset
 
 class MainWindow(QMainWindow):
@@ -260,6 +260,18 @@ class MainWindow(QMainWindow):
         layout.addWidget(self.plot_constant_force, 1, 0)
         layout.addWidget(self.plot_sim_axes, 1, 1)
 
+        # Tuning history: force outputs and the flight state driving them
+        self.plot_force_history = HistoryPlot("Force History", y_range=(-1.1, 1.1))
+        self.plot_force_history.add_trace("Spring X", 'c')
+        self.plot_force_history.add_trace("Spring Y", 'm')
+        self.plot_force_history.add_trace("Constant Force", 'y')
+        self.plot_flight_history = HistoryPlot("Flight History")
+        self.plot_flight_history.add_trace("G", 'r')
+        self.plot_flight_history.add_trace("AoA", 'g')
+
+        layout.addWidget(self.plot_force_history, 2, 0)
+        layout.addWidget(self.plot_flight_history, 2, 1)
+
     def _populate_telemetry(self, splitter):
         """Creates the live telemetry display section."""
         telemetry_widget = QWidget()
@@ -317,6 +329,9 @@ class MainWindow(QMainWindow):
         
     def update_debug_display(self, data):
         """Updates the debug labels with new data from the calculator."""
+        self.plot_force_history.append("Spring X", data.get('spring_coeff_x'))
+        self.plot_force_history.append("Spring Y", data.get('spring_coeff_y'))
+
         # If this is the first time or new keys were added, recreate the layout
         if not self.debug_labels or set(data.keys()) != set(self.debug_labels.keys()):
             self._update_debug_labels(data)
@@ -331,6 +346,9 @@ class MainWindow(QMainWindow):
 
     def update_telemetry_display(self, data):
         """Updates the telemetry text display with a curated list of data."""
+        self.plot_flight_history.append("G", data.get('G'))
+        self.plot_flight_history.append("AoA", data.get('AoA'))
+
         text = ""
         for key in self.telemetry_keys_to_display:
             value = data.get(key) # Use .get() to handle missing keys gracefully
@@ -357,6 +375,7 @@ class MainWindow(QMainWindow):
         const_x = mag * _np.cos(direction_rad)
         const_y = mag * _np.sin(direction_rad)
         self.plot_constant_force.update_point(-const_x, -const_y)
+        self.plot_force_history.append("Constant Force", mag)
         
         self.plot_sim_axes.update_point(-sim_axes.get('jx', 0), sim_axes.get('jy', 0))
 
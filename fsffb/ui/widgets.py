@@ -2,7 +2,10 @@
 # This program is largely based on the TelemFFB distribution (https://github.com/walmis/TelemFFB).
 #
 
+import time
+import numpy as np
 from PyQt6.QtWidgets import QWidget, QVBoxLayout
+from PyQt6.QtCore import QTimer
 import pyqtgraph as pg
 
 class FourQuadrantPlot(QWidget):
@@ -54,6 +57,111 @@ class FourQuadrantPlot(QWidget):
         self.scatter.setData([x], [y])
         self.text_item.setText(f"X: {x:.3f}\nY: {y:.3f}")
 
+class RingBuffer:
+    """
+    Fixed-size ring buffer of (time, value) samples backed by numpy arrays.
+    Appending is O(1) and never allocates.
+    """
+    def __init__(self, capacity):
+        self.capacity = capacity
+        self.times = np.zeros(capacity)
+        self.values = np.zeros(capacity)
+        self.count = 0
+        self.head = 0  # Next write position
+
+    def append(self, t, value):
+        self.times[self.head] = t
+        self.values[self.head] = value
+        self.head = (self.head + 1) % self.capacity
+        self.count = min(self.count + 1, self.capacity)
+
+    def since(self, t_start):
+        """Returns (times, values) of the samples at or after t_start, oldest first."""
+        if self.count < self.capacity:
+            times, values = self.times[:self.count], self.values[:self.count]
+        else:
+            times = np.concatenate((self.times[self.head:], self.times[:self.head]))
+            values = np.concatenate((self.values[self.head:], self.values[:self.head]))
+        start = np.searchsorted(times, t_start)
+        return times[start:], values[start:]
+
+
+def minmax_decimate(times, values, bins):
+    """
+    Reduces samples to at most 2 * bins points, keeping the minimum and maximum of
+    each bin so short spikes stay visible however many samples fall in a pixel.
+    """
+    count = len(values)
+    if count <= 2 * bins:
+        return times, values
+    per_bin = count // bins
+    used = per_bin * bins
+    # Drop the oldest samples that do not fill a bin, the newest ones are always drawn
+    t = times[count - used:].reshape(bins, per_bin)
+    v = values[count - used:].reshape(bins, per_bin)
+    out_t = np.repeat(t[:, 0], 2)
+    out_v = np.empty(2 * bins)
+    out_v[0::2] = v.min(axis=1)
+    out_v[1::2] = v.max(axis=1)
+    return out_t, out_v
+
+
+class HistoryPlot(QWidget):
+    """
+    A scrolling time-history plot of several named traces.
+
+    Samples go into fixed-size ring buffers and are only drawn by a timer at display
+    rate, decimated to the plot's pixel width, so drawing costs the same whatever
+    the telemetry rate or the window length.
+    """
+    def __init__(self, title, window_seconds=10.0, capacity=8192, refresh_hz=30, y_range=None, parent=None):
+        super().__init__(parent)
+        self.window_seconds = window_seconds
+        self.capacity = capacity
+        self.traces = {}  # name -> (RingBuffer, PlotDataItem)
+
+        self.plot_widget = pg.PlotWidget()
+        self.plot_widget.setTitle(title)
+        self.plot_widget.setLabel('bottom', 'Time (s)')
+        self.plot_widget.setXRange(-window_seconds, 0, padding=0)
+        if y_range:
+            self.plot_widget.setYRange(*y_range)
+        self.plot_widget.showGrid(x=True, y=True, alpha=0.3)
+        self.plot_widget.addLegend(offset=(5, 5))
+
+        layout = QVBoxLayout()
+        layout.addWidget(self.plot_widget)
+        self.setLayout(layout)
+
+        self.timer = QTimer(self)
+        self.timer.setInterval(int(1000 / refresh_hz))
+        self.timer.timeout.connect(self.redraw)
+        self.timer.start()
+
+    def add_trace(self, name, color):
+        """Adds a named trace drawn in the given color."""
+        curve = self.plot_widget.plot(name=name, pen=pg.mkPen(color, width=1))
+        self.traces[name] = (RingBuffer(self.capacity), curve)
+
+    def append(self, name, value, t=None):
+        """Records a sample for a trace; cheap enough to call for every telemetry frame."""
+        trace = self.traces.get(name)
+        if trace is None or value is None:
+            return
+        trace[0].append(time.perf_counter() if t is None else t, float(value))
+
+    def redraw(self):
+        """Redraws the visible window of every trace, called by the timer."""
+        if not self.isVisible():
+            return
+        now = time.perf_counter()
+        bins = max(int(self.plot_widget.width()), 1)
+        for buffer, curve in self.traces.values():
+            times, values = buffer.since(now - self.window_seconds)
+            times, values = minmax_decimate(times, values, bins)
+            curve.setData(times - now, values)
+
+
 if __name__ == '__main__':
     import sys
     import random
@@ -64,7 +172,14 @@ if __name__ == '__main__':
         def __init__(self):
             super().__init__()
             self.plot = FourQuadrantPlot("Test Plot")
-            self.setCentralWidget(self.plot)
+            self.history = HistoryPlot("Test History", window_seconds=5.0)
+            self.history.add_trace("x", 'r')
+            self.history.add_trace("y", 'g')
+            central = QWidget()
+            layout = QVBoxLayout(central)
+            layout.addWidget(self.plot)
+            layout.addWidget(self.history)
+            self.setCentralWidget(central)
             
             self.timer = QTimer()
             self.timer.setInterval(50) # Update every 50ms
@@ -75,6 +190,8 @@ if __name__ == '__main__':
             x = random.uniform(-1, 1)
             y = random.uniform(-1, 1)
             self.plot.update_point(x, y)
+            self.history.append("x", x)
+            self.history.append("y", y)
 
     app = QApplication(sys.argv)
     window = TestWindow()
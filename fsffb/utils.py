@@ -124,4 +124,73 @@ class LowPassFilter:
         # alpha = dt / (time_constant + dt)
         alpha = dt / (self.time_constant + dt)
         self.filtered_value = alpha * input_value + (1 - alpha) * self.filtered_value
-        return self.filtered_value 
\ No newline at end of file
+        return self.filtered_value
+
+
+class DependentComputation:
+    """
+    Caches the result of a computation on telemetry and reruns it only when one of
+    its declared inputs changed beyond its tolerance since the inputs of the last run.
+    Parameters are not compared per frame: invalidate(name) forces a rerun when a
+    declared parameter is updated.
+    """
+    def __init__(self, function, channels=None, params=()):
+        """
+        Args:
+            function (callable): Called as function(telem, *args, p).
+            channels (dict): Telemetry key -> absolute tolerance (0 = any change reruns).
+                             Lists compare element by element.
+            params (iterable): Parameter names the result depends on.
+        """
+        self.function = function
+        self.keys = list(channels or {})
+        self.tolerances = [(channels or {})[key] for key in self.keys]
+        self.params = set(params)
+        self.runs = 0
+        self.hits = 0
+        self._valid = False
+        self._generation = 0  # Bumped by invalidate(): a run only validates the result if unchanged
+        self._values = None
+        self._args = None
+        self._result = None
+
+    def invalidate(self, param=None):
+        """Forces a rerun if `param` is one of the declared parameters (or is None)."""
+        if param is None or param in self.params:
+            self._valid = False
+            self._generation += 1
+
+    def _unchanged(self, values):
+        """True if every value is within its tolerance of the value of the last run."""
+        for value, last, tolerance in zip(values, self._values, self.tolerances):
+            if value is last or value == last:
+                continue
+            if not tolerance or value is None or last is None:
+                return False
+            if isinstance(value, (list, tuple)):
+                if not (isinstance(last, (list, tuple)) and len(value) == len(last)
+                        and all(abs(a - b) <= tolerance for a, b in zip(value, last))):
+                    return False
+            else:
+                try:
+                    if abs(value - last) > tolerance:
+                        return False
+                except TypeError:
+                    return False
+        return True
+
+    def __call__(self, telem, *args):
+        """Returns the cached result, or reruns with (telem, *args) when an input changed."""
+        get = telem.get
+        values = [get(key) for key in self.keys]
+        inputs = args[:-1]  # The scaled parameters (last) are covered by invalidate()
+        if self._valid and inputs == self._args and (values == self._values or self._unchanged(values)):
+            self.hits += 1
+            return self._result
+        generation = self._generation
+        self._result = self.function(telem, *args)
+        self._values = values
+        self._args = inputs
+        self._valid = generation == self._generation
+        self.runs += 1
+        return self._result
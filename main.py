@@ -22,6 +22,7 @@ It initializes all the necessary managers and controllers and runs the main loop
 """
 
 import sys
+import copy
 import logging
 import argparse
 from queue import Queue, Empty
@@ -34,9 +35,23 @@ from fsffb.ui.main_window import MainWindow
 from fsffb.core.aircraft import get_aircraft_params, save_current_as_preset
 from fsffb.telemetry.msfs_manager import MSFSManager
 from fsffb.telemetry.xplane_manager import XPlaneManager
-from fsffb.hardware.joystick_manager import JoystickManager
+from fsffb.hardware.device_manager import DeviceManager, DeviceConfig, IDLE_EFFECTS
+from fsffb.hardware.hid_recorder import HidRecorder
 from fsffb.core.ffb_calculator import FFBCalculator
 from fsffb.hardware.simulator_controller import SimulatorController
+from fsffb.scheduling import (apply_thread_scheduling, parse_cpu_list, cpu_mask, JitterHistogram, FlowMeter,
+                              StageBudget, PRIORITIES, STAGE_LOW)
+
+# How often the FFB loop jitter histogram is written to the log (seconds)
+JITTER_REPORT_INTERVAL = 30.0
+
+# UI updates of the backend loop: (priority, initial cost estimate in seconds), run after
+# the force output and only if they fit before the frame deadline
+BACKEND_STAGES = {
+    'ui_telemetry': (STAGE_LOW, 50e-6),
+    'ui_plots': (STAGE_LOW, 50e-6),
+    'ui_debug': (STAGE_LOW, 50e-6),
+}
 
 class BackendThread(QThread):
     """
@@ -47,20 +62,42 @@ class BackendThread(QThread):
     debug_data_updated = pyqtSignal(dict)
     params_updated = pyqtSignal(dict)  # Signal when parameters are updated
 
-    def __init__(self, simulator_type, params_config):
+    def __init__(self, simulator_type, params_config, scheduling=None, xplane_link=None, devices=None,
+                 flow_control=None, hid_record_path=None, frame_budget_ms=8.0):
         super().__init__()
         self.simulator_type = simulator_type
-        self.params_config = params_config
+        # Own copy, the UI's dict is not shared across threads
+        self.params_config = copy.deepcopy(params_config)
+        # Thread priority / affinity: {'priority': ..., 'cpus': [...]} for the compute, HID and plugin I/O threads
+        self.scheduling = scheduling or {}
+        self.effective_scheduling = None
+        self.jitter_histogram = JitterHistogram()
+        # X-Plane remote mode: {'sim_host': ..., 'telemetry_port': ..., 'command_port': ...}
+        self.xplane_link = xplane_link or {}
+        # FFB devices (DeviceConfig list), default a single stick
+        self.device_configs = devices
+        # X-Plane send rate flow control: {'flow_min_hz': ..., 'flow_max_hz': ...}, None to disable
+        self.flow_control = flow_control
+        self.flow_meter = FlowMeter()
+        # Time from a frame's arrival to its deadline; frames that waited longer only get critical work
+        self.frame_budget = frame_budget_ms / 1000.0 if frame_budget_ms else None
+        self.stage_budget = StageBudget(BACKEND_STAGES)
+        # HID traffic and telemetry frame arrivals, see fsffb.tools.hid_analyzer
+        self.hid_recorder = HidRecorder(hid_record_path) if hid_record_path else None
+        self._frames_received = 0
         self.telemetry_queue = Queue()
         self.event_queue = Queue()
-        self.joystick = None
+        self.devices = None
         self.telemetry_manager = None
         self.ffb_calculator = None
         self.simulator_controller = None
         self._quit = False
 
     def _telemetry_callback(self, data):
-        self.telemetry_queue.put(data)
+        if self.hid_recorder:
+            self._frames_received += 1
+            self.hid_recorder.frame(self._frames_received)
+        self.telemetry_queue.put((time.perf_counter(), data))
 
     def _event_callback(self, event, *args):
         self.event_queue.put((event, args))
@@ -68,13 +105,17 @@ class BackendThread(QThread):
     def run(self):
         logging.info(f"Backend thread started for {self.simulator_type.upper()}")
 
+        if self.scheduling:
+            self.effective_scheduling = apply_thread_scheduling(
+                "backend", self.scheduling.get('priority', 'normal'), self.scheduling.get('cpus'))
+
         if self.simulator_type == 'msfs':
             self.telemetry_manager = MSFSManager(self._telemetry_callback, self._event_callback)
         elif self.simulator_type == 'xplane':
-            self.telemetry_manager = XPlaneManager(self._telemetry_callback, self._event_callback)
+            self.telemetry_manager = XPlaneManager(self._telemetry_callback, self._event_callback, **self.xplane_link)
         
-        self.joystick = JoystickManager()
-        # No longer exit if joystick is not connected initially
+        self.devices = DeviceManager(self.device_configs, scheduling=self.scheduling, recorder=self.hid_recorder)
+        # No longer exit if no device is connected initially
             
         self.simulator_controller = SimulatorController(self.telemetry_manager)
         # Initialize the calculator immediately with the default params
@@ -82,7 +123,22 @@ class BackendThread(QThread):
 
         self.telemetry_manager.start()
 
+        self._sync_plugin_settings()
+
+        if self.scheduling and self.simulator_type == 'xplane':
+            # The plugin reports the effective settings of its I/O thread in a THREAD reply
+            self.telemetry_manager.configure_plugin(
+                io_priority=self.scheduling.get('priority', 'normal'),
+                io_affinity=cpu_mask(self.scheduling.get('cpus')))
+
+        if self.simulator_type == 'xplane':
+            if self.flow_control:
+                self.telemetry_manager.configure_plugin(flow_control=1, **self.flow_control)
+            else:
+                self.telemetry_manager.configure_plugin(flow_control=0)
+
         last_telemetry_time = time.time()
+        last_jitter_report = time.time()
         is_game_paused = False
 
         while not self._quit:
@@ -93,70 +149,106 @@ class BackendThread(QThread):
             except Empty:
                 pass
 
-            # If joystick is not connected, skip telemetry processing
-            if not self.joystick.is_connected:
+            # If no device is connected, skip telemetry processing
+            if not self.devices.is_connected:
                 time.sleep(1) # Wait a bit before checking again
                 continue
 
-            # Process telemetry
+            # Process telemetry, waking up as soon as a frame arrives
             try:
-                telemetry_data = self.telemetry_queue.get_nowait()
-                self.telemetry_updated.emit(telemetry_data)
+                received, telemetry_data = self.telemetry_queue.get(timeout=0.01)
+                frame_start = time.perf_counter()
+                deadline = received + self.frame_budget if self.frame_budget else None
                 last_telemetry_time = time.time()
 
                 if is_game_paused:
                     logging.info("Game resumed, restoring FFB.")
                     is_game_paused = False
                 
-                joystick_axes = self.joystick.read_axes()
+                joystick_axes = self.devices.read_axes()
                 # Now receives offsets directly from the main processing call
                 ffb_effects, sim_axes, virtual_offsets = self.ffb_calculator.process_frame(
-                    telemetry_data, joystick_axes
+                    telemetry_data, joystick_axes, deadline
                 )
                 
-                self.joystick.apply_effects(ffb_effects)
+                self.devices.apply_effects(ffb_effects)
                 self.simulator_controller.send_axis_data(sim_axes)
+                self.jitter_histogram.tick(time.perf_counter())
+
+                if last_telemetry_time - last_jitter_report > JITTER_REPORT_INTERVAL:
+                    logging.info(self.jitter_histogram.format("FFB output period"))
+                    if hasattr(self.telemetry_manager, 'get_link_stats'):
+                        logging.info(f"X-Plane link: {self.telemetry_manager.get_link_stats()}")
+                    logging.info(f"FFB devices: {self.devices.get_stats()}")
+                    logging.info(f"Frame stages: {self.ffb_calculator.get_stage_stats()}, "
+                                 f"UI: {self.stage_budget.get_stats()}")
+                    self.jitter_histogram.reset()
+                    last_jitter_report = last_telemetry_time
+
+                # UI updates come after the force output and are dropped when the frame is late
+                budget = self.stage_budget
+                budget.run('ui_telemetry', deadline, None, self.telemetry_updated.emit, telemetry_data)
 
                 # Emit data for plots using the received offsets
                 sim_axes_for_plots = sim_axes if sim_axes is not None else {}
-                self.plots_updated.emit(
-                    joystick_axes,
-                    virtual_offsets,
-                    ffb_effects.get('constant_force', {}),
-                    sim_axes_for_plots
-                )
-                
-                debug_data = self.ffb_calculator.get_debug_data()
-                self.debug_data_updated.emit(debug_data)
+                budget.run('ui_plots', deadline, None, self.plots_updated.emit,
+                           joystick_axes,
+                           virtual_offsets,
+                           ffb_effects.get('constant_force', {}),
+                           sim_axes_for_plots)
+
+                budget.run('ui_debug', deadline, None,
+                           lambda: self.debug_data_updated.emit(self.ffb_calculator.get_debug_data()))
+
+                # Report the achieved rate and capacity for the plugin's send rate flow control
+                now = time.perf_counter()
+                self.flow_meter.frame_done(now, now - frame_start)
+                flow = self.flow_meter.poll(now)
+                if flow and self.flow_control and self.simulator_type == 'xplane':
+                    self.telemetry_manager.report_flow(flow[0], self.telemetry_queue.qsize(), flow[1])
 
             except Empty:
                 # Check for game pause state (no telemetry for > 1 second)
                 if not is_game_paused and (time.time() - last_telemetry_time > 1.0):
                     logging.info("Game paused, applying idle FFB effects.")
                     is_game_paused = True
-                    self.joystick.stop_all_effects()
-                    paused_effects = {
-                        'spring_x': {'coefficient': 0.3, 'cp_offset': 0},
-                        'spring_y': {'coefficient': 0.3, 'cp_offset': 0},
-                        'constant_force': {'magnitude': 0, 'direction': 0}
-                    }
-                    self.joystick.apply_effects(paused_effects)
-                
-                time.sleep(0.01)
+                    self.jitter_histogram.reset()
+                    self.devices.stop_all_effects()
+                    self.devices.apply_effects(IDLE_EFFECTS)
         
         # Shutdown
         if self.telemetry_manager: self.telemetry_manager.quit()
-        if self.joystick: self.joystick.close()
+        if self.devices: self.devices.close()
+        if self.hid_recorder: self.hid_recorder.close()
         logging.info("Backend thread finished.")
 
+    def _sync_plugin_settings(self):
+        """Sends the parameters the X-Plane plugin applies itself (force passthrough, prediction)."""
+        if self.simulator_type != 'xplane' or not self.telemetry_manager:
+            return
+        p = {name: config['value'] for name, config in self.params_config.items()}
+        self.telemetry_manager.configure_plugin(
+            force_passthrough=int(bool(p['xp_force_passthrough'])),
+            force_full_scale_lb=p['xp_force_full_scale'],
+            force_filter_hz=p['xp_force_filter_hz'])
+
+        # Channels the calculator can take predicted instead of actual (see FFBCalculator._input)
+        horizon = p['xp_predict_horizon_ms']
+        self.telemetry_manager.set_prediction(
+            horizon_ms=horizon,
+            G='quadratic' if horizon and p['xp_predict_g_force'] else 'off',
+            AoA='linear' if horizon and p['xp_predict_aoa'] else 'off')
+
     def update_parameter(self, name, value):
         """Slot to receive parameter changes from the UI."""
+        if name in self.params_config:
+            self.params_config[name]['value'] = value
         if self.ffb_calculator:
+            # Queued, the calculator applies it before its next frame
             self.ffb_calculator.update_parameter(name, value)
-            # Also update our local params_config
-            if name in self.params_config:
-                self.params_config[name]['value'] = value
             logging.info(f"Updated parameter '{name}' to {value}")
+            if name.startswith(('xp_force_', 'xp_predict_')):
+                self._sync_plugin_settings()
 
     def load_preset(self, preset_name):
         """Load a preset and update the FFB calculator."""
@@ -170,6 +262,7 @@ class BackendThread(QThread):
             
             # Update our local params_config
             self.params_config = new_params
+            self._sync_plugin_settings()
             
             # Emit signal to update UI
             self.params_updated.emit(new_params)
@@ -199,8 +292,68 @@ def main():
         choices=['msfs', 'xplane'],
         help="The flight simulator you are running (defaults to 'msfs' if not specified)."
     )
+    parser.add_argument(
+        '--priority',
+        default='normal',
+        choices=PRIORITIES,
+        help="Scheduling priority of the FFB compute, HID and plugin I/O threads. "
+             "'realtime' falls back to 'high' when not permitted."
+    )
+    parser.add_argument(
+        '--cpus',
+        default='',
+        help="CPUs to pin the real-time threads to, e.g. '2,3' or '2-3' (default: no restriction)."
+    )
+    parser.add_argument(
+        '--xplane-host',
+        default=None,
+        help="Host running X-Plane when the plugin is in remote mode (remote_host in FSFFB_Config.txt)."
+    )
+    parser.add_argument('--telemetry-port', type=int, default=34390, help="X-Plane telemetry port (default 34390).")
+    parser.add_argument('--command-port', type=int, default=34391, help="X-Plane plugin command port (default 34391).")
+    parser.add_argument(
+        '--device',
+        action='append',
+        metavar='ROLE:VID:PID[:SERIAL]',
+        help="FFB device to drive, repeat for several, e.g. --device stick:ffff:2055 --device pedals:ffff:2060 "
+             "(roles: stick, pedals, collective; default: one stick ffff:2055)."
+    )
+    parser.add_argument(
+        '--flow-hz',
+        default='off',
+        metavar='MIN-MAX',
+        help="Adapt the X-Plane send rate to the backend's capacity within these bounds, e.g. 20-0 "
+             "(0 = sim frame rate). Default 'off': the plugin sends at its fixed rate."
+    )
+    parser.add_argument('--record', metavar='FILE', help="Record the X-Plane telemetry to FILE for offline analysis.")
+    parser.add_argument('--frame-budget-ms', type=float, default=8.0,
+                        help="Time from a telemetry frame's arrival by which its forces should be out (default 8). "
+                             "Vibrations and UI updates are skipped for frames that would miss it; 0 = never skip.")
+    parser.add_argument('--record-hid', metavar='FILE',
+                        help="Record the HID reports sent to and read from the FFB devices to FILE (fsffb/tools/hid_analyzer.py).")
+    parser.add_argument('--archive', metavar='FILE',
+                        help="Archive the X-Plane telemetry frames to FILE, compressed by channel (fsffb/telemetry/archive.py).")
     args = parser.parse_args()
 
+    # Validate the options before any window opens
+    scheduling = None
+    if args.priority != 'normal' or args.cpus:
+        try:
+            scheduling = {'priority': args.priority, 'cpus': parse_cpu_list(args.cpus)}
+        except ValueError:
+            parser.error(f"--cpus expects a list such as '2,3' or '2-3', got {args.cpus!r}")
+    try:
+        devices = [DeviceConfig.parse(device) for device in args.device] if args.device else None
+    except ValueError as e:
+        parser.error(f"--device: {e}")
+    flow_control = None
+    if args.flow_hz != 'off':
+        try:
+            flow_min, flow_max = args.flow_hz.split('-', 1)
+            flow_control = {'flow_min_hz': float(flow_min), 'flow_max_hz': float(flow_max)}
+        except ValueError:
+            parser.error(f"--flow-hz expects MIN-MAX or 'off', got {args.flow_hz!r}")
+
     logging.basicConfig(level=logging.INFO, format='%(asctime)s - %(levelname)s - %(message)s')
     
     app = QApplication(sys.argv)
@@ -213,7 +366,12 @@ def main():
     window = MainWindow(params_config)
     
     # Create and start the backend thread
-    backend = BackendThread(simulator_type=args.simulator, params_config=params_config)
+    xplane_link = {'sim_host': args.xplane_host, 'telemetry_port': args.telemetry_port, 'command_port': args.command_port,
+                   'record_path': args.record, 'archive_path': args.archive}
+    backend = BackendThread(simulator_type=args.simulator, params_config=params_config,
+                            scheduling=scheduling, xplane_link=xplane_link, devices=devices,
+                            flow_control=flow_control, hid_record_path=args.record_hid,
+                            frame_budget_ms=args.frame_budget_ms)
     
     # Connect signals from backend to slots in UI
     backend.telemetry_updated.connect(window.update_telemetry_display)
@@ -0,0 +1,32 @@
+#
+# This program is largely based on the TelemFFB distribution (https://github.com/walmis/TelemFFB).
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, version 3.
+#
+# This program is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+# General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <http://www.gnu.org/licenses/>.
+#
+
+"""
+FSFFB tests, run from the repository root with:
+
+    python -m unittest      (or: python -m pytest tests)
+
+The hardware tests drive a StubHidDevice, so hidapi is not needed; when it is
+not installed an empty `hid` module stands in for it.
+"""
+
+import sys
+import types
+
+try:
+    import hid  # noqa: F401
+except ImportError:
+    sys.modules['hid'] = types.ModuleType('hid')
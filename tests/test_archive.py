@@ -0,0 +1,169 @@
+#
+# This program is largely based on the TelemFFB distribution (https://github.com/walmis/TelemFFB).
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, version 3.
+#
+# This program is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+# General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <http://www.gnu.org/licenses/>.
+#
+
+"""Tests of the telemetry archive: column codecs, round trip and interrupted files."""
+
+import os
+import math
+import logging
+import tempfile
+import unittest
+
+import numpy as np
+
+from fsffb.telemetry.archive import (
+    ArchiveWriter, ArchiveReader, encode_column, decode_column, ARCHIVE_END)
+
+CHUNK_FRAMES = 50
+FRAMES = 230
+
+
+def make_frame(i):
+    t = i / 60.0
+    frame = {
+        'IAS': round(80 + 10 * math.sin(t), 2),         # Fixed precision: 'decN' encoding
+        'AoA': 3 * math.sin(t / 3) + 1e-9 * i,          # Full precision: 'xor' encoding
+        'AccBody': [0.1 * math.sin(t), 1.0, -0.25 * i],
+        'SimOnGround': 1 if i < 100 else 0,
+        'SurfaceType': 'Asphalt' if i < 150 else 'Grass',
+    }
+    if i % 3 == 0:
+        frame['Flaps'] = 0.5                            # Channel missing from some frames
+    return frame
+
+
+def decode(values):
+    encoding, control, payload = encode_column(np.asarray(values, dtype=np.float64))
+    return encoding, decode_column(encoding, np.frombuffer(control, np.uint8), np.frombuffer(payload, np.uint8))
+
+
+class TestColumnCodecs(unittest.TestCase):
+
+    def test_decimal_column_round_trip(self):
+        values = np.round(np.linspace(-50, 50, 500) ** 2 / 7, 3)
+        encoding, decoded = decode(values)
+        self.assertEqual(encoding, 'dec3')
+        np.testing.assert_array_equal(decoded, values)
+
+    def test_float_column_round_trip_is_bit_exact(self):
+        values = np.sin(np.linspace(0, 20, 500)) * 1e3
+        values[10] = np.nan
+        values[11] = np.inf
+        values[12] = -0.0
+        encoding, decoded = decode(values)
+        self.assertEqual(encoding, 'xor')
+        np.testing.assert_array_equal(decoded.view(np.uint64), values.view(np.uint64))
+
+    def test_constant_column_compresses(self):
+        control, payload = encode_column(np.full(1000, 42.125))[1:]
+        self.assertLess(len(control) + len(payload), 1100)
+
+
+class TestArchive(unittest.TestCase):
+
+    def setUp(self):
+        self.directory = tempfile.TemporaryDirectory()
+        self.addCleanup(self.directory.cleanup)
+        self.path = os.path.join(self.directory.name, 'flight.fsfa')
+        self.frames = [make_frame(i) for i in range(FRAMES)]
+        self.times = [i / 60.0 for i in range(FRAMES)]
+
+    def write(self, close=True):
+        writer = ArchiveWriter(self.path, chunk_frames=CHUNK_FRAMES)
+        for frame, t in zip(self.frames, self.times):
+            writer.append(frame, t)
+        if close:
+            writer.close()
+        else:
+            writer._file.close()  # Interrupted: the last partial chunk and the index are never written
+        return writer
+
+    def test_round_trip(self):
+        self.write()
+        with ArchiveReader(self.path) as reader:
+            self.assertEqual(len(reader.chunks), math.ceil(FRAMES / CHUNK_FRAMES))
+            self.assertEqual(reader.channels, ['AccBody', 'AoA', 'Flaps', 'IAS', 'SimOnGround', 'SurfaceType'])
+            self.assertEqual(reader.time_range, (self.times[0], self.times[-1]))
+
+            times, ias = reader.read('IAS')
+            np.testing.assert_array_equal(times, self.times)
+            np.testing.assert_array_equal(ias, [f['IAS'] for f in self.frames])
+            np.testing.assert_array_equal(reader.read('AoA')[1], [f['AoA'] for f in self.frames])
+            np.testing.assert_array_equal(reader.read('AccBody')[1], [f['AccBody'] for f in self.frames])
+            self.assertEqual(reader.read('SurfaceType')[1], [f['SurfaceType'] for f in self.frames])
+
+            flaps = reader.read('Flaps')[1]
+            np.testing.assert_array_equal(np.isnan(flaps), [i % 3 != 0 for i in range(FRAMES)])
+            self.assertTrue(np.all(flaps[::3] == 0.5))
+
+    def test_time_range_read(self):
+        self.write()
+        with ArchiveReader(self.path) as reader:
+            times, values = reader.read('SimOnGround', self.times[90], self.times[120])
+            np.testing.assert_array_equal(times, self.times[90:121])
+            np.testing.assert_array_equal(values, [f['SimOnGround'] for f in self.frames[90:121]])
+            self.assertEqual(len(reader._chunks_in(self.times[90], self.times[120])), 2)
+
+    def test_missing_channel_and_empty_range(self):
+        self.write()
+        with ArchiveReader(self.path) as reader:
+            times, values = reader.read('Nope')
+            self.assertEqual(len(times), FRAMES)
+            self.assertTrue(np.all(np.isnan(values)))
+            times, values = reader.read('IAS', 1000.0, 2000.0)
+            self.assertEqual(len(times), 0)
+            self.assertEqual(len(values), 0)
+
+    def test_interrupted_archive_keeps_the_complete_chunks(self):
+        self.write(close=False)
+        with self.assertLogs(level=logging.WARNING):
+            reader = ArchiveReader(self.path)
+        with reader:
+            complete = FRAMES // CHUNK_FRAMES * CHUNK_FRAMES
+            times, ias = reader.read('IAS')
+            np.testing.assert_array_equal(times, self.times[:complete])
+            np.testing.assert_array_equal(ias, [f['IAS'] for f in self.frames[:complete]])
+
+    def test_truncated_archive_drops_the_cut_chunk(self):
+        self.write()
+        with open(self.path, 'rb') as f:
+            data = f.read()
+        with ArchiveReader(self.path) as reader:
+            data_starts = [chunk['base'] for chunk in reader.chunks]
+        # Cut inside the index, inside the last chunk's data, then inside the third chunk's header
+        for cut, chunks in ((len(data) - len(ARCHIVE_END) - 20, len(data_starts)),
+                            (data_starts[-1] + 10, len(data_starts) - 1),
+                            (data_starts[2] - 20, 2)):
+            with self.subTest(cut=cut):
+                with open(self.path, 'wb') as f:
+                    f.write(data[:cut])
+                with self.assertLogs(level=logging.WARNING):
+                    reader = ArchiveReader(self.path)
+                with reader:
+                    self.assertEqual(len(reader.chunks), chunks)
+                    times, ias = reader.read('IAS')
+                    np.testing.assert_array_equal(ias, [f['IAS'] for f in self.frames[:len(times)]])
+                    self.assertEqual(len(times), min(chunks * CHUNK_FRAMES, FRAMES))
+
+    def test_not_an_archive(self):
+        with open(self.path, 'wb') as f:
+            f.write(b"something else")
+        with self.assertRaises(ValueError):
+            ArchiveReader(self.path)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,92 @@
+#
+# This program is largely based on the TelemFFB distribution (https://github.com/walmis/TelemFFB).
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, version 3.
+#
+# This program is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+# General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <http://www.gnu.org/licenses/>.
+#
+
+"""Tests of the bench_calculator baseline comparison."""
+
+import io
+import os
+import json
+import tempfile
+import unittest
+from contextlib import redirect_stdout
+
+from fsffb.tools import bench_calculator
+from fsffb.tools.bench_calculator import find_regressions
+
+BENCH_ARGS = ['--frames', '60', '--repeats', '1']
+
+
+class TestFindRegressions(unittest.TestCase):
+
+    def test_slowdown_beyond_the_tolerance(self):
+        results = {'a': {'us': 1.3}, 'b': {'us': 1.2}, 'c': {'us': 0.5}}
+        baseline = {'a': {'us': 1.0}, 'b': {'us': 1.0}, 'c': {'us': 1.0}}
+        self.assertEqual(find_regressions(results, baseline, 0.25), ['a'])
+        self.assertEqual(find_regressions(results, baseline, 0.1), ['a', 'b'])
+
+    def test_benchmarks_missing_from_either_side_are_ignored(self):
+        results = {'new': {'us': 100.0}, 'a': {'us': 1.0}}
+        baseline = {'a': {'us': 1.0}, 'removed': {'us': 0.001}}
+        self.assertEqual(find_regressions(results, baseline, 0.0), [])
+
+
+class TestCompare(unittest.TestCase):
+
+    def setUp(self):
+        self.directory = tempfile.TemporaryDirectory()
+        self.addCleanup(self.directory.cleanup)
+        self.baseline = os.path.join(self.directory.name, 'baseline.json')
+
+    def run_main(self, *argv):
+        with redirect_stdout(io.StringIO()) as out:
+            status = bench_calculator.main(BENCH_ARGS + list(argv))
+        return status, out.getvalue()
+
+    def rewrite_baseline(self, factor):
+        with open(self.baseline) as f:
+            results = json.load(f)
+        for result in results.values():
+            result['us'] *= factor
+        with open(self.baseline, 'w') as f:
+            json.dump(results, f)
+
+    def test_save_writes_every_benchmark(self):
+        status, _ = self.run_main('--save', self.baseline)
+        self.assertEqual(status, 0)
+        with open(self.baseline) as f:
+            results = json.load(f)
+        self.assertIn('process_frame', results)
+        for result in results.values():
+            self.assertGreater(result['us'], 0.0)
+            self.assertIn('alloc_bytes', result)
+
+    def test_compare_against_a_slower_baseline_passes(self):
+        self.run_main('--save', self.baseline)
+        self.rewrite_baseline(100.0)
+        status, out = self.run_main('--compare', self.baseline)
+        self.assertEqual(status, 0)
+        self.assertNotIn("Slower than the baseline", out)
+
+    def test_compare_against_a_faster_baseline_fails(self):
+        self.run_main('--save', self.baseline)
+        self.rewrite_baseline(0.01)
+        status, out = self.run_main('--compare', self.baseline)
+        self.assertEqual(status, 1)
+        self.assertIn("Slower than the baseline: _get_scaled_params", out)
+
+
+if __name__ == '__main__':
+    unittest.main()
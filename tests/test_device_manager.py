@@ -0,0 +1,153 @@
+#
+# This program is largely based on the TelemFFB distribution (https://github.com/walmis/TelemFFB).
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, version 3.
+#
+# This program is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+# General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <http://www.gnu.org/licenses/>.
+#
+
+"""Tests of the calculator outputs for pedals and collective and their routing to devices."""
+
+import time
+import unittest
+from unittest import mock
+
+from fsffb.core.aircraft import get_aircraft_params
+from fsffb.core.ffb_calculator import FFBCalculator
+from fsffb.hardware.stub_device import StubHidDevice
+from fsffb.hardware.device_manager import DeviceManager, DeviceConfig, ROLE_ROUTES, IDLE_EFFECTS
+from fsffb.tools.hid_analyzer import decode_report
+
+TELEMETRY = {'src': 'XPLANE', 'IAS': 90.0, 'DynPressure': 0.5 * 1.225 * 46.0 ** 2, 'AirDensity': 1.225,
+             'AoA': 3.0, 'StallAoA': 15.0, 'SideSlip': 0.0, 'G': 1.0, 'Vne': 160.0, 'SimOnGround': 0,
+             'RudderTrimPct': 0.1}
+
+SLOT_SPRING, SLOT_DAMPER, SLOT_FRICTION = 1, 9, 11
+
+
+def conditions(device):
+    """Coefficients of the SetCondition reports written to `device`: [(slot, axis, coefficient)]."""
+    written = []
+    for data in device.reports:
+        name, fields = decode_report(data)
+        if name == 'SetCondition':
+            written.append((fields['slot'], fields['parameterBlockOffset'], fields['positiveCoefficient']))
+    return written
+
+
+class TestCalculatorOutputs(unittest.TestCase):
+
+    def setUp(self):
+        self.calc = FFBCalculator(get_aircraft_params("default"))
+
+    def test_every_routed_effect_is_produced(self):
+        effects, _, _ = self.calc.process_frame(TELEMETRY, {'jx': 0, 'jy': 0, 'px': 0, 'cy': 0})
+        for role, route in ROLE_ROUTES.items():
+            for calc_name in (route['effects'] or {}).values():
+                if not calc_name.startswith('runway_rumble'):  # On the ground only
+                    with self.subTest(role=role, effect=calc_name):
+                        self.assertIn(calc_name, effects)
+
+    def test_pedal_effects(self):
+        effects, _, _ = self.calc.process_frame(TELEMETRY, {'jx': 0, 'jy': 0, 'px': 0})
+        self.assertGreater(effects['spring_rudder']['coefficient'], 0)
+        self.assertAlmostEqual(effects['spring_rudder']['cp_offset'], 0.1)
+        self.assertGreater(effects['damper_rudder']['coef_x'], 0)
+        self.assertNotIn('spring_collective', effects)
+
+    def test_rudder_spring_follows_airspeed(self):
+        slow = dict(TELEMETRY, DynPressure=TELEMETRY['DynPressure'] / 4)
+        fast, _, _ = self.calc.process_frame(TELEMETRY, {'px': 0})
+        slow, _, _ = self.calc.process_frame(slow, {'px': 0})
+        self.assertLess(slow['spring_rudder']['coefficient'], fast['spring_rudder']['coefficient'])
+
+    def test_collective_effects(self):
+        effects, _, _ = self.calc.process_frame(TELEMETRY, {'jx': 0, 'jy': 0, 'cy': 0})
+        self.assertGreater(effects['friction_collective']['coef_y'], 0)
+        self.assertIn('spring_collective', effects)
+        self.assertNotIn('spring_rudder', effects)
+
+    def test_stick_only(self):
+        effects, _, _ = self.calc.process_frame(TELEMETRY, {'jx': 0, 'jy': 0})
+        for name in ('spring_rudder', 'damper_rudder', 'spring_collective', 'friction_collective'):
+            self.assertNotIn(name, effects)
+
+
+class TestDeviceConfig(unittest.TestCase):
+
+    def test_parse(self):
+        config = DeviceConfig.parse("pedals:ffff:2060:ABC")
+        self.assertEqual((config.role, config.vendor_id, config.product_id, config.serial),
+                         ('pedals', 0xFFFF, 0x2060, 'ABC'))
+
+    def test_parse_rejects_bad_devices(self):
+        for text in ("pedals:ffff", "rudder:ffff:2060", "pedals:ffff:xyz"):
+            with self.subTest(text=text), self.assertRaises(ValueError):
+                DeviceConfig.parse(text)
+
+
+class TestRouting(unittest.TestCase):
+
+    def setUp(self):
+        self.stubs = {role: StubHidDevice() for role in ('stick', 'pedals', 'collective')}
+        self.manager = DeviceManager([DeviceConfig(role, role=role, device=stub) for role, stub in self.stubs.items()])
+        self.addCleanup(self.manager.close)
+        self.calc = FFBCalculator(get_aircraft_params("default"))
+
+    def apply(self, effects):
+        before = {name: stats['applied'] for name, stats in self.manager.get_stats().items()}
+        self.manager.apply_effects(effects)
+        deadline = time.monotonic() + 5.0
+        while any(stats['applied'] <= before[name] for name, stats in self.manager.get_stats().items()):
+            self.assertLess(time.monotonic(), deadline, "device writers did not apply the frame")
+            time.sleep(0.001)
+
+    def test_axes_are_renamed_by_role(self):
+        self.assertEqual(set(self.manager.read_axes()), {'jx', 'jy', 'px', 'cy'})
+
+    def test_calculator_effects_reach_their_devices(self):
+        effects, _, _ = self.calc.process_frame(TELEMETRY, self.manager.read_axes())
+        self.apply(effects)
+
+        pedals = conditions(self.stubs['pedals'])
+        rudder = int(effects['spring_rudder']['coefficient'] * 4096)
+        self.assertGreater(rudder, 0)
+        self.assertIn((SLOT_SPRING, 0, rudder), pedals)
+        self.assertIn((SLOT_DAMPER, 0, int(effects['damper_rudder']['coef_x'] * 4096)), pedals)
+        self.assertFalse(any(slot == SLOT_FRICTION for slot, _, _ in pedals))
+
+        collective = conditions(self.stubs['collective'])
+        self.assertIn((SLOT_FRICTION, 1, int(effects['friction_collective']['coef_y'] * 4096)), collective)
+        self.assertFalse(any(slot == SLOT_DAMPER for slot, _, _ in collective))
+
+        # The stick gets its own springs, not the rudder's
+        stick = conditions(self.stubs['stick'])
+        self.assertIn((SLOT_SPRING, 0, int(effects['spring_x']['coefficient'] * 4096)), stick)
+
+    def test_idle_effects_hold_every_device(self):
+        self.apply(IDLE_EFFECTS)
+        self.assertIn((SLOT_SPRING, 0, int(0.3 * 4096)), conditions(self.stubs['pedals']))
+        self.assertIn((SLOT_FRICTION, 1, int(0.3 * 4096)), conditions(self.stubs['collective']))
+
+    def test_writer_survives_an_error(self):
+        device = self.manager.devices[0]
+        failures = [AttributeError("bad frame"), None]
+        with mock.patch.object(device.joystick, 'apply_effects', side_effect=failures) as patched:
+            with self.assertLogs(level='ERROR'):
+                self.apply(IDLE_EFFECTS)
+            self.apply(IDLE_EFFECTS)
+        self.assertTrue(device.is_alive())
+        self.assertEqual(device.stats['errors'], 1)
+        self.assertEqual(patched.call_count, 2)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,81 @@
+#
+# This program is largely based on the TelemFFB distribution (https://github.com/walmis/TelemFFB).
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, version 3.
+#
+# This program is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+# General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <http://www.gnu.org/licenses/>.
+#
+
+"""Tests of the FFBCalculator parameter updates and the DependentComputation cache."""
+
+import unittest
+
+from fsffb.core.aircraft import get_aircraft_params
+from fsffb.core.ffb_calculator import FFBCalculator
+from fsffb.utils import DependentComputation
+
+TELEMETRY = {'src': 'XPLANE', 'IAS': 90.0, 'DynPressure': 1300.0, 'AirDensity': 1.225, 'AoA': 3.0,
+             'StallAoA': 15.0, 'G': 1.0, 'Vne': 160.0, 'SimOnGround': 0}
+
+
+class TestParameterUpdates(unittest.TestCase):
+
+    def setUp(self):
+        self.config = get_aircraft_params("default")
+        self.calc = FFBCalculator(self.config)
+
+    def spring_x(self):
+        effects, _, _ = self.calc.process_frame(TELEMETRY, {'jx': 0, 'jy': 0})
+        return effects['spring_x']['coefficient']
+
+    def test_update_applies_at_the_next_frame(self):
+        before = self.spring_x()
+        self.calc.update_parameter('max_aileron_coeff', 50)
+        self.assertEqual(self.calc.params['max_aileron_coeff']['value'], 100)  # Queued only
+        self.assertAlmostEqual(self.spring_x(), before / 2)
+        self.assertEqual(self.calc.params['max_aileron_coeff']['value'], 50)
+
+    def test_the_callers_dict_is_not_shared(self):
+        self.config['max_aileron_coeff']['value'] = 0
+        self.assertGreater(self.spring_x(), 0)
+
+    def test_unknown_parameter_is_ignored(self):
+        self.calc.update_parameter('no_such_parameter', 1)
+        self.spring_x()
+        self.assertNotIn('no_such_parameter', self.calc.params)
+
+
+class TestDependentComputation(unittest.TestCase):
+
+    def test_reruns_only_beyond_the_tolerance(self):
+        computation = DependentComputation(lambda telem, p: telem['IAS'] * 2, channels={'IAS': 0.5}, params=('a',))
+        self.assertEqual(computation({'IAS': 10.0}, {}), 20.0)
+        self.assertEqual(computation({'IAS': 10.4}, {}), 20.0)
+        self.assertEqual(computation({'IAS': 11.0}, {}), 22.0)
+        self.assertEqual((computation.runs, computation.hits), (2, 1))
+        computation.invalidate('b')
+        computation({'IAS': 11.0}, {})
+        computation.invalidate('a')
+        computation({'IAS': 11.0}, {})
+        self.assertEqual((computation.runs, computation.hits), (3, 2))
+
+    def test_invalidate_during_a_run_forces_another(self):
+        def function(telem, p):
+            computation.invalidate('a')  # e.g. a parameter update while the run was in progress
+            return telem['IAS']
+        computation = DependentComputation(function, channels={'IAS': 0}, params=('a',))
+        computation({'IAS': 1.0}, {})
+        computation({'IAS': 1.0}, {})
+        self.assertEqual(computation.runs, 2)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,166 @@
+#
+# This program is largely based on the TelemFFB distribution (https://github.com/walmis/TelemFFB).
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, version 3.
+#
+# This program is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+# General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <http://www.gnu.org/licenses/>.
+#
+
+"""Tests of the HID recorder file round trip and of the HID stream analyzer."""
+
+import os
+import struct
+import tempfile
+import threading
+import unittest
+
+from fsffb.hardware.hid_recorder import (
+    HidRecorder, read_hid_recording, KIND_OUTPUT, KIND_INPUT, KIND_FRAME, REPORT_SIZE)
+from fsffb.hardware.stub_device import StubHidDevice
+from fsffb.hardware.joystick_manager import JoystickManager
+from fsffb.tools.hid_analyzer import HidAnalyzer
+
+
+def report(i):
+    return bytes([105, 2]) + struct.pack('<h', i % 30000)
+
+
+class GatedFile:
+    """A file whose writes wait until `gate` is set, to hold the flusher up."""
+
+    def __init__(self, file):
+        self.file = file
+        self.gate = threading.Event()
+
+    def write(self, data):
+        self.gate.wait()
+        return self.file.write(data)
+
+    def close(self):
+        self.file.close()
+
+
+class TestHidRecorder(unittest.TestCase):
+
+    def setUp(self):
+        self.directory = tempfile.TemporaryDirectory()
+        self.addCleanup(self.directory.cleanup)
+        self.path = os.path.join(self.directory.name, 'flight.hid')
+
+    def test_round_trip(self):
+        recorder = HidRecorder(self.path, capacity=4096)
+        expected = []
+        for i in range(3000):
+            if i % 10 == 0:
+                recorder.frame(i)
+                expected.append((KIND_FRAME, 0, struct.pack('<I', i)))
+            channel = recorder.channel(i % 3)
+            channel.output(report(i))
+            expected.append((KIND_OUTPUT, i % 3, report(i)))
+            if i % 7 == 0:
+                channel.input(bytes([1]) * 80)
+                expected.append((KIND_INPUT, i % 3, bytes([1]) * REPORT_SIZE))  # Cut to REPORT_SIZE
+        recorder.close()
+
+        records = list(read_hid_recording(self.path))
+        self.assertEqual(recorder.lost, 0)
+        self.assertEqual([record[1:] for record in records], expected)
+        times = [record[0] for record in records]
+        self.assertEqual(times, sorted(times))
+
+    def test_records_are_kept_in_order_across_flushes(self):
+        recorder = HidRecorder(self.path, capacity=64)
+        for i in range(5000):
+            recorder.output(report(i))
+        recorder.close()
+        reports = [record[3] for record in read_hid_recording(self.path)]
+        self.assertEqual(len(reports), 5000 - recorder.lost)
+        # Dropped records leave gaps, the rest stays in order
+        indices = [struct.unpack_from('<h', data, 2)[0] for data in reports]
+        self.assertEqual(indices, sorted(indices))
+
+    def test_overrun_drops_new_records_instead_of_unwritten_ones(self):
+        recorder = HidRecorder(self.path, capacity=64)
+        gated = GatedFile(recorder._file)
+        recorder._file = gated
+        for i in range(200):
+            recorder.output(report(i))
+        self.assertEqual(recorder.lost, 200 - 64)
+        gated.gate.set()
+        recorder.close()
+        reports = [record[3] for record in read_hid_recording(self.path)]
+        self.assertEqual(reports, [report(i) for i in range(64)])
+
+    def test_memory_ring_keeps_the_newest_records(self):
+        recorder = HidRecorder(capacity=100)
+        for i in range(250):
+            recorder.output(report(i))
+        recorder.dump(self.path)
+        recorder.close()
+        reports = [record[3] for record in read_hid_recording(self.path)]
+        self.assertEqual(reports, [report(i) for i in range(150, 250)])
+
+    def test_not_a_recording(self):
+        with open(self.path, 'wb') as f:
+            f.write(b"something else")
+        with self.assertRaises(ValueError):
+            list(read_hid_recording(self.path))
+
+
+class TestHidAnalyzer(unittest.TestCase):
+
+    def setUp(self):
+        self.directory = tempfile.TemporaryDirectory()
+        self.addCleanup(self.directory.cleanup)
+        self.path = os.path.join(self.directory.name, 'flight.hid')
+
+    def analyze(self, frames):
+        """Records `frames` (lists of effects) played on a stub joystick, returns the analyzer."""
+        recorder = HidRecorder(self.path)
+        joystick = JoystickManager(device=StubHidDevice(), recorder=recorder.channel(0))
+        for i, effects in enumerate(frames):
+            recorder.frame(i)
+            joystick.apply_effects(effects)
+        recorder.frame(len(frames))  # The stop reports written on close get a frame of their own
+        joystick.close()
+        recorder.close()
+        analyzer = HidAnalyzer(timeline=(0, 2))
+        for record in read_hid_recording(self.path):
+            analyzer.add(*record)
+        analyzer.finish()
+        return analyzer
+
+    def test_writes_per_frame_and_redundancy(self):
+        springs = {'spring_x': {'coefficient': 0.5, 'cp_offset': 0}, 'spring_y': {'coefficient': 0.5, 'cp_offset': 0}}
+        steady = dict(springs, constant_force={'magnitude': 0.5, 'direction': 0})
+        analyzer = self.analyze([steady] * 20)
+
+        self.assertEqual(analyzer.frames, 21)
+        self.assertEqual(len(analyzer.latencies), 21)
+        self.assertEqual(analyzer.unknown, 0)
+        # After the first frame only the two springs are written, unchanged
+        self.assertEqual(analyzer.writes_per_frame[1:20], [2] * 19)
+        springs_slot = analyzer.slots[(0, 1)]
+        self.assertEqual(springs_slot.writes, 40)
+        self.assertEqual(springs_slot.redundant, 38)
+
+        constant = analyzer.slots[(0, 2)]
+        self.assertEqual(constant.effect_type, 1)
+        self.assertEqual(constant.starts, 1)
+        self.assertEqual(constant.params['magnitude'], 2048)
+        # Timeline of slot 2: created and started in the first frame, stopped on close
+        self.assertEqual([name for _, name, _ in analyzer.timeline],
+                         ['SetEffect', 'SetConstantForce', 'EffectOperation', 'EffectOperation'])
+        self.assertFalse(constant.running)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,203 @@
+#
+# This program is largely based on the TelemFFB distribution (https://github.com/walmis/TelemFFB).
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, version 3.
+#
+# This program is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+# General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <http://www.gnu.org/licenses/>.
+#
+
+"""Tests of the HID reports JoystickManager writes per frame, on a StubHidDevice."""
+
+import unittest
+from unittest import mock
+
+from fsffb.hardware.stub_device import StubHidDevice
+from fsffb.hardware.joystick_manager import (
+    JoystickManager, HID_REPORT_ID_SET_EFFECT, HID_REPORT_ID_SET_CONSTANT_FORCE, HID_REPORT_ID_EFFECT_OPERATION,
+    HID_REPORT_ID_SET_CONDITION, HID_REPORT_ID_SET_PERIODIC, PERIODIC_POOL_SIZE, PERIODIC_MIN_HOLD,
+    PERIODIC_RELEASE_DELAY)
+
+class FailingStubDevice(StubHidDevice):
+    """A StubHidDevice whose writes raise IOError while `failing` is set."""
+
+    def __init__(self):
+        super().__init__()
+        self.failing = False
+
+    def write(self, data):
+        if self.failing:
+            raise IOError("write failed")
+        return super().write(data)
+
+
+SPRINGS = {'spring_x': {'coefficient': 0.5, 'cp_offset': 0}, 'spring_y': {'coefficient': 0.5, 'cp_offset': 0}}
+
+
+class JoystickTestCase(unittest.TestCase):
+
+    def setUp(self):
+        self.device = StubHidDevice()
+        self.joystick = JoystickManager(device=self.device)
+
+    def tearDown(self):
+        self.joystick.close()
+
+    def frame(self, effects):
+        """Applies one frame of effects, returns the reports written by report ID."""
+        self.device.clear()
+        self.joystick.apply_effects({**SPRINGS, **effects})
+        return self.device.report_counts()
+
+
+class TestConstantForce(JoystickTestCase):
+
+    def constant(self, magnitude, direction=0):
+        return {'constant_force': {'magnitude': magnitude, 'direction': direction}}
+
+    def test_first_frame_creates_and_starts_the_effect(self):
+        self.frame({})
+        counts = self.frame(self.constant(0.5))
+        self.assertEqual(counts[HID_REPORT_ID_SET_EFFECT], 1)
+        self.assertEqual(counts[HID_REPORT_ID_SET_CONSTANT_FORCE], 1)
+        self.assertEqual(counts[HID_REPORT_ID_EFFECT_OPERATION], 1)
+
+    def test_steady_force_writes_only_the_springs(self):
+        self.frame(self.constant(0.5))
+        for _ in range(10):
+            counts = self.frame(self.constant(0.5))
+            self.assertEqual(counts, {HID_REPORT_ID_SET_CONDITION: 2})
+
+    def test_change_below_one_step_is_not_written(self):
+        self.frame(self.constant(0.5))
+        counts = self.frame(self.constant(0.5 + 0.1 / 4096))
+        self.assertEqual(counts, {HID_REPORT_ID_SET_CONDITION: 2})
+
+    def test_magnitude_change_writes_the_magnitude_only(self):
+        self.frame(self.constant(0.5))
+        counts = self.frame(self.constant(0.6))
+        self.assertEqual(counts, {HID_REPORT_ID_SET_CONSTANT_FORCE: 1, HID_REPORT_ID_SET_CONDITION: 2})
+
+    def test_direction_change_writes_the_header_without_restarting(self):
+        self.frame(self.constant(0.5, 0))
+        counts = self.frame(self.constant(0.5, 180))
+        self.assertEqual(counts, {HID_REPORT_ID_SET_EFFECT: 1, HID_REPORT_ID_SET_CONDITION: 2})
+
+    def test_removed_force_is_stopped_once(self):
+        self.frame(self.constant(0.5))
+        counts = self.frame({})
+        self.assertEqual(counts, {HID_REPORT_ID_EFFECT_OPERATION: 1, HID_REPORT_ID_SET_CONDITION: 2})
+        self.assertEqual(self.frame({}), {HID_REPORT_ID_SET_CONDITION: 2})
+
+
+class TestWriteFailures(JoystickTestCase):
+
+    def setUp(self):
+        self.device = FailingStubDevice()
+        self.joystick = JoystickManager(device=self.device)
+
+    def test_failed_frame_is_rewritten_in_full(self):
+        self.frame({})
+        self.device.failing = True
+        with self.assertLogs(level='ERROR'):
+            self.frame({'constant_force': {'magnitude': 0.5, 'direction': 0}})
+        self.device.failing = False
+        counts = self.frame({'constant_force': {'magnitude': 0.5, 'direction': 0}})
+        # Every effect is stopped and recreated: the pool, then the constant force
+        self.assertEqual(counts[HID_REPORT_ID_SET_EFFECT], PERIODIC_POOL_SIZE + 1)
+        self.assertEqual(counts[HID_REPORT_ID_SET_CONSTANT_FORCE], 1)
+        self.assertEqual(counts[HID_REPORT_ID_EFFECT_OPERATION], 2 * (PERIODIC_POOL_SIZE + 1))
+        self.assertEqual(self.frame({'constant_force': {'magnitude': 0.5, 'direction': 0}}),
+                         {HID_REPORT_ID_SET_CONDITION: 2})
+
+    def test_lost_device_effects_are_rebuilt_by_the_writer(self):
+        shaker = {'stick_shaker': {'waveform': 'sine', 'frequency': 13, 'magnitude': 0.3, 'direction': 0},
+                  'damper': {'coef_x': 0.1, 'coef_y': 0.1}}
+        self.frame(shaker)
+        # What the reader thread does on a read error, then the reconnect
+        self.joystick.is_connected = False
+        self.joystick._effects_stale = True
+        self.assertEqual(self.frame(shaker), {})
+        self.assertIn('stick_shaker', self.joystick._periodic_states)  # Untouched by the reader
+        self.joystick.is_connected = True
+        counts = self.frame(shaker)
+        self.assertEqual(counts[HID_REPORT_ID_SET_PERIODIC], PERIODIC_POOL_SIZE + 1)
+        self.assertFalse(self.joystick._effects_stale)
+        self.assertEqual(len(self.joystick._periodic_pool) + len(self.joystick._periodic_states), PERIODIC_POOL_SIZE)
+
+
+class TestPeriodicPool(JoystickTestCase):
+
+    def setUp(self):
+        super().setUp()
+        # The pool's hold times run on a clock stepped by the tests
+        self.now = 1000.0
+        patcher = mock.patch('time.monotonic', lambda: self.now)
+        patcher.start()
+        self.addCleanup(patcher.stop)
+
+    def shaker(self, magnitude=0.3):
+        return {'stick_shaker': {'waveform': 'sine', 'frequency': 13, 'magnitude': magnitude, 'direction': 0}}
+
+    def test_pool_is_created_and_started_once(self):
+        counts = self.frame({})
+        self.assertEqual(counts[HID_REPORT_ID_EFFECT_OPERATION], PERIODIC_POOL_SIZE)
+        self.assertEqual(len(self.joystick._periodic_pool), PERIODIC_POOL_SIZE)
+        self.assertEqual(self.frame({}), {HID_REPORT_ID_SET_CONDITION: 2})
+
+    def test_vibration_takes_a_running_slot_without_starting_it(self):
+        self.frame({})
+        counts = self.frame(self.shaker())
+        self.assertEqual(counts[HID_REPORT_ID_EFFECT_OPERATION], 0)
+        self.assertEqual(counts[HID_REPORT_ID_SET_PERIODIC], 1)
+        self.assertEqual(len(self.joystick._periodic_pool), PERIODIC_POOL_SIZE - 1)
+
+    def test_steady_and_sub_quantum_vibration_writes_nothing(self):
+        self.frame(self.shaker())
+        self.now += 0.01
+        self.assertEqual(self.frame(self.shaker()), {HID_REPORT_ID_SET_CONDITION: 2})
+        self.now += 0.01
+        self.assertEqual(self.frame(self.shaker(0.3 + 1 / 4096)), {HID_REPORT_ID_SET_CONDITION: 2})
+
+    def test_flicker_within_the_hold_time_writes_nothing(self):
+        self.frame(self.shaker())
+        for step in range(10):
+            self.now += 0.01
+            counts = self.frame(self.shaker() if step % 2 else {})
+            self.assertEqual(counts, {HID_REPORT_ID_SET_CONDITION: 2})
+        self.assertIn('stick_shaker', self.joystick._periodic_states)
+
+    def test_released_after_hold_and_delay(self):
+        self.frame(self.shaker())
+        self.now += PERIODIC_MIN_HOLD
+        self.frame(self.shaker())
+        # Absent, but not yet for the release delay: keeps playing
+        self.now += PERIODIC_RELEASE_DELAY / 2
+        self.assertEqual(self.frame({}), {HID_REPORT_ID_SET_CONDITION: 2})
+        # Absent long enough: dropped to zero magnitude and back in the pool, not stopped
+        self.now += PERIODIC_RELEASE_DELAY
+        counts = self.frame({})
+        self.assertEqual(counts, {HID_REPORT_ID_SET_PERIODIC: 1, HID_REPORT_ID_SET_CONDITION: 2})
+        self.assertNotIn('stick_shaker', self.joystick._periodic_states)
+        self.assertEqual(len(self.joystick._periodic_pool), PERIODIC_POOL_SIZE)
+        self.assertEqual(self.frame({}), {HID_REPORT_ID_SET_CONDITION: 2})
+
+    def test_restart_takes_a_pooled_slot(self):
+        self.frame(self.shaker())
+        self.now += PERIODIC_MIN_HOLD + PERIODIC_RELEASE_DELAY
+        self.frame({})
+        counts = self.frame(self.shaker())
+        self.assertEqual(counts[HID_REPORT_ID_EFFECT_OPERATION], 0)
+        self.assertEqual(counts[HID_REPORT_ID_SET_PERIODIC], 1)
+        self.assertEqual(len(self.joystick._periodic_pool) + len(self.joystick._periodic_states), PERIODIC_POOL_SIZE)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,98 @@
+#
+# This program is largely based on the TelemFFB distribution (https://github.com/walmis/TelemFFB).
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, version 3.
+#
+# This program is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+# General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <http://www.gnu.org/licenses/>.
+#
+
+"""Tests of StageBudget: admission by priority, cost estimates and recovery from a stall."""
+
+import time
+import unittest
+
+from fsffb.scheduling import StageBudget, STAGE_CRITICAL, STAGE_NORMAL, STAGE_LOW
+
+STAGES = {
+    'force': (STAGE_CRITICAL, 10e-6),
+    'vibrations': (STAGE_NORMAL, 10e-6),
+    'ui': (STAGE_LOW, 10e-6),
+}
+
+
+def missed_deadline():
+    """A deadline that has already passed: only critical or forced stages are admitted."""
+    return time.perf_counter() - 1.0
+
+
+class TestStageBudget(unittest.TestCase):
+
+    def test_critical_stage_always_runs(self):
+        budget = StageBudget(STAGES)
+        for _ in range(100):
+            self.assertTrue(budget.admit('force', missed_deadline()))
+        self.assertEqual(budget.get_stats()['force']['skipped'], 0)
+
+    def test_no_deadline_admits_every_stage(self):
+        budget = StageBudget(STAGES)
+        for name in STAGES:
+            self.assertTrue(budget.admit(name, None))
+
+    def test_stage_that_fits_runs(self):
+        budget = StageBudget(STAGES)
+        deadline = time.perf_counter() + 10.0
+        self.assertTrue(budget.admit('vibrations', deadline))
+        self.assertTrue(budget.admit('ui', deadline))
+
+    def test_measurement_updates_the_estimate(self):
+        budget = StageBudget(STAGES, smoothing=0.5)
+        budget.measured('vibrations', 30e-6)
+        stats = budget.get_stats()['vibrations']
+        self.assertEqual(stats['runs'], 1)
+        self.assertAlmostEqual(stats['cost_us'], 20.0)
+
+    def test_run_returns_the_skipped_result(self):
+        budget = StageBudget(STAGES)
+        self.assertEqual(budget.run('vibrations', missed_deadline(), 'skipped', lambda: 'ran'), 'skipped')
+        self.assertEqual(budget.run('vibrations', None, 'skipped', lambda: 'ran'), 'ran')
+        stats = budget.get_stats()['vibrations']
+        self.assertEqual((stats['runs'], stats['skipped']), (1, 1))
+
+    def test_skips_decay_the_estimate(self):
+        budget = StageBudget(STAGES, skip_decay=0.5)
+        budget.measured('ui', 1.0)  # A stall that would otherwise never fit again
+        before = budget.cost['ui']
+        budget.admit('ui', missed_deadline())
+        self.assertAlmostEqual(budget.cost['ui'], before * 0.5)
+
+    def test_stalled_stage_recovers_once_its_estimate_decays(self):
+        budget = StageBudget(STAGES, skip_decay=0.5, max_skips=1000)
+        budget.measured('vibrations', 1.0)
+        deadline = time.perf_counter() + 0.01
+        skips = 0
+        while not budget.admit('vibrations', deadline):
+            skips += 1
+            self.assertLess(skips, 100)
+        self.assertGreater(skips, 0)
+
+    def test_stage_is_forced_after_max_skips(self):
+        budget = StageBudget(STAGES, skip_decay=1.0, max_skips=5)
+        for _ in range(5):
+            self.assertFalse(budget.run('ui', missed_deadline(), None, lambda: True))
+        self.assertTrue(budget.run('ui', missed_deadline(), None, lambda: True))
+        # The forced run was measured, so the streak starts over
+        self.assertFalse(budget.run('ui', missed_deadline(), None, lambda: True))
+        stats = budget.get_stats()['ui']
+        self.assertEqual((stats['runs'], stats['skipped']), (1, 6))
+
+
+if __name__ == '__main__':
+    unittest.main()
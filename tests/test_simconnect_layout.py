@@ -0,0 +1,160 @@
+#
+# This program is largely based on the TelemFFB distribution (https://github.com/walmis/TelemFFB).
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, version 3.
+#
+# This program is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+# General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <http://www.gnu.org/licenses/>.
+#
+
+"""Tests of SimConnectLayout against the ctypes loop MSFSManager used before it."""
+
+import ctypes
+import struct
+import unittest
+
+from fsffb.telemetry.simconnect_layout import SimConnectLayout
+
+C_TYPES = {1: ctypes.c_int32, 3: ctypes.c_float, 4: ctypes.c_double, 8: ctypes.c_char * 128}
+STRUCT_CODES = {1: 'i', 3: 'f', 4: 'd', 8: '128s'}
+
+
+class FakeSimVar:
+    """The SimVar attributes the layout uses."""
+
+    def __init__(self, name, datatype, scale=None, mutator=None, parent=None, index=None):
+        self.name, self.datatype, self.scale, self.mutator = name, datatype, scale, mutator
+        self.parent, self.index = parent, index
+
+    def _calculate(self, value):
+        if self.mutator:
+            value = self.mutator(value)
+        if self.scale:
+            value = value * self.scale
+        return value
+
+
+class FakeSimVarArray:
+
+    def __init__(self, name, count, scale=None, datatype=4):
+        self.name = name
+        self.vars = [FakeSimVar(name, datatype, scale, parent=self, index=i) for i in range(count)]
+        self.values = [0] * count
+
+
+def make_simvars():
+    simvars = [FakeSimVar('T', 4), FakeSimVar('N', 8), FakeSimVar('G', 4), FakeSimVar('Flaps', 3, scale=100.0)]
+    for array in (FakeSimVarArray('VelRotBody', 3), FakeSimVarArray('AccBody', 3, scale=0.031081),
+                  FakeSimVarArray('PropThrust', 4)):
+        simvars.extend(array.vars)
+    simvars += [FakeSimVar(f'Var{i}', 4) for i in range(10)]
+    simvars += [FakeSimVar('SimOnGround', 1), FakeSimVar('Gear', 1, scale=0.5),
+                FakeSimVar('SurfaceType', 1, mutator=lambda x: {0: 'Concrete', 4: 'Asphalt'}.get(x, 'unknown'))]
+    return simvars
+
+
+def make_values(simvars):
+    return [12.5, b'Cessna 172', 1.25, 0.375] + [float(i) * 0.5 for i in range(4, len(simvars) - 3)] + [1, 3, 4]
+
+
+def make_packet(simvars, values, tagged=True, order=None):
+    data = b''
+    for i in (order if order is not None else range(len(simvars))):
+        if tagged:
+            data += struct.pack('<I', i)
+        data += struct.pack('<' + STRUCT_CODES[simvars[i].datatype], values[i])
+    return (ctypes.c_char * len(data)).from_buffer_copy(data)
+
+
+def decode_loop(simvars, packet, count):
+    """The MSFSManager._handle_simobject_data loop the layout replaces."""
+    data = {}
+    offset = 0
+    for _ in range(count):
+        idx = ctypes.cast(ctypes.byref(packet, offset), ctypes.POINTER(ctypes.c_uint32))[0]
+        offset += 4
+        var = simvars[idx]
+        c_type = C_TYPES[var.datatype]
+        if var.datatype == 8:
+            val = str(ctypes.cast(ctypes.byref(packet, offset), ctypes.POINTER(c_type))[0].value, "utf-8")
+        else:
+            val = ctypes.cast(ctypes.byref(packet, offset), ctypes.POINTER(c_type))[0]
+        offset += ctypes.sizeof(c_type)
+        val = var._calculate(val)
+        if var.parent:
+            var.parent.values[var.index] = val
+            data[var.parent.name] = list(var.parent.values)
+        else:
+            data[var.name] = val
+    return data
+
+
+class TestSimConnectLayout(unittest.TestCase):
+
+    def setUp(self):
+        self.simvars = make_simvars()
+        self.values = make_values(self.simvars)
+        self.layout = SimConnectLayout(self.simvars)
+
+    def assertMatchesLoop(self, decoded, expected):
+        self.assertEqual(decoded.keys(), expected.keys())
+        for key, value in expected.items():
+            with self.subTest(channel=key):
+                if isinstance(value, list):
+                    self.assertEqual(len(decoded[key]), len(value))
+                    for got, want in zip(decoded[key], value):
+                        self.assertAlmostEqual(got, want, places=12)
+                elif isinstance(value, float):
+                    self.assertAlmostEqual(decoded[key], value, places=12)
+                else:
+                    self.assertEqual(decoded[key], value)
+                    self.assertIs(type(decoded[key]), type(value))
+
+    def test_full_tagged_packet_matches_the_ctypes_loop(self):
+        packet = make_packet(self.simvars, self.values)
+        expected = decode_loop(self.simvars, packet, len(self.simvars))
+        self.assertMatchesLoop(self.layout.decode(packet, len(self.simvars)), expected)
+
+    def test_untagged_packet_decodes_like_the_tagged_one(self):
+        tagged = self.layout.decode(make_packet(self.simvars, self.values), len(self.simvars))
+        untagged = SimConnectLayout(self.simvars, tagged=False)
+        packet = make_packet(self.simvars, self.values, tagged=False)
+        self.assertEqual(untagged.decode(packet, len(self.simvars)), tagged)
+
+    def test_out_of_order_packet_falls_back_to_the_walk(self):
+        order = list(reversed(range(len(self.simvars))))
+        packet = make_packet(self.simvars, self.values, order=order)
+        expected = decode_loop(make_simvars(), packet, len(self.simvars))
+        self.assertMatchesLoop(self.layout.decode(packet, len(self.simvars)), expected)
+
+    def test_partial_packet_keeps_the_other_array_elements(self):
+        full = self.layout.decode(make_packet(self.simvars, self.values), len(self.simvars))
+        acc_index = next(i for i, sv in enumerate(self.simvars) if sv.name == 'AccBody' and sv.index == 1)
+        partial = struct.pack('<Id', 2, 3.0) + struct.pack('<Id', acc_index, 9.81)
+        result = self.layout.decode(partial, 2)
+        self.assertEqual(set(result), {'G', 'AccBody'})
+        self.assertEqual(result['G'], 3.0)
+        self.assertAlmostEqual(result['AccBody'][1], 9.81 * 0.031081)
+        self.assertEqual(result['AccBody'][0], full['AccBody'][0])
+        self.assertEqual(result['AccBody'][2], full['AccBody'][2])
+
+    def test_truncated_and_unknown_datums_stop_the_walk(self):
+        truncated = struct.pack('<Id', 0, 1.0) + struct.pack('<I', 2) + b'\0\0'
+        self.assertEqual(self.layout.decode(truncated, 2), {'T': 1.0})
+        unknown = struct.pack('<Id', 0, 1.0) + struct.pack('<Id', len(self.simvars), 2.0) + struct.pack('<Id', 2, 3.0)
+        self.assertEqual(self.layout.decode(unknown, 3), {'T': 1.0})
+
+    def test_short_untagged_packet_is_ignored(self):
+        untagged = SimConnectLayout(self.simvars, tagged=False)
+        self.assertEqual(untagged.decode(b'\0' * (untagged.size - 1), len(self.simvars)), {})
+
+
+if __name__ == '__main__':
+    unittest.main()
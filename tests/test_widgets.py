@@ -0,0 +1,89 @@
+#
+# This program is largely based on the TelemFFB distribution (https://github.com/walmis/TelemFFB).
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, version 3.
+#
+# This program is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+# General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <http://www.gnu.org/licenses/>.
+#
+
+"""Tests of the history plot buffers: RingBuffer windows and min/max decimation."""
+
+import unittest
+
+import numpy as np
+
+try:
+    from fsffb.ui.widgets import RingBuffer, minmax_decimate
+except ImportError:  # PyQt6 or pyqtgraph not installed
+    RingBuffer = minmax_decimate = None
+
+
+@unittest.skipIf(RingBuffer is None, "PyQt6 and pyqtgraph are needed to import the widgets")
+class TestRingBuffer(unittest.TestCase):
+
+    def fill(self, buffer, count):
+        for i in range(count):
+            buffer.append(float(i), 10.0 * i)
+
+    def test_since_before_wrap(self):
+        buffer = RingBuffer(8)
+        self.fill(buffer, 5)
+        times, values = buffer.since(2.0)
+        np.testing.assert_array_equal(times, [2, 3, 4])
+        np.testing.assert_array_equal(values, [20, 30, 40])
+
+    def test_since_after_wrap(self):
+        buffer = RingBuffer(8)
+        self.fill(buffer, 13)
+        times, values = buffer.since(0.0)
+        np.testing.assert_array_equal(times, np.arange(5, 13))  # Oldest first, overwritten samples gone
+        np.testing.assert_array_equal(values, 10.0 * np.arange(5, 13))
+        times, _ = buffer.since(10.5)
+        np.testing.assert_array_equal(times, [11, 12])
+
+    def test_since_later_than_newest(self):
+        buffer = RingBuffer(8)
+        self.fill(buffer, 3)
+        times, values = buffer.since(5.0)
+        self.assertEqual((len(times), len(values)), (0, 0))
+
+
+@unittest.skipIf(minmax_decimate is None, "PyQt6 and pyqtgraph are needed to import the widgets")
+class TestMinMaxDecimate(unittest.TestCase):
+
+    def test_few_samples_pass_through(self):
+        times, values = np.arange(10.0), np.arange(10.0) ** 2
+        out_t, out_v = minmax_decimate(times, values, bins=5)
+        self.assertIs(out_t, times)
+        self.assertIs(out_v, values)
+
+    def test_min_and_max_kept_per_bin(self):
+        times = np.arange(40.0)
+        values = np.zeros(40)
+        values[13] = 5.0    # Spike in bin 1
+        values[26] = -3.0   # Dip in bin 2
+        out_t, out_v = minmax_decimate(times, values, bins=4)
+        self.assertEqual(len(out_v), 8)
+        np.testing.assert_array_equal(out_t, np.repeat([0, 10, 20, 30], 2))
+        np.testing.assert_array_equal(out_v, [0, 0, 0, 5, -3, 0, 0, 0])
+
+    def test_newest_samples_always_kept(self):
+        # 43 samples in 4 bins of 10: the 3 oldest are dropped, never the newest
+        times = np.arange(43.0)
+        values = np.arange(43.0)
+        out_t, out_v = minmax_decimate(times, values, bins=4)
+        self.assertEqual(out_t[0], 3.0)
+        self.assertEqual(out_v[-1], 42.0)
+        self.assertEqual(out_v[0], 3.0)
+
+
+if __name__ == '__main__':
+    unittest.main()
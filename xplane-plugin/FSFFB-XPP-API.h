@@ -0,0 +1,148 @@
+
+/*
+* This program is largely based on the TelemFFB distribution (https://github.com/walmis/TelemFFB).
+
+* This program is free software : you can redistribute it and /or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, version 3.
+
+* This program is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the GNU
+* General Public License for more details.
+
+* You should have received a copy of the GNU General Public License
+* along with this program.If not, see < http://www.gnu.org/licenses/>.
+*/
+
+/*
+* In-process access to the telemetry frame collected by FSFFB-XPP.
+*
+* Other plugins loaded in the same X-Plane can read the channels FSFFB-XPP sends
+* over UDP directly from its frame buffer, without sockets or text parsing:
+*
+*     XPLMPluginID fsffb = XPLMFindPluginBySignature(FSFFB_PLUGIN_SIGNATURE);
+*     const FSFFB_Frame* frame = NULL;
+*     if (fsffb != XPLM_NO_PLUGIN_ID) {
+*         XPLMSendMessageToPlugin(fsffb, FSFFB_MSG_GET_FRAME, (void*)&frame);
+*     }
+*
+* The frame stays valid until FSFFB-XPP is disabled (XPLM_MSG_PLUGIN_DISABLED
+* from that plugin ID); it is rewritten once per flight loop on the sim thread.
+* Readers in their own flight loop callbacks can read it directly. Readers on
+* other threads use FSFFB_ReadBegin / FSFFB_ReadRetry and copy what they need:
+*
+*     uint32_t seq;
+*     do {
+*         seq = FSFFB_ReadBegin(frame);
+*         g = FSFFB_GetValue(frame, "G", 0, 0.0);
+*     } while (FSFFB_ReadRetry(frame, seq));
+*/
+
+#ifndef FSFFB_XPP_API_H
+#define FSFFB_XPP_API_H
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__cplusplus)
+#include <atomic>
+#define FSFFB_FENCE() std::atomic_thread_fence(std::memory_order_seq_cst)
+#elif defined(_MSC_VER)
+#include <windows.h>
+#define FSFFB_FENCE() MemoryBarrier()
+#else
+#define FSFFB_FENCE() __sync_synchronize()
+#endif
+
+#define FSFFB_PLUGIN_SIGNATURE "vpforce.fsffb.xpplugin"
+
+/* Bumped whenever the frame layout changes; check before using the frame */
+#define FSFFB_API_VERSION 1
+
+/* XPLMSendMessageToPlugin message, inParam is a const FSFFB_Frame** to fill in */
+#define FSFFB_MSG_GET_FRAME 0x46464201
+
+#define FSFFB_MAX_CHANNELS 512
+#define FSFFB_MAX_VALUES 8192
+#define FSFFB_MAX_TEXT 2048
+#define FSFFB_KEY_LENGTH 64
+
+/* FSFFB_Frame.flags */
+#define FSFFB_FRAME_TRUNCATED 0x1   /* Not every channel fitted in the frame */
+#define FSFFB_FRAME_PAUSED 0x2      /* Sim paused, values are from the last unpaused frame */
+
+typedef struct FSFFB_Channel {
+    char key[FSFFB_KEY_LENGTH];     /* Telemetry key, e.g. "G" or a SUBSCRIBE tag */
+    uint32_t isText;                /* 1: offset/count index into text[], 0: into values[] */
+    uint32_t offset;
+    uint32_t count;                 /* Values (1 for scalars) or text bytes without terminator */
+} FSFFB_Channel;
+
+typedef struct FSFFB_Frame {
+    uint32_t apiVersion;            /* FSFFB_API_VERSION */
+    uint32_t size;                  /* sizeof(FSFFB_Frame) */
+    volatile uint32_t sequence;     /* Odd while the frame is being written, +2 per frame */
+    uint32_t flags;
+    double simTime;                 /* Same as the "T" channel */
+    uint32_t channelCount;
+    uint32_t valueCount;
+    uint32_t textLength;
+    uint32_t reserved;
+    FSFFB_Channel channels[FSFFB_MAX_CHANNELS];  /* Sorted by key */
+    double values[FSFFB_MAX_VALUES];
+    char text[FSFFB_MAX_TEXT];      /* Text channels, each NUL terminated */
+} FSFFB_Frame;
+
+/* Start of a consistent read, returns the sequence to pass to FSFFB_ReadRetry */
+static inline uint32_t FSFFB_ReadBegin(const FSFFB_Frame* frame)
+{
+    uint32_t seq;
+    do {
+        seq = frame->sequence;
+    } while (seq & 1);
+    FSFFB_FENCE();
+    return seq;
+}
+
+/* Non-zero if the frame changed while it was read and the read must be repeated */
+static inline int FSFFB_ReadRetry(const FSFFB_Frame* frame, uint32_t seq)
+{
+    FSFFB_FENCE();
+    return frame->sequence != seq;
+}
+
+/* Binary search for a channel by key, NULL if it is not in the frame */
+static inline const FSFFB_Channel* FSFFB_FindChannel(const FSFFB_Frame* frame, const char* key)
+{
+    uint32_t lo = 0, hi = frame->channelCount;
+    if (hi > FSFFB_MAX_CHANNELS) {
+        return NULL;  /* Torn read, the caller will retry */
+    }
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        int cmp = strncmp(frame->channels[mid].key, key, FSFFB_KEY_LENGTH);
+        if (cmp == 0) {
+            return &frame->channels[mid];
+        }
+        if (cmp < 0) {
+            lo = mid + 1;
+        }
+        else {
+            hi = mid;
+        }
+    }
+    return NULL;
+}
+
+/* Element `index` of a numeric channel, or `fallback` if missing */
+static inline double FSFFB_GetValue(const FSFFB_Frame* frame, const char* key, uint32_t index, double fallback)
+{
+    const FSFFB_Channel* channel = FSFFB_FindChannel(frame, key);
+    if (channel == NULL || channel->isText || index >= channel->count || channel->offset + index >= FSFFB_MAX_VALUES) {
+        return fallback;
+    }
+    return frame->values[channel->offset + index];
+}
+
+#endif /* FSFFB_XPP_API_H */
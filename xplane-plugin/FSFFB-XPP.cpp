@@ -26,18 +26,26 @@
 #include <vector>
 #include <map>
 #include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <climits>
 #include <winsock2.h>
+#include <ws2tcpip.h>
 #include <thread>
 #include <mutex>
 #include <fstream>
 #include <chrono>
 #include <Windows.h>
 #include <algorithm>
+#include <cmath>
+#include <atomic>
+#include <memory>
 #include "XPLMProcessing.h"
 #include "XPLMDataAccess.h"
 #include "XPLMUtilities.h"
 #include "XPLMPlugin.h"
 #include "XPLMPlanes.h"
+#include "FSFFB-XPP-API.h"
 
 
 
@@ -48,6 +56,24 @@ SOCKET udpSocket_rx;
 struct sockaddr_in serverAddr_rx;
 bool gTerminateReceiveThread = false;
 
+// Network settings, read from FSFFB_Config.txt (next to the debug log) at startup.
+// Without remote_host telemetry is broadcast on the loopback network and commands are
+// accepted on 127.0.0.1 only; with it telemetry is sent to that host and commands are
+// accepted from that host only, so the FFB backend can run on a second machine.
+struct NetworkConfig {
+    std::string remoteHost;     // Machine running the FFB backend, empty for local mode
+    int telemetryPort = 34390;  // Port the backend listens on for telemetry
+    int commandPort = 34391;    // Port the plugin listens on for commands
+    int mtu = 1400;             // Largest telemetry datagram, bigger frames are sent in fragments
+};
+
+NetworkConfig gNetworkConfig;
+bool gRemoteMode = false;
+struct in_addr gRemoteAddr;
+unsigned int gTelemetrySeq = 0;                // Frame number sent as "Seq" so the backend can count losses
+std::atomic<unsigned int> gReceivedPackets(0);
+std::atomic<unsigned int> gRejectedPackets(0); // Commands from anything but the remote host
+
 std::mutex axisDataMutex;
 std::mutex logMutex;
 
@@ -55,18 +81,121 @@ std::mutex logMutex;
 std::ofstream debugLogFile;
 
 
+// Native accessor used to read a subscribed dataref, resolved once at subscribe time
+enum class DataRefAccessor {
+    Int,
+    Float,
+    Double,
+    FloatArray,
+    IntArray
+};
+
+// Collection tier of a subscription. Critical subscriptions are read every frame, the
+// others share what is left of the collection budget and are read round-robin.
+enum class CollectTier {
+    Critical,
+    Normal,
+    Low
+};
+
 struct DataRefSubscription {
     XPLMDataRef dataRef;
-    std::string key;         // Key in telemetryData
-    std::string type;        // Data type (int, float, double, etc.)
-    int precision;           // Precision for floats
-    float conversionFactor;  // Conversion factor (default 1.0)
+    std::string key;          // Key in telemetryData
+    std::string type;         // Resolved data type (int, float, double, float[], int[])
+    DataRefAccessor accessor; // Accessor matching the resolved type
+    int size;                 // Number of elements for array datarefs, 1 for scalars
+    int precision;            // Precision for floats
+    double conversionFactor;  // Conversion factor (default 1.0)
+    CollectTier tier;         // Collection priority (default normal)
+};
+
+// How a channel is reduced when telemetry is sent below the sim rate (CONFIG:send_hz).
+// Reductions run every frame on each element, so short events between sends are kept.
+enum class ReduceMode {
+    Last,       // Value of the frame that is sent
+    Mean,       // Average over the interval
+    Min,        // Smallest value since the last send
+    Max,        // Largest value since the last send
+    Peak,       // Value with the largest magnitude since the last send, sign kept
+    LowPass     // First order low-pass at half the send rate, sampled at send time
+};
+
+// A collected telemetry value. Numbers are kept as doubles all the way from
+// the dataref read to the packet encoder so double datarefs keep full precision.
+struct TelemetryChannel {
+    std::vector<double> values;  // One element for scalar channels
+    std::string text;            // Used instead of values for string channels
+    int precision = 3;           // Decimals when encoded, 0 encodes as an integer
+    bool isText = false;
+    ReduceMode reduce = ReduceMode::Last;
+    std::vector<double> reduced; // Reduction state per element (a sum for Mean)
+    int samples = 0;             // Frames reduced since the last send
+    unsigned int sampledFrame = 0;  // gTelemetryFrame of the last write
+};
+
+
+
+
+// Frame shared with other plugins through FSFFB_MSG_GET_FRAME, see FSFFB-XPP-API.h
+FSFFB_Frame gSharedFrame;
+
+typedef std::vector<DataRefSubscription> SubscriptionSet;
+
+// Subscriptions are edited in a staging copy by DeferredRequestsCallback and published as an
+// immutable snapshot with an atomic pointer swap. The flight loop loads the snapshot once per
+// frame and iterates it without locking. Snapshots are only replaced on the sim thread between
+// two frames, so a replaced one is unused; it is freed by the receive thread, which keeps the
+// deallocation off the sim thread.
+SubscriptionSet gStagedSubscriptions;       // Sim thread, written under axisDataMutex
+bool gStagedSubscriptionsChanged = false;
+std::atomic<const SubscriptionSet*> gSubscriptionSnapshot(new SubscriptionSet());
+std::vector<std::unique_ptr<const SubscriptionSet>> gRetiredSnapshots;  // Guarded by axisDataMutex
+
+// A SUBSCRIBE with a glob pattern, kept so it can be expanded again after an aircraft load
+struct PatternSubscription {
+    std::string pattern;      // Glob pattern, '*' matches any run of characters and '?' one character
+    std::string tagPrefix;    // Prefix for the generated keys, empty to key by dataref path
+    std::string type;
+    int precision;
+    double conversionFactor;
+    CollectTier tier;
 };
 
+std::vector<PatternSubscription> patternSubscriptions;  // Sim thread only
+std::vector<PatternSubscription> gPendingPatterns;      // Guarded by axisDataMutex
+
+// A SUBSCRIBE waiting for the sim thread. The XPLM API may only be called from the sim
+// thread, so the receive thread queues the request and DeferredRequestsCallback resolves it.
+struct SubscribeRequest {
+    std::string path;
+    std::string key;          // Empty to key by dataref path
+    std::string type;
+    int precision;
+    double conversionFactor;
+    CollectTier tier;
+};
 
+std::vector<SubscribeRequest> gPendingSubscribes;      // Guarded by axisDataMutex
 
+// A one-shot QUERY, answered on the next flight loop with a RESULT reply
+struct DataRefQuery {
+    std::string id;
+    std::vector<std::string> paths;
+};
 
-std::vector<DataRefSubscription> subscribedDataRefs;
+// Resolved query datarefs, kept so repeated queries skip the lookup (flight loop only)
+struct QueryDataRef {
+    XPLMDataRef dataRef;
+    DataRefAccessor accessor;
+    bool valid;
+};
+
+std::vector<DataRefQuery> gPendingQueries;              // Guarded by axisDataMutex
+std::map<std::string, QueryDataRef> gQueryDataRefCache;
+
+// Names of all registered datarefs, enumerated once and reused until the aircraft or dataref set changes
+std::vector<std::pair<std::string, XPLMDataRef>> gDataRefIndex;  // Sim thread only
+std::atomic<bool> gDataRefIndexStale(true);
 
 
 /* Data refs we will record. */
@@ -88,6 +217,119 @@ float gActiveGearZNode;
 
 bool simPaused = false;
 
+// Frame-time budget for CollectTelemetryData(). Critical channels are always read; normal and
+// low priority subscriptions are read round-robin within the budget, and when the budget keeps
+// being exceeded the low (then normal) tier is read only every 2^n frames.
+struct CollectScheduler {
+    size_t cursor = 0;          // Round-robin position in the optional subscriptions
+    unsigned int frame = 0;
+    int degradeLevel = 0;       // 0 = every subscription read every frame
+    int overBudgetFrames = 0;
+    int underBudgetFrames = 0;
+    int deferred = 0;           // Optional reads skipped in the last frame
+};
+
+const int kMaxDegradeLevel = 8;       // Levels 1-4 slow the low tier down to 1/16, 5-8 the normal tier
+const int kDegradeAfterFrames = 5;    // Consecutive over-budget frames before degrading further
+const int kRecoverAfterFrames = 120;  // Consecutive frames under half the budget before recovering a level
+
+std::atomic<int> gCollectBudgetUs(500);
+CollectScheduler gCollectScheduler;
+
+// Stick force passthrough: X-Plane's own control forces filtered, scaled and limited at
+// sim rate and sent as "XPForce" = roll~pitch~yaw in -1..1, ready for the constant force
+// effect. Enabled with CONFIG:force_passthrough=1, tuned with force_full_scale_lb,
+// force_filter_hz and force_limit.
+std::atomic<bool> gForcePassthrough(false);
+std::atomic<float> gForceFullScaleLb(30.0f);  // Force in lb that maps to 1.0
+std::atomic<float> gForceFilterHz(15.0f);     // Low-pass cutoff, 0 disables the filter
+std::atomic<float> gForceLimit(1.0f);         // Output clamp
+double gForceFiltered[3] = { 0.0, 0.0, 0.0 };
+bool gForcePassthroughActive = false;         // Flight loop copy, to reset the filter when enabled
+
+// Short-horizon prediction of selected scalar channels to compensate the latency between
+// the sim frame and the force output. PREDICT:key=linear|quadratic|off selects channels,
+// CONFIG:predict_horizon_ms sets the horizon. Each is sent as "<key>_pred=value~bound",
+// where bound is the running mean absolute error of past predictions at that horizon; a
+// prediction is only sent once one has matured, and is removed when turned off or at horizon 0.
+enum class PredictMode {
+    Off,
+    Linear,
+    Quadratic
+};
+
+struct ChannelPredictor {
+    PredictMode mode = PredictMode::Off;
+    TelemetryChannel* source = nullptr;  // Resolved lazily, reset when a prediction channel is erased
+    double lastValue = 0.0;
+    double lastTime = -1.0;
+    double rate = 0.0;                   // Filtered first derivative per second
+    double accel = 0.0;                  // Filtered second derivative
+    double errorBound = 0.0;             // Mean absolute error of matured predictions
+    int matured = 0;                     // Predictions scored so far
+    bool published = false;              // "<key>_pred" is in telemetryData
+    // Predictions waiting for the sim time they were made for. They are recorded at most every
+    // horizon / (kPending / 2), so the ring never overwrites one before it matures at any frame rate.
+    static const int kPending = 64;
+    double pendingTime[kPending];
+    double pendingValue[kPending];
+    int pendingHead = 0;
+    int pendingCount = 0;
+    double lastPendingTime = -1.0;
+};
+
+std::atomic<int> gPredictHorizonMs(20);
+std::map<std::string, PredictMode> gPredictModes;  // Guarded by axisDataMutex
+std::atomic<bool> gPredictModesChanged(false);
+std::map<std::string, ChannelPredictor> gPredictors; // Flight loop only
+
+// Telemetry send rate, 0 sends every frame. Set with CONFIG:send_hz=..
+std::atomic<int> gSendHz(0);
+double gSendAccumulator = 0.0;
+
+// Flow control: the backend reports its achieved rate, queue depth and capacity with
+// FLOW:rate=..,queue=..,capacity=.. and the send rate follows it (AIMD with hysteresis)
+// between flow_min_hz and flow_max_hz. Frames between two sends are folded into the next
+// packet by the reductions. Without reports for kFlowStaleSeconds, send_hz applies again.
+struct FlowControl {
+    double minHz = 20.0;
+    double maxHz = 0.0;            // 0: up to the sim frame rate
+    double sendHz = 0.0;           // Current adapted rate, 0 until the first report
+    int goodReports = 0;           // Consecutive reports with headroom, for the increase hysteresis
+    std::chrono::steady_clock::time_point lastReport;
+};
+
+const double kFlowUnboundedHz = 1000.0;
+const double kFlowStaleSeconds = 2.0;
+const int kFlowQueueHigh = 2;      // Backend frames waiting before the rate is cut
+const int kFlowIncreaseReports = 3;
+
+std::atomic<bool> gFlowEnabled(false);
+FlowControl gFlow;                 // Guarded by axisDataMutex
+std::atomic<double> gFlowSendHz(0.0);  // gFlow.sendHz for the flight loop, 0 when inactive
+
+// Reduction per channel key, changed with REDUCE:key=mode (guarded by axisDataMutex).
+// The defaults keep touchdown and G / stick force spikes when the send rate is lowered.
+std::map<std::string, ReduceMode> gReduceModes = {
+    { "G", ReduceMode::Peak },
+    { "Gaxil", ReduceMode::Peak },
+    { "Gside", ReduceMode::Peak },
+    { "WeightOnWheels", ReduceMode::Max },
+    { "StickForcePitch", ReduceMode::Peak },
+    { "StickForceRoll", ReduceMode::Peak },
+    { "StickForceYaw", ReduceMode::Peak },
+};
+std::atomic<bool> gReduceModesChanged(true);
+std::vector<TelemetryChannel*> gReducedChannels;  // Flight loop copy, rebuilt when a channel is erased
+size_t gReducedChannelsSeen = 0;                  // telemetryData size when gReducedChannels was built
+
+// Sim time in seconds, accumulated as a double so it does not lose resolution on long sessions
+double gSimTime = -1.0;
+
+// Flight loop frame number. Channels not written in the current frame (optional subscriptions
+// deferred by the collection budget, channels set only on aircraft change) are not reduced.
+unsigned int gTelemetryFrame = 0;
+
 static XPLMDataRef gAircraftDescr;
 static XPLMDataRef gPaused = XPLMFindDataRef("sim/time/paused");                                        // boolean � int � v6.60+
 static XPLMDataRef gOnGround = XPLMFindDataRef("sim/flightmodel/failures/onground_all");                // int � v6.60+
@@ -124,21 +366,10 @@ static XPLMDataRef gVso = XPLMFindDataRef("sim/aircraft/view/acf_Vso");
 static XPLMDataRef gVfe = XPLMFindDataRef("sim/aircraft/view/acf_Vfe");                                 // kias � float � v6.60+
 static XPLMDataRef gVle = XPLMFindDataRef("sim/aircraft/overflow/acf_Vle");                             // kias  float � v6.60 +
 
-
-static XPLMDataRef gCollectiveOvd = XPLMFindDataRef("sim/operation/override/override_prop_pitch");
-static XPLMDataRef gRollOvd = XPLMFindDataRef("sim/operation/override/override_joystick_roll");
-static XPLMDataRef gPitchOvd = XPLMFindDataRef("sim/operation/override/override_joystick_pitch");
-static XPLMDataRef gYawOvd = XPLMFindDataRef("sim/operation/override/override_joystick_heading");
-
 static XPLMDataRef gRollCenter = XPLMFindDataRef("sim/joystick/joystick_roll_center");
 static XPLMDataRef gPitchCenter = XPLMFindDataRef("sim/joystick/joystick_pitch_center");
 static XPLMDataRef gYawCenter = XPLMFindDataRef("sim/joystick/joystick_heading_center");
 
-static XPLMDataRef gCollectiveRatio = XPLMFindDataRef("sim/cockpit2/engine/actuators/prop_ratio_all");
-static XPLMDataRef gRollRatio = XPLMFindDataRef("sim/joystick/yoke_roll_ratio");
-static XPLMDataRef gPitchRatio = XPLMFindDataRef("sim/joystick/yoke_pitch_ratio");
-static XPLMDataRef gYawRatio = XPLMFindDataRef("sim/joystick/yoke_heading_ratio");
-
 static XPLMDataRef gElevTrim = XPLMFindDataRef("sim/flightmodel2/controls/elevator_trim");
 static XPLMDataRef gAilerTrim = XPLMFindDataRef("sim/flightmodel2/controls/aileron_trim");
 static XPLMDataRef gRudderTrim = XPLMFindDataRef("sim/flightmodel2/controls/rudder_trim");
@@ -164,8 +395,44 @@ static XPLMDataRef gStickForceYaw = XPLMFindDataRef("sim/flightmodel/misc/act_fr
 
 
 
-std::map<std::string, std::string> telemetryData;
-std::map<std::string, float> axisDataMap = { {"jx", 0.0}, {"jy", 0.0}, {"px", 0.0}, {"cy", 0.0} };
+std::map<std::string, TelemetryChannel> telemetryData;
+
+// A control axis the backend drives, declared with AXISDEF. Datarefs and the range
+// mapping are resolved once, so the flight loop only walks a dense array of these.
+struct AxisTarget {
+    XPLMDataRef dataRef;
+    DataRefAccessor accessor;
+};
+
+struct AxisDefinition {
+    std::string name;                 // Key in AXIS packets, e.g. "jx"
+    std::string group;                // Enabled together with OVERRIDE:<group>=true
+    std::vector<AxisTarget> targets;  // Datarefs written with the mapped value
+    int index;                        // Element for array datarefs
+    XPLMDataRef overrideRef;          // Set to 1 while the group is enabled, may be null
+    float inMin, inMax;               // Range of the values in AXIS packets
+    float scale, offset;              // Mapping of that range onto the dataref range
+    float value;                      // Latest value received
+    bool enabled;                     // Override group active (written by the receive thread)
+    bool overrideApplied;             // Override dataref state (written by the flight loop)
+};
+
+std::vector<AxisDefinition> gAxes;            // Guarded by axisDataMutex
+std::map<std::string, size_t> gAxisIndex;     // Name to gAxes slot, used when parsing packets only
+
+// An AXISDEF waiting for the sim thread, which looks its datarefs up
+struct AxisRequest {
+    std::string name;
+    std::string group;
+    std::string datarefs;         // Targets separated by '|'
+    int index;
+    std::string overrideDataRef;
+    float inMin, inMax;
+    float outMin, outMax;
+};
+
+std::vector<AxisRequest> gPendingAxisDefinitions;  // Guarded by axisDataMutex
+std::map<std::string, bool> gAxisGroupEnabled;     // Latest OVERRIDE per group, guarded by axisDataMutex
 
 bool overrideJoystick = false;
 bool overridePedals = false;
@@ -175,6 +442,8 @@ static bool DEBUG = true;
 
 
 static float MyFlightLoopCallback(float inElapsedSinceLastCall, float inElapsedTimeSinceLastFlightLoop, int inCounter, void* inRefcon);
+static float DeferredRequestsCallback(float inElapsedSinceLastCall, float inElapsedTimeSinceLastFlightLoop, int inCounter, void* inRefcon);
+const float kDeferredRequestInterval = 0.05f;  // Seconds between checks for queued dataref work
 
 const float kt_2_mps = 0.51444f; // convert knots to meters per second
 const float radps_2_rpm = 9.5493f; // convert rad/sec to rev/min
@@ -223,18 +492,436 @@ void InitializeDebugLog() {
     }
 }
 
-void RegisterDataRef(const std::string& datarefPath, const std::string& key, const std::string& type, int precision = 3, float conversionFactor = 1.0f) {
-    // Find the dataref
+std::string TrimString(const std::string& text) {
+    const char* whitespace = " \t\r\n";
+    size_t first = text.find_first_not_of(whitespace);
+    if (first == std::string::npos) {
+        return "";
+    }
+    return text.substr(first, text.find_last_not_of(whitespace) - first + 1);
+}
+
+// Strict number parsing for network input: the whole text must be a number, so "12abc",
+// an empty value or an out of range value is rejected instead of read as far as it goes.
+bool ParseInt(const std::string& text, int& out) {
+    const char* begin = text.c_str();
+    char* end = nullptr;
+    errno = 0;
+    long value = std::strtol(begin, &end, 10);
+    if (end == begin || *end != 0 || errno == ERANGE || value < INT_MIN || value > INT_MAX) {
+        return false;
+    }
+    out = static_cast<int>(value);
+    return true;
+}
+
+bool ParseDouble(const std::string& text, double& out) {
+    const char* begin = text.c_str();
+    char* end = nullptr;
+    errno = 0;
+    double value = std::strtod(begin, &end);
+    if (end == begin || *end != 0 || errno == ERANGE || !std::isfinite(value)) {
+        return false;
+    }
+    out = value;
+    return true;
+}
+
+// Read "key=value" lines, '#' starts a comment. A missing file keeps the local defaults,
+// as does any value that is malformed or out of range.
+void LoadNetworkConfig(const std::string& path) {
+    std::ifstream configFile(path);
+    std::string line;
+    const NetworkConfig defaults;
+
+    while (std::getline(configFile, line)) {
+        line = TrimString(line.substr(0, line.find('#')));
+        size_t separator = line.find('=');
+        if (separator == std::string::npos) {
+            continue;
+        }
+
+        std::string key = TrimString(line.substr(0, separator));
+        std::string value = TrimString(line.substr(separator + 1));
+        int number = 0;
+        bool valid = true;
+        if (key == "remote_host") {
+            valid = !value.empty() && value.find_first_of(" \t") == std::string::npos;
+            if (valid) {
+                gNetworkConfig.remoteHost = value;
+            }
+        }
+        else if (key == "telemetry_port") {
+            valid = ParseInt(value, number) && number >= 1 && number <= 65535;
+            if (valid) {
+                gNetworkConfig.telemetryPort = number;
+            }
+        }
+        else if (key == "command_port") {
+            valid = ParseInt(value, number) && number >= 1 && number <= 65535;
+            if (valid) {
+                gNetworkConfig.commandPort = number;
+            }
+        }
+        else if (key == "mtu") {
+            // Up to the largest UDP payload over IPv4
+            valid = ParseInt(value, number) && number >= 256 && number <= 65507;
+            if (valid) {
+                gNetworkConfig.mtu = number;
+            }
+        }
+        else {
+            DebugLog("Unknown setting in " + path + ": " + key);
+        }
+        if (!valid) {
+            DebugLog("Invalid value in " + path + ", keeping the default: " + line);
+        }
+    }
+
+    // In local mode the plugin would read its own telemetry broadcast as commands
+    if (gNetworkConfig.telemetryPort == gNetworkConfig.commandPort) {
+        DebugLog("telemetry_port and command_port must differ, using the default ports");
+        gNetworkConfig.telemetryPort = defaults.telemetryPort;
+        gNetworkConfig.commandPort = defaults.commandPort;
+    }
+}
+
+// Resolve a host name or IPv4 address, false if it cannot be resolved
+bool ResolveHost(const std::string& host, struct in_addr& address) {
+    struct addrinfo hints;
+    struct addrinfo* result = nullptr;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+
+    if (getaddrinfo(host.c_str(), nullptr, &hints, &result) != 0 || result == nullptr) {
+        return false;
+    }
+    address = reinterpret_cast<struct sockaddr_in*>(result->ai_addr)->sin_addr;
+    freeaddrinfo(result);
+    return true;
+}
+
+// Send a reply message (e.g. "SUBSCRIBED:...") to the client on the telemetry socket
+void SendReply(const std::string& message) {
+    sendto(udpSocket_tx, message.c_str(), static_cast<int>(message.length()), 0, (struct sockaddr*)&serverAddr_tx, sizeof(serverAddr_tx));
+}
+
+// Pick the accessor for a dataref from the type bitmask X-Plane reports for it.
+// The requested type is used when the dataref supports it, otherwise the best
+// native type is chosen (double before float before int, scalars before arrays).
+bool ResolveDataRefType(XPLMDataRef dataRef, const std::string& requestedType, DataRefAccessor& accessor, std::string& typeName, int& size) {
+    XPLMDataTypeID types = XPLMGetDataRefTypes(dataRef);
+
+    struct Candidate {
+        const char* name;
+        XPLMDataTypeID typeBit;
+        DataRefAccessor accessor;
+    };
+    static const Candidate candidates[] = {
+        { "double", xplmType_Double, DataRefAccessor::Double },
+        { "float", xplmType_Float, DataRefAccessor::Float },
+        { "int", xplmType_Int, DataRefAccessor::Int },
+        { "float[]", xplmType_FloatArray, DataRefAccessor::FloatArray },
+        { "int[]", xplmType_IntArray, DataRefAccessor::IntArray },
+    };
+
+    const Candidate* chosen = nullptr;
+    for (const auto& candidate : candidates) {
+        if ((types & candidate.typeBit) && requestedType == candidate.name) {
+            chosen = &candidate;
+            break;
+        }
+    }
+
+    if (chosen == nullptr) {
+        if (!requestedType.empty() && requestedType != "auto") {
+            DebugLog("Requested type " + requestedType + " is not available, detecting type (type mask " + std::to_string(types) + ")");
+        }
+        for (const auto& candidate : candidates) {
+            if (types & candidate.typeBit) {
+                chosen = &candidate;
+                break;
+            }
+        }
+    }
+
+    if (chosen == nullptr) {
+        return false;
+    }
+
+    accessor = chosen->accessor;
+    typeName = chosen->name;
+    if (accessor == DataRefAccessor::FloatArray) {
+        size = XPLMGetDatavf(dataRef, nullptr, 0, 0);
+    }
+    else if (accessor == DataRefAccessor::IntArray) {
+        size = XPLMGetDatavi(dataRef, nullptr, 0, 0);
+    }
+    else {
+        size = 1;
+    }
+    return true;
+}
+
+// Find a dataref and resolve its type (sim thread, without axisDataMutex). The returned
+// subscription has a null dataRef when the dataref does not exist or has no usable type.
+DataRefSubscription ResolveSubscription(const std::string& datarefPath, const std::string& key, const std::string& type, int precision, double conversionFactor, CollectTier tier) {
     XPLMDataRef dataRef = XPLMFindDataRef(datarefPath.c_str());
-    if (dataRef != nullptr) {
-        // Store the dataref in the vector with precision and conversion factor
-        DataRefSubscription sub = { dataRef, key, type, precision, conversionFactor };
-        subscribedDataRefs.push_back(sub);
-        DebugLog("Subscribed to DataRef: " + datarefPath + " as " + type + " with key " + key + ", precision " + std::to_string(precision) + ", conversion factor " + std::to_string(conversionFactor));
+    DataRefSubscription sub = { dataRef, key.empty() ? datarefPath : key, "none", DataRefAccessor::Float, 0, precision, conversionFactor, tier };
+    if (dataRef != nullptr && !ResolveDataRefType(dataRef, type, sub.accessor, sub.type, sub.size)) {
+        sub.dataRef = nullptr;
+    }
+    return sub;
+}
+
+// Add a resolved subscription to the staging copy (axisDataMutex held) and report it
+void StageSubscription(const std::string& datarefPath, const DataRefSubscription& sub) {
+    if (sub.dataRef != nullptr) {
+        // A repeated SUBSCRIBE (e.g. resent after a lost reply) updates the existing subscription
+        auto existing = std::find_if(gStagedSubscriptions.begin(), gStagedSubscriptions.end(),
+            [&sub](const DataRefSubscription& other) { return other.key == sub.key; });
+        if (existing != gStagedSubscriptions.end()) {
+            *existing = sub;
+        }
+        else {
+            gStagedSubscriptions.push_back(sub);
+        }
+        gStagedSubscriptionsChanged = true;
+        DebugLog("Subscribed to DataRef: " + datarefPath + " as " + sub.type + "[" + std::to_string(sub.size) + "] with key " + sub.key + ", precision " + std::to_string(sub.precision) + ", conversion factor " + std::to_string(sub.conversionFactor));
     }
     else {
         DebugLog("Failed to subscribe to DataRef: " + datarefPath);
     }
+
+    // Report the resolved schema back to the client
+    SendReply("SUBSCRIBED:dataref=" + datarefPath + ",tag=" + sub.key + ",type=" + sub.type + ",size=" + std::to_string(sub.size));
+}
+
+// Resolve and stage in one go
+void RegisterDataRef(const std::string& datarefPath, const std::string& key, const std::string& type = "auto", int precision = 3, double conversionFactor = 1.0, CollectTier tier = CollectTier::Normal) {
+    StageSubscription(datarefPath, ResolveSubscription(datarefPath, key, type, precision, conversionFactor, tier));
+}
+
+// Declare or update a named axis (sim thread), replies "AXISDEFINED:name=..,id=..,targets=..".
+// The datarefs are looked up without axisDataMutex, which is only held to install the axis.
+void DefineAxis(const AxisRequest& request) {
+    const std::string& name = request.name;
+    const int index = request.index;
+    AxisDefinition axis = { name, request.group.empty() ? name : request.group, {}, std::max(index, 0), nullptr,
+        request.inMin, request.inMax, 1.0f, 0.0f, 0.0f, false, false };
+
+    // Several targets separated by '|', e.g. left and right brake
+    std::istringstream iss(request.datarefs);
+    std::string path;
+    while (std::getline(iss, path, '|')) {
+        XPLMDataRef dataRef = XPLMFindDataRef(path.c_str());
+        AxisTarget target = { dataRef, DataRefAccessor::Float };
+        std::string typeName;
+        int size = 0;
+
+        if (dataRef == nullptr || !XPLMCanWriteDataRef(dataRef) ||
+            !ResolveDataRefType(dataRef, index >= 0 ? "float[]" : "float", target.accessor, typeName, size)) {
+            DebugLog("Axis " + name + ": cannot write DataRef " + path);
+            continue;
+        }
+        if ((target.accessor == DataRefAccessor::FloatArray || target.accessor == DataRefAccessor::IntArray) && axis.index >= size) {
+            DebugLog("Axis " + name + ": index " + std::to_string(axis.index) + " out of range for " + path);
+            continue;
+        }
+        axis.targets.push_back(target);
+    }
+
+    if (!request.overrideDataRef.empty()) {
+        axis.overrideRef = XPLMFindDataRef(request.overrideDataRef.c_str());
+        if (axis.overrideRef == nullptr) {
+            DebugLog("Axis " + name + ": override DataRef not found: " + request.overrideDataRef);
+        }
+    }
+
+    if (request.inMax != request.inMin) {
+        axis.scale = (request.outMax - request.outMin) / (request.inMax - request.inMin);
+    }
+    axis.offset = request.outMin - request.inMin * axis.scale;
+
+    std::lock_guard<std::mutex> lock(axisDataMutex);
+
+    // An OVERRIDE may have arrived while the definition was queued
+    auto groupState = gAxisGroupEnabled.find(axis.group);
+    axis.enabled = groupState != gAxisGroupEnabled.end() && groupState->second;
+
+    size_t id;
+    auto existing = gAxisIndex.find(name);
+    if (existing != gAxisIndex.end()) {
+        // Keep the current value and group state, the flight loop applies the new override dataref
+        id = existing->second;
+        AxisDefinition& previous = gAxes[id];
+        axis.value = previous.value;
+        if (previous.group == axis.group) {
+            axis.enabled = previous.enabled;
+        }
+        if (previous.overrideRef == axis.overrideRef) {
+            axis.overrideApplied = previous.overrideApplied;
+        }
+        else if (previous.overrideApplied && previous.overrideRef != nullptr) {
+            // Release the old override dataref unless another active axis still holds it
+            bool shared = std::any_of(gAxes.begin(), gAxes.end(), [&previous](const AxisDefinition& other) {
+                return &other != &previous && other.overrideRef == previous.overrideRef && other.overrideApplied; });
+            if (!shared) {
+                XPLMSetDatai(previous.overrideRef, 0);
+            }
+        }
+        previous = axis;
+    }
+    else {
+        id = gAxes.size();
+        gAxes.push_back(axis);
+        gAxisIndex[name] = id;
+    }
+
+    DebugLog("Defined axis " + name + " (group " + axis.group + ") with " + std::to_string(axis.targets.size()) + " target(s)");
+    SendReply("AXISDEFINED:name=" + name + ",id=" + std::to_string(id) + ",targets=" + std::to_string(axis.targets.size()));
+}
+
+// The axes the backend has always sent, kept under their original names and groups
+void DefineBuiltInAxes() {
+    DefineAxis({ "jx", "joystick", "sim/joystick/yoke_roll_ratio", -1, "sim/operation/override/override_joystick_roll", -1.0f, 1.0f, -1.0f, 1.0f });
+    DefineAxis({ "jy", "joystick", "sim/joystick/yoke_pitch_ratio", -1, "sim/operation/override/override_joystick_pitch", -1.0f, 1.0f, -1.0f, 1.0f });
+    DefineAxis({ "px", "pedals", "sim/joystick/yoke_heading_ratio", -1, "sim/operation/override/override_joystick_heading", -1.0f, 1.0f, -1.0f, 1.0f });
+    DefineAxis({ "cy", "collective", "sim/cockpit2/engine/actuators/prop_ratio_all", -1, "sim/operation/override/override_prop_pitch", -1.0f, 1.0f, -1.0f, 1.0f });
+}
+
+// Publish the staged subscriptions to the flight loop (axisDataMutex held). Called once after
+// a batch of changes so a pattern costs one snapshot, not one per match.
+void PublishSubscriptions() {
+    if (!gStagedSubscriptionsChanged) {
+        return;
+    }
+    const SubscriptionSet* previous = gSubscriptionSnapshot.exchange(new SubscriptionSet(gStagedSubscriptions));
+    gRetiredSnapshots.emplace_back(previous);
+    gStagedSubscriptionsChanged = false;
+}
+
+// Free the snapshots replaced since the last call (receive thread)
+void FreeRetiredSnapshots() {
+    std::vector<std::unique_ptr<const SubscriptionSet>> retired;
+    {
+        std::lock_guard<std::mutex> lock(axisDataMutex);
+        retired.swap(gRetiredSnapshots);
+    }
+}
+
+bool IsDataRefSubscribed(const std::string& key) {
+    for (const auto& sub : gStagedSubscriptions) {
+        if (sub.key == key) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Glob match supporting '*' (any run of characters, including '/') and '?' (one character)
+bool GlobMatch(const char* pattern, const char* text) {
+    const char* starPattern = nullptr;
+    const char* starText = nullptr;
+
+    while (*text) {
+        if (*pattern == '?' || *pattern == *text) {
+            ++pattern;
+            ++text;
+        }
+        else if (*pattern == '*') {
+            starPattern = pattern++;
+            starText = text;
+        }
+        else if (starPattern) {
+            pattern = starPattern + 1;
+            text = ++starText;
+        }
+        else {
+            return false;
+        }
+    }
+
+    while (*pattern == '*') {
+        ++pattern;
+    }
+    return *pattern == 0;
+}
+
+bool IsGlobPattern(const std::string& path) {
+    return path.find_first_of("*?") != std::string::npos;
+}
+
+// Enumerate every registered dataref name. This walks the whole dataref table, so it only
+// runs when a pattern needs expanding and the cached index is stale, from DeferredRequestsCallback
+// on the sim thread without axisDataMutex held.
+// The XPLM400 enumeration functions are looked up at runtime so the plugin still loads on X-Plane 11.
+bool RefreshDataRefIndex() {
+    typedef decltype(&XPLMCountDataRefs) CountDataRefsFunc;
+    typedef decltype(&XPLMGetDataRefsByIndex) GetDataRefsByIndexFunc;
+    typedef decltype(&XPLMGetDataRefInfo) GetDataRefInfoFunc;
+
+    static HMODULE xplmModule = GetModuleHandleA("XPLM_64.dll");
+    static CountDataRefsFunc countDataRefs = reinterpret_cast<CountDataRefsFunc>(GetProcAddress(xplmModule, "XPLMCountDataRefs"));
+    static GetDataRefsByIndexFunc getDataRefsByIndex = reinterpret_cast<GetDataRefsByIndexFunc>(GetProcAddress(xplmModule, "XPLMGetDataRefsByIndex"));
+    static GetDataRefInfoFunc getDataRefInfo = reinterpret_cast<GetDataRefInfoFunc>(GetProcAddress(xplmModule, "XPLMGetDataRefInfo"));
+
+    if (!countDataRefs || !getDataRefsByIndex || !getDataRefInfo) {
+        DebugLog("DataRef enumeration is not available in this X-Plane version");
+        gDataRefIndexStale = false;  // Nothing to refresh, patterns will match nothing
+        return false;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    int count = countDataRefs();
+    std::vector<XPLMDataRef> dataRefs(count);
+    getDataRefsByIndex(0, count, dataRefs.data());
+
+    gDataRefIndex.clear();
+    gDataRefIndex.reserve(count);
+    for (XPLMDataRef dataRef : dataRefs) {
+        XPLMDataRefInfo_t info;
+        info.structSize = sizeof(info);
+        info.name = nullptr;
+        getDataRefInfo(dataRef, &info);
+        if (info.name) {
+            gDataRefIndex.emplace_back(info.name, dataRef);
+        }
+    }
+    gDataRefIndexStale = false;
+
+    auto elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    DebugLog("Indexed " + std::to_string(gDataRefIndex.size()) + " DataRefs in " + std::to_string(elapsedMs) + " ms");
+    return true;
+}
+
+// Resolve every dataref matching a pattern that is not subscribed yet (sim thread, without
+// axisDataMutex). Generated keys are tagPrefix + the part of the path after the pattern's literal prefix.
+int ResolvePatternSubscription(const PatternSubscription& patternSub, std::vector<std::pair<std::string, DataRefSubscription>>& resolved) {
+    if (gDataRefIndexStale) {
+        RefreshDataRefIndex();
+    }
+
+    size_t literalLength = patternSub.pattern.find_first_of("*?");
+    int added = 0;
+    for (const auto& entry : gDataRefIndex) {
+        const std::string& path = entry.first;
+        if (!GlobMatch(patternSub.pattern.c_str(), path.c_str())) {
+            continue;
+        }
+
+        std::string key = patternSub.tagPrefix.empty() ? path : patternSub.tagPrefix + path.substr(literalLength);
+        if (IsDataRefSubscribed(key)) {
+            continue;
+        }
+
+        resolved.emplace_back(path, ResolveSubscription(path, key, patternSub.type, patternSub.precision, patternSub.conversionFactor, patternSub.tier));
+        ++added;
+    }
+    return added;
 }
 
 
@@ -255,17 +942,47 @@ void InitializeAW109DataRefs() {
 
 
 
-std::string FloatToString(float value, int precision, float conversionFactor = 1.0) {
-    value *= conversionFactor; // Apply the conversion factor
-    std::ostringstream stream;
-    stream << std::fixed << std::setprecision(precision) << value;
-    return stream.str();
+// The channel for a key, marked as sampled in this frame
+TelemetryChannel& SampleChannel(const std::string& key) {
+    TelemetryChannel& channel = telemetryData[key];
+    channel.sampledFrame = gTelemetryFrame;
+    return channel;
 }
 
-// Function to convert an array of floats to a formatted string with an optional conversion factor
-// If fixed size is passed, that many elements (including trailiing zero vaues) will be returned
-// Otherwise, the size is calculated, result formatted and any trailing 0 values are trimmed from the result
-std::string FloatArrayToString(XPLMDataRef dataRef, float conversionFactor = 1.0, int fixed_size = -1, int precision = 3) {
+// Store a scalar channel. A precision of 0 encodes the value as an integer.
+void SetTelemetryValue(const std::string& key, double value, int precision = 3) {
+    TelemetryChannel& channel = SampleChannel(key);
+    channel.values.assign(1, value);
+    channel.precision = precision;
+    channel.isText = false;
+}
+
+void SetTelemetryInt(const std::string& key, int value) {
+    SetTelemetryValue(key, value, 0);
+}
+
+void SetTelemetryText(const std::string& key, const std::string& text) {
+    TelemetryChannel& channel = SampleChannel(key);
+    channel.values.clear();
+    channel.text = text;
+    channel.isText = true;
+}
+
+// Store a channel made of a fixed list of values (e.g. the components of a vector)
+void SetTelemetryValues(const std::string& key, std::initializer_list<double> values, int precision = 3) {
+    TelemetryChannel& channel = SampleChannel(key);
+    channel.values.assign(values);
+    channel.precision = precision;
+    channel.isText = false;
+}
+
+// Read an array of floats into a channel with an optional conversion factor
+// If fixed size is passed, that many elements (including trailiing zero vaues) will be kept
+// Otherwise, the size is calculated and any trailing 0 values are trimmed from the result
+void SetTelemetryArray(const std::string& key, XPLMDataRef dataRef, double conversionFactor = 1.0, int fixed_size = -1, int precision = 3) {
+    // Scratch buffer reused across frames, only touched from the flight loop
+    static std::vector<float> dataArray;
+
     // Determine the size of the array
     int size = XPLMGetDatavf(dataRef, nullptr, 0, 0);
 
@@ -275,49 +992,400 @@ std::string FloatArrayToString(XPLMDataRef dataRef, float conversionFactor = 1.0
         size = fixed_size;
     }
 
-
-    // Use std::vector for dynamic memory allocation
-    std::vector<float> dataArray(size);
+    if (static_cast<int>(dataArray.size()) < size) {
+        dataArray.resize(size);
+    }
 
     // Retrieve the entire array of values
     XPLMGetDatavf(dataRef, dataArray.data(), 0, size);
 
-    std::ostringstream formattedString;
-
-    // Set precision for floating-point values
-    formattedString << std::fixed << std::setprecision(precision);
+    TelemetryChannel& channel = SampleChannel(key);
+    channel.values.resize(size);
+    channel.precision = precision;
+    channel.isText = false;
 
     for (int i = 0; i < size; ++i) {
-        // Convert each value with specified precision before applying conversion factor
-        float value = dataArray[i] * conversionFactor;
+        channel.values[i] = dataArray[i] * conversionFactor;
+    }
+
+    if (fixed_size <= 0) {
+        // Trim trailing zero values, keeping at least one element
+        while (channel.values.size() > 1 && channel.values.back() == 0.0) {
+            channel.values.pop_back();
+        }
+    }
+}
+
+// Read an array of ints into a channel, keeping fixed_size elements
+void SetTelemetryIntArray(const std::string& key, XPLMDataRef dataRef, int fixed_size) {
+    // Scratch buffer reused across frames, only touched from the flight loop
+    static std::vector<int> dataArray;
+
+    int size = XPLMGetDatavi(dataRef, nullptr, 0, 0);
+    if (fixed_size > 0 && fixed_size <= size) {
+        size = fixed_size;
+    }
+
+    if (static_cast<int>(dataArray.size()) < size) {
+        dataArray.resize(size);
+    }
+
+    XPLMGetDatavi(dataRef, dataArray.data(), 0, size);
+
+    TelemetryChannel& channel = SampleChannel(key);
+    channel.values.assign(dataArray.begin(), dataArray.begin() + size);
+    channel.precision = 0;
+    channel.isText = false;
+}
+
+// Append the wire representation of a channel to a packet ("1.234", "3", "1.0~2.0~3.0" or text)
+void EncodeTelemetryChannel(std::string& out, const TelemetryChannel& channel) {
+    if (channel.isText) {
+        out += channel.text;
+        return;
+    }
+
+    // Reduced channels send the result over the interval instead of the current frame
+    bool useReduced = channel.reduce != ReduceMode::Last && channel.samples > 0 && channel.reduced.size() == channel.values.size();
+    const std::vector<double>& values = useReduced ? channel.reduced : channel.values;
+    double divisor = useReduced && channel.reduce == ReduceMode::Mean ? channel.samples : 1.0;
+
+    char buffer[64];
+    for (size_t i = 0; i < values.size(); ++i) {
+        if (i > 0) {
+            out += '~';  // Add tilde separator between values, except for the last one
+        }
+        int len = snprintf(buffer, sizeof(buffer), "%.*f", channel.precision, values[i] / divisor);
+        if (len > 0) {
+            out.append(buffer, std::min(len, static_cast<int>(sizeof(buffer)) - 1));
+        }
+    }
+}
+
+
+void UpdateForcePassthrough(double elapsed) {
+    if (!gForcePassthrough) {
+        if (gForcePassthroughActive) {
+            SetTelemetryValues("XPForce", { 0.0, 0.0, 0.0 }, 4);
+            gForcePassthroughActive = false;
+        }
+        return;
+    }
+
+    double raw[3] = { XPLMGetDataf(gStickForceRoll), XPLMGetDataf(gStickForcePitch), XPLMGetDataf(gStickForceYaw) };
+
+    // Start the filter from the current force instead of ramping up from zero
+    double alpha = 1.0;
+    float filterHz = gForceFilterHz;
+    if (gForcePassthroughActive && filterHz > 0.0f && elapsed > 0.0) {
+        double tau = 1.0 / (2.0 * 3.14159265358979 * filterHz);
+        alpha = elapsed / (tau + elapsed);
+    }
+    gForcePassthroughActive = true;
+
+    double fullScale = std::max(static_cast<float>(gForceFullScaleLb), 0.1f);
+    double limit = gForceLimit;
+    double normalized[3];
+    for (int i = 0; i < 3; ++i) {
+        gForceFiltered[i] += alpha * (raw[i] - gForceFiltered[i]);
+        normalized[i] = std::min(std::max(gForceFiltered[i] / fullScale, -limit), limit);
+    }
 
-        formattedString << std::setprecision(precision) << value;
+    SetTelemetryValues("XPForce", { normalized[0], normalized[1], normalized[2] }, 4);
+}
+
+// Stop predicting a channel: forget its state and remove "<key>_pred", so no frozen
+// prediction is left behind for the backend to use
+void ClearPrediction(const std::string& key, ChannelPredictor& predictor) {
+    if (predictor.published) {
+        telemetryData.erase(key + "_pred");
+        gReduceModesChanged = true;  // gReducedChannels may point at the erased channel
+        for (auto& entry : gPredictors) {
+            entry.second.source = nullptr;
+        }
+    }
+    PredictMode mode = predictor.mode;
+    predictor = ChannelPredictor();
+    predictor.mode = mode;
+}
+
+// Update the derivative estimates of the predicted channels and publish their predictions
+void UpdatePredictions() {
+    if (gPredictModesChanged) {
+        std::lock_guard<std::mutex> lock(axisDataMutex);
+        gPredictModesChanged = false;
+        for (const auto& entry : gPredictModes) {
+            ChannelPredictor& predictor = gPredictors[entry.first];
+            predictor.mode = entry.second;
+            if (predictor.mode == PredictMode::Off) {
+                ClearPrediction(entry.first, predictor);
+            }
+        }
+    }
+
+    if (gPredictors.empty() || simPaused) {
+        return;
+    }
+
+    if (gPredictHorizonMs <= 0) {
+        for (auto& entry : gPredictors) {
+            ClearPrediction(entry.first, entry.second);
+        }
+        SetTelemetryInt("PredHorizonMs", 0);
+        return;
+    }
+
+    const double horizon = gPredictHorizonMs / 1000.0;
+    const double pendingInterval = horizon / (ChannelPredictor::kPending / 2);
+    const double smoothing = 0.5;  // Derivative filter, trades noise for lag
+    const double errorSmoothing = 0.05;
+
+    for (auto& entry : gPredictors) {
+        ChannelPredictor& predictor = entry.second;
+        if (predictor.mode == PredictMode::Off) {
+            continue;
+        }
+        if (predictor.source == nullptr) {
+            auto found = telemetryData.find(entry.first);
+            if (found == telemetryData.end()) {
+                continue;  // Channel not collected (yet)
+            }
+            predictor.source = &found->second;
+        }
+        if (predictor.source->isText || predictor.source->values.size() != 1) {
+            continue;
+        }
+
+        double value = predictor.source->values[0];
+        double dt = gSimTime - predictor.lastTime;
+        if (predictor.lastTime < 0.0 || dt <= 0.0 || dt > 0.5) {
+            // First sample or a gap (pause, replay): start over
+            predictor.lastValue = value;
+            predictor.lastTime = gSimTime;
+            predictor.rate = 0.0;
+            predictor.accel = 0.0;
+            predictor.pendingCount = 0;
+            predictor.lastPendingTime = -1.0;
+            continue;
+        }
+
+        double rate = (value - predictor.lastValue) / dt;
+        double accel = (rate - predictor.rate) / dt;
+        predictor.rate += smoothing * (rate - predictor.rate);
+        predictor.accel += smoothing * (accel - predictor.accel);
+        predictor.lastValue = value;
+        predictor.lastTime = gSimTime;
+
+        // Score predictions whose target time has been reached
+        while (predictor.pendingCount > 0) {
+            int oldest = (predictor.pendingHead - predictor.pendingCount + ChannelPredictor::kPending) % ChannelPredictor::kPending;
+            if (predictor.pendingTime[oldest] > gSimTime) {
+                break;
+            }
+            double error = std::fabs(predictor.pendingValue[oldest] - value);
+            predictor.errorBound = predictor.matured == 0 ? error : predictor.errorBound + errorSmoothing * (error - predictor.errorBound);
+            predictor.matured++;
+            predictor.pendingCount--;
+        }
+
+        double predicted = value + predictor.rate * horizon;
+        if (predictor.mode == PredictMode::Quadratic) {
+            predicted += 0.5 * predictor.accel * horizon * horizon;
+        }
+
+        if (predictor.lastPendingTime < 0.0 || gSimTime - predictor.lastPendingTime >= pendingInterval) {
+            predictor.pendingTime[predictor.pendingHead] = gSimTime + horizon;
+            predictor.pendingValue[predictor.pendingHead] = predicted;
+            predictor.pendingHead = (predictor.pendingHead + 1) % ChannelPredictor::kPending;
+            predictor.pendingCount = std::min(predictor.pendingCount + 1, ChannelPredictor::kPending);
+            predictor.lastPendingTime = gSimTime;
+        }
+
+        // No bound is known before the first prediction matured, so nothing is sent until then
+        if (predictor.matured > 0) {
+            SetTelemetryValues(entry.first + "_pred", { predicted, predictor.errorBound }, std::max(predictor.source->precision, 3));
+            predictor.published = true;
+        }
+    }
+
+    SetTelemetryInt("PredHorizonMs", gPredictHorizonMs);
+}
+
+bool ParseReduceMode(const std::string& name, ReduceMode& mode) {
+    static const std::map<std::string, ReduceMode> modes = {
+        { "last", ReduceMode::Last },
+        { "mean", ReduceMode::Mean },
+        { "min", ReduceMode::Min },
+        { "max", ReduceMode::Max },
+        { "peak", ReduceMode::Peak },
+        { "lowpass", ReduceMode::LowPass },
+    };
+    auto found = modes.find(name);
+    if (found == modes.end()) {
+        return false;
+    }
+    mode = found->second;
+    return true;
+}
+
+// Pick up REDUCE changes and channels created since the last frame
+void UpdateReducedChannels() {
+    if (!gReduceModesChanged && telemetryData.size() == gReducedChannelsSeen) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(axisDataMutex);
+    gReduceModesChanged = false;
+    gReducedChannels.clear();
+
+    for (auto& entry : telemetryData) {
+        auto found = gReduceModes.find(entry.first);
+        ReduceMode mode = found != gReduceModes.end() ? found->second : ReduceMode::Last;
+        if (entry.second.reduce != mode) {
+            entry.second.reduce = mode;
+            entry.second.reduced.clear();
+            entry.second.samples = 0;
+        }
+        if (mode != ReduceMode::Last) {
+            gReducedChannels.push_back(&entry.second);
+        }
+    }
+    gReducedChannelsSeen = telemetryData.size();
+}
+
+// Fold this frame's values into the reduction state, O(1) per element
+void AccumulateReductions(double elapsed, double sendHz) {
+    UpdateReducedChannels();
+
+    // Low-pass cutoff at half the send rate to avoid aliasing when sampling at the send rate
+    double alpha = 1.0;
+    if (sendHz > 0.0 && elapsed > 0.0) {
+        double tau = 1.0 / (3.14159265358979 * sendHz);
+        alpha = elapsed / (tau + elapsed);
+    }
+
+    for (TelemetryChannel* channel : gReducedChannels) {
+        if (channel->isText || channel->sampledFrame != gTelemetryFrame) {
+            continue;  // Not read this frame, its values are from an earlier frame
+        }
+
+        const std::vector<double>& values = channel->values;
+        std::vector<double>& reduced = channel->reduced;
+
+        // The low-pass state carries over between sends, the others start again with each interval
+        bool restart = channel->samples == 0 && channel->reduce != ReduceMode::LowPass;
+        if (restart || reduced.size() != values.size()) {
+            reduced = values;
+            channel->samples = 1;
+            continue;
+        }
+
+        for (size_t i = 0; i < values.size(); ++i) {
+            switch (channel->reduce) {
+            case ReduceMode::Mean:
+                reduced[i] += values[i];
+                break;
+            case ReduceMode::Min:
+                reduced[i] = std::min(reduced[i], values[i]);
+                break;
+            case ReduceMode::Max:
+                reduced[i] = std::max(reduced[i], values[i]);
+                break;
+            case ReduceMode::Peak:
+                if (std::fabs(values[i]) > std::fabs(reduced[i])) {
+                    reduced[i] = values[i];
+                }
+                break;
+            case ReduceMode::LowPass:
+                reduced[i] += alpha * (values[i] - reduced[i]);
+                break;
+            default:
+                break;
+            }
+        }
+        channel->samples++;
+    }
+}
+
+void ResetReductions() {
+    for (TelemetryChannel* channel : gReducedChannels) {
+        channel->samples = 0;
+    }
+}
+
+// Adapt the send rate to a FLOW report of the backend (receive thread)
+void UpdateFlowControl(double achievedHz, int queueDepth, double capacityHz) {
+    std::lock_guard<std::mutex> lock(axisDataMutex);
+    FlowControl& flow = gFlow;
+    double maxHz = flow.maxHz > 0.0 ? flow.maxHz : kFlowUnboundedHz;
+    // Aim for 80% of the backend's capacity, so it keeps up with short load spikes
+    if (capacityHz > 0.0) {
+        maxHz = std::min(maxHz, std::max(capacityHz * 0.8, flow.minHz));
+    }
+    if (flow.sendHz <= 0.0) {
+        flow.sendHz = maxHz;
+    }
+
+    bool overloaded = queueDepth > kFlowQueueHigh || (capacityHz > 0.0 && flow.sendHz > capacityHz * 0.95);
+    bool headroom = queueDepth <= 1 && (capacityHz <= 0.0 || flow.sendHz < 0.6 * capacityHz);
+
+    if (overloaded) {
+        // Multiplicative decrease, at least down to what the backend actually managed
+        double target = flow.sendHz * 0.7;
+        if (capacityHz > 0.0) {
+            target = std::min(target, capacityHz * 0.8);
+        }
+        if (achievedHz > 0.0) {
+            target = std::min(target, achievedHz);
+        }
+        flow.sendHz = std::max(target, flow.minHz);
+        flow.goodReports = 0;
+    }
+    else if (headroom) {
+        // Additive increase, only after several reports in a row
+        if (++flow.goodReports >= kFlowIncreaseReports) {
+            flow.sendHz = std::min(flow.sendHz + std::max(5.0, flow.sendHz * 0.1), maxHz);
+            flow.goodReports = 0;
+        }
+    }
+    else {
+        flow.goodReports = 0;  // Inside the hysteresis band: hold the rate
+    }
 
-        //if (dataRef == gPropRPM) {
-        //    DebugLog("PropRPM:" + formattedString.str());
-        //}
+    flow.lastReport = std::chrono::steady_clock::now();
+    gFlowSendHz = flow.sendHz;
+}
 
-        if (i < size - 1) {
-            formattedString << "~";  // Add tilde separator between values, except for the last one
+// The send rate in effect: adapted by flow control, else send_hz (0 = every frame)
+double CurrentSendHz() {
+    if (gFlowEnabled && gFlowSendHz > 0.0) {
+        std::chrono::steady_clock::time_point lastReport;
+        {
+            std::lock_guard<std::mutex> lock(axisDataMutex);
+            lastReport = gFlow.lastReport;
+        }
+        if (std::chrono::duration<double>(std::chrono::steady_clock::now() - lastReport).count() < kFlowStaleSeconds) {
+            return gFlowSendHz;
         }
     }
+    return gSendHz;
+}
 
-    if (fixed_size > 0) {
-        // if fixed size was passed, return whole formatted string, including trailing 0.000 values
-        return formattedString.str();
+// True when a telemetry packet is due at the current send rate
+bool SendIntervalElapsed(double elapsed, double sendHz) {
+    if (sendHz <= 0.0) {
+        return true;
     }
 
-    // Trim instances of "~0" from the right side of the string
-    std::string result = formattedString.str();
-    size_t pos = result.find_last_not_of("~0.000");
-    if (pos != std::string::npos) {
-        result = result.substr(0, pos + 1);
+    double interval = 1.0 / sendHz;
+    gSendAccumulator += elapsed;
+    if (gSendAccumulator < interval) {
+        return false;
     }
-
-    return result;
+    gSendAccumulator = std::fmod(gSendAccumulator, interval);
+    return true;
 }
 
-
 int GetNumGear() {
     // Use std::vector for dynamic memory allocation
     int size = 10;
@@ -349,23 +1417,222 @@ void GetACDetails(const std::string& aircraftName) {
     gActiveNumEngines = XPLMGetDatai(gNumEngines);
     gActiveNumGear = GetNumGear();
 
-    telemetryData["RetractableGear"] = std::to_string(XPLMGetDatai(gRetractable));
-    telemetryData["NumberEngines"] = std::to_string(gActiveNumEngines);
-    telemetryData["NumberGear"] = std::to_string(gActiveNumGear);
-    telemetryData["WarnAlpha"] = FloatToString(XPLMGetDataf(gWarnAlpha), 3);
-    telemetryData["Vne"] = FloatToString(XPLMGetDataf(gVne) * kt_2_mps, 3);
-    telemetryData["Vso"] = FloatToString(XPLMGetDataf(gVso) * kt_2_mps, 3);
-    telemetryData["Vfe"] = FloatToString(XPLMGetDataf(gVfe) * kt_2_mps, 3);
-    telemetryData["Vle"] = FloatToString(XPLMGetDataf(gVle) * kt_2_mps, 3);
+    SetTelemetryInt("RetractableGear", XPLMGetDatai(gRetractable));
+    SetTelemetryInt("NumberEngines", gActiveNumEngines);
+    SetTelemetryInt("NumberGear", gActiveNumGear);
+    SetTelemetryValue("WarnAlpha", XPLMGetDataf(gWarnAlpha));
+    SetTelemetryValue("Vne", XPLMGetDataf(gVne) * kt_2_mps);
+    SetTelemetryValue("Vso", XPLMGetDataf(gVso) * kt_2_mps);
+    SetTelemetryValue("Vfe", XPLMGetDataf(gVfe) * kt_2_mps);
+    SetTelemetryValue("Vle", XPLMGetDataf(gVle) * kt_2_mps);
 
-    telemetryData["GearXNode"] = FloatArrayToString(gGearXNode, no_convert, gActiveNumGear);
-    telemetryData["GearYNode"] = FloatArrayToString(gGearYNode, no_convert, gActiveNumGear);
-    telemetryData["GearZNode"] = FloatArrayToString(gGearZNode, no_convert, gActiveNumGear);
+    SetTelemetryArray("GearXNode", gGearXNode, no_convert, gActiveNumGear);
+    SetTelemetryArray("GearYNode", gGearYNode, no_convert, gActiveNumGear);
+    SetTelemetryArray("GearZNode", gGearZNode, no_convert, gActiveNumGear);
 
     //InitializeAW109DataRefs();
 
+    // Add-on datarefs appear with the aircraft, so pattern subscriptions need expanding again
+    gDataRefIndexStale = true;
+
+}
+
+void ReadSubscription(const DataRefSubscription& sub) {
+    switch (sub.accessor) {
+    case DataRefAccessor::Int:
+        SetTelemetryInt(sub.key, XPLMGetDatai(sub.dataRef));
+        break;
+    case DataRefAccessor::Float:
+        SetTelemetryValue(sub.key, XPLMGetDataf(sub.dataRef) * sub.conversionFactor, sub.precision);  // Apply conversion factor, custom precision
+        break;
+    case DataRefAccessor::Double:
+        SetTelemetryValue(sub.key, XPLMGetDatad(sub.dataRef) * sub.conversionFactor, sub.precision);  // Kept as a double end to end
+        break;
+    case DataRefAccessor::FloatArray:
+        SetTelemetryArray(sub.key, sub.dataRef, sub.conversionFactor, sub.size, sub.precision);
+        break;
+    case DataRefAccessor::IntArray:
+        SetTelemetryIntArray(sub.key, sub.dataRef, sub.size);
+        break;
+    }
+}
+
+// Read the current value(s) of a query dataref into a channel
+void ReadQueryDataRef(const QueryDataRef& query, TelemetryChannel& channel) {
+    switch (query.accessor) {
+    case DataRefAccessor::Int:
+        channel.values.assign(1, XPLMGetDatai(query.dataRef));
+        channel.precision = 0;
+        break;
+    case DataRefAccessor::Float:
+        channel.values.assign(1, XPLMGetDataf(query.dataRef));
+        break;
+    case DataRefAccessor::Double:
+        channel.values.assign(1, XPLMGetDatad(query.dataRef));
+        channel.precision = 9;
+        break;
+    case DataRefAccessor::FloatArray: {
+        std::vector<float> values(std::max(XPLMGetDatavf(query.dataRef, nullptr, 0, 0), 0));
+        XPLMGetDatavf(query.dataRef, values.data(), 0, static_cast<int>(values.size()));
+        channel.values.assign(values.begin(), values.end());
+        break;
+    }
+    case DataRefAccessor::IntArray: {
+        std::vector<int> values(std::max(XPLMGetDatavi(query.dataRef, nullptr, 0, 0), 0));
+        XPLMGetDatavi(query.dataRef, values.data(), 0, static_cast<int>(values.size()));
+        channel.values.assign(values.begin(), values.end());
+        channel.precision = 0;
+        break;
+    }
+    }
+}
+
+// Answer the QUERY commands received since the last frame. Each reply is
+// "RESULT:id=..,part=i/n,path=value,..."; unknown datarefs have an empty value and
+// results bigger than the MTU are split into parts at entry boundaries.
+void AnswerPendingQueries() {
+    std::vector<DataRefQuery> queries;
+    {
+        std::lock_guard<std::mutex> lock(axisDataMutex);
+        queries.swap(gPendingQueries);
+    }
+
+    for (const auto& query : queries) {
+        std::vector<std::string> entries;
+
+        for (const auto& path : query.paths) {
+            auto cached = gQueryDataRefCache.find(path);
+            if (cached == gQueryDataRefCache.end()) {
+                QueryDataRef resolved = { XPLMFindDataRef(path.c_str()), DataRefAccessor::Float, false };
+                std::string typeName;
+                int size = 0;
+                resolved.valid = resolved.dataRef != nullptr && ResolveDataRefType(resolved.dataRef, "auto", resolved.accessor, typeName, size);
+                cached = gQueryDataRefCache.insert(std::make_pair(path, resolved)).first;
+            }
+
+            std::string entry = path + "=";
+            if (cached->second.valid) {
+                TelemetryChannel channel;
+                channel.precision = 6;
+                ReadQueryDataRef(cached->second, channel);
+                EncodeTelemetryChannel(entry, channel);
+            }
+            entries.push_back(entry);
+        }
+
+        std::vector<std::string> parts(1);
+        for (const auto& entry : entries) {
+            if (!parts.back().empty() && parts.back().size() + entry.size() + 64 > static_cast<size_t>(gNetworkConfig.mtu)) {
+                parts.push_back("");
+            }
+            parts.back() += "," + entry;
+        }
+
+        for (size_t i = 0; i < parts.size(); ++i) {
+            SendReply("RESULT:id=" + query.id + ",part=" + std::to_string(i + 1) + "/" + std::to_string(parts.size()) + parts[i]);
+        }
+    }
+}
+
+// Every 2^n frames for a tier at the current degradation level
+int TierFrameDivisor(CollectTier tier, int degradeLevel) {
+    if (tier == CollectTier::Low) {
+        return 1 << std::min(degradeLevel, 4);
+    }
+    if (tier == CollectTier::Normal) {
+        return 1 << std::max(degradeLevel - 4, 0);
+    }
+    return 1;
+}
+
+// Read critical subscriptions, then optional ones round-robin until the budget is spent.
+// The budget covers the optional reads only and at least one is read every frame, so slow
+// built-in or critical reads cannot starve them. Reads that do not fit are picked up first
+// on the next frame.
+void CollectSubscriptions(const SubscriptionSet& subscriptions) {
+    CollectScheduler& sched = gCollectScheduler;
+    const double budgetUs = gCollectBudgetUs;
+    const size_t count = subscriptions.size();
+
+    sched.frame++;
+    sched.deferred = 0;
+
+    for (const auto& sub : subscriptions) {
+        if (sub.tier == CollectTier::Critical) {
+            ReadSubscription(sub);
+        }
+    }
+
+    if (sched.cursor >= count) {
+        sched.cursor = 0;
+    }
+
+    auto optionalStart = std::chrono::steady_clock::now();
+    bool readOptional = false;
+
+    for (size_t n = 0; n < count; ++n) {
+        size_t index = (sched.cursor + n) % count;
+        const DataRefSubscription& sub = subscriptions[index];
+        if (sub.tier == CollectTier::Critical) {
+            continue;
+        }
+
+        // Spread slowed-down tiers evenly over the frames instead of reading them all at once
+        int divisor = TierFrameDivisor(sub.tier, sched.degradeLevel);
+        if ((sched.frame + index) % divisor != 0) {
+            continue;
+        }
+
+        double elapsedUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - optionalStart).count();
+        if (readOptional && elapsedUs > budgetUs) {
+            // Out of budget: resume from here next frame. Only reads due this frame count as
+            // deferred, not the ones a slowed-down tier skips anyway.
+            for (size_t m = n; m < count; ++m) {
+                size_t restIndex = (sched.cursor + m) % count;
+                const DataRefSubscription& rest = subscriptions[restIndex];
+                if (rest.tier != CollectTier::Critical &&
+                    (sched.frame + restIndex) % TierFrameDivisor(rest.tier, sched.degradeLevel) == 0) {
+                    sched.deferred++;
+                }
+            }
+            sched.cursor = index;
+            return;
+        }
+
+        ReadSubscription(sub);
+        readOptional = true;
+    }
+}
+
+// Degrade quickly when the budget is exceeded repeatedly, recover slowly once well under it
+void UpdateCollectDegradation(double collectUs) {
+    CollectScheduler& sched = gCollectScheduler;
+    const double budgetUs = gCollectBudgetUs;
+
+    if (collectUs > budgetUs || sched.deferred > 0) {
+        sched.underBudgetFrames = 0;
+        if (++sched.overBudgetFrames >= kDegradeAfterFrames && sched.degradeLevel < kMaxDegradeLevel) {
+            sched.degradeLevel++;
+            sched.overBudgetFrames = 0;
+            DebugLog("Telemetry collection over budget (" + std::to_string(static_cast<int>(collectUs)) + " us), degrade level " + std::to_string(sched.degradeLevel));
+        }
+    }
+    else if (collectUs < budgetUs * 0.5) {
+        sched.overBudgetFrames = 0;
+        if (++sched.underBudgetFrames >= kRecoverAfterFrames && sched.degradeLevel > 0) {
+            sched.degradeLevel--;
+            sched.underBudgetFrames = 0;
+            DebugLog("Telemetry collection back under budget, degrade level " + std::to_string(sched.degradeLevel));
+        }
+    }
+    else {
+        sched.overBudgetFrames = 0;
+        sched.underBudgetFrames = 0;
+    }
 }
 
+void CollectBuiltInTelemetry();
+
 void CollectTelemetryData()
 {
 
@@ -384,86 +1651,89 @@ void CollectTelemetryData()
         std::strcpy(gPrevAircraftName, gAircraftName);
     }
 
-    for (const auto& sub : subscribedDataRefs) {
-        if (sub.type == "int") {
-            int value = XPLMGetDatai(sub.dataRef);
-            telemetryData[sub.key] = std::to_string(value);  // Store in telemetryData map
-        }
-        else if (sub.type == "float") {
-            float value = XPLMGetDataf(sub.dataRef) * sub.conversionFactor;  // Apply conversion factor
-            telemetryData[sub.key] = FloatToString(value, sub.precision);    // Use custom precision
-        }
-        else if (sub.type == "double") {
-            double value = XPLMGetDatad(sub.dataRef) * sub.conversionFactor;  // Apply conversion factor
-            telemetryData[sub.key] = FloatToString(static_cast<float>(value), sub.precision);  // Store in telemetryData map
-        }
-        else {
-            DebugLog("Unsupported dataref type: " + sub.type);
-        }
-    }
+    auto collectStart = std::chrono::steady_clock::now();
+
+    CollectBuiltInTelemetry();
+    // Snapshot taken at the frame boundary, it is not replaced before the frame is collected
+    const SubscriptionSet* subscriptions = gSubscriptionSnapshot.load();
+    CollectSubscriptions(*subscriptions);
+
+    double collectUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - collectStart).count();
+    UpdateCollectDegradation(collectUs);
 
-    telemetryData["src"] = "XPLANE";
-    telemetryData["N"] = gAircraftName;
-    telemetryData["STOP"] = std::to_string(XPLMGetDatai(gPaused));
+    SetTelemetryValue("CollectUs", collectUs, 1);
+    SetTelemetryInt("CollectBudgetUs", gCollectBudgetUs);
+    SetTelemetryInt("CollectDegrade", gCollectScheduler.degradeLevel);
+    SetTelemetryInt("CollectDeferred", gCollectScheduler.deferred);
+    SetTelemetryInt("NetRx", gReceivedPackets);
+    SetTelemetryInt("NetRejected", gRejectedPackets);
+}
+
+// Channels every client relies on, always read in full
+void CollectBuiltInTelemetry()
+{
+    SetTelemetryText("src", "XPLANE");
+    SetTelemetryText("N", gAircraftName);
+    SetTelemetryInt("STOP", XPLMGetDatai(gPaused));
 
     simPaused = XPLMGetDatai(gPaused) == 1;
 
-    telemetryData["SimPaused"] = std::to_string(simPaused);  // Store as string for telemetry
+    SetTelemetryInt("SimPaused", simPaused);
 
-    telemetryData["SimOnGround"] = std::to_string(XPLMGetDatai(gOnGround));
+    SetTelemetryInt("SimOnGround", XPLMGetDatai(gOnGround));
 
-    telemetryData["T"] = FloatToString(XPLMGetElapsedTime(), 3);
-    telemetryData["G"] = FloatToString(XPLMGetDataf(gGs_nrml), 3);
-    telemetryData["Gaxil"] = FloatToString(XPLMGetDataf(gGs_axil), 3);
-    telemetryData["Gside"] = FloatToString(XPLMGetDataf(gGs_side), 3);
+    SetTelemetryValue("T", gSimTime, 6);
+    SetTelemetryValue("G", XPLMGetDataf(gGs_nrml));
+    SetTelemetryValue("Gaxil", XPLMGetDataf(gGs_axil));
+    SetTelemetryValue("Gside", XPLMGetDataf(gGs_side));
 
-    telemetryData["TAS"] = FloatToString(XPLMGetDataf(gTAS), 3);
-    telemetryData["IAS"] = FloatToString(XPLMGetDataf(gIAS) * kt_2_mps, 3); //convert from kt t m/s to match with gTAS
-    telemetryData["AirDensity"] = FloatToString(XPLMGetDataf(gAirDensity), 3);
-    telemetryData["DynPressure"] = FloatToString(XPLMGetDataf(gDynPress), 3);
-    telemetryData["AoA"] = FloatToString(XPLMGetDataf(gAoA), 3);
+    SetTelemetryValue("TAS", XPLMGetDataf(gTAS));
+    SetTelemetryValue("IAS", XPLMGetDataf(gIAS) * kt_2_mps); //convert from kt t m/s to match with gTAS
+    SetTelemetryValue("AirDensity", XPLMGetDataf(gAirDensity));
+    SetTelemetryValue("DynPressure", XPLMGetDataf(gDynPress));
+    SetTelemetryValue("AoA", XPLMGetDataf(gAoA));
 
-    telemetryData["SideSlip"] = FloatToString(XPLMGetDataf(gSlip), 3);
+    SetTelemetryValue("SideSlip", XPLMGetDataf(gSlip));
 
 
-    telemetryData["WeightOnWheels"] = FloatArrayToString(gWoW, no_convert, 3);
-    telemetryData["EngRPM"] = FloatArrayToString(gEngRPM, radps_2_rpm, gActiveNumEngines, 2);
-    telemetryData["EngPCT"] = FloatArrayToString(gEngPCT, no_convert, gActiveNumEngines, 3);
-    telemetryData["PropRPM"] = FloatArrayToString(gPropRPM, radps_2_rpm, gActiveNumEngines, 2);
-    telemetryData["PropThrust"] = FloatArrayToString(gPropThrust,no_convert, gActiveNumEngines, 2);
-    telemetryData["Afterburner"] = FloatArrayToString(gAfterburner,no_convert, gActiveNumEngines, 2);
+    SetTelemetryArray("WeightOnWheels", gWoW, no_convert, 3);
+    SetTelemetryArray("EngRPM", gEngRPM, radps_2_rpm, gActiveNumEngines, 2);
+    SetTelemetryArray("EngPCT", gEngPCT, no_convert, gActiveNumEngines, 3);
+    SetTelemetryArray("PropRPM", gPropRPM, radps_2_rpm, gActiveNumEngines, 2);
+    SetTelemetryArray("PropThrust", gPropThrust, no_convert, gActiveNumEngines, 2);
+    SetTelemetryArray("Afterburner", gAfterburner, no_convert, gActiveNumEngines, 2);
 
 
-    telemetryData["RudderDefl"] = FloatToString(XPLMGetDataf(gRudDefl_l), 3);
-    telemetryData["RudderDefl_l"] = FloatToString(XPLMGetDataf(gRudDefl_l), 3);
-    telemetryData["RudderDefl_r"] = FloatToString(XPLMGetDataf(gRudDefl_r), 3);
+    SetTelemetryValue("RudderDefl", XPLMGetDataf(gRudDefl_l));
+    SetTelemetryValue("RudderDefl_l", XPLMGetDataf(gRudDefl_l));
+    SetTelemetryValue("RudderDefl_r", XPLMGetDataf(gRudDefl_r));
 
     // Stick Force data from X-Plane
-    telemetryData["StickForcePitch"] = FloatToString(XPLMGetDataf(gStickForcePitch), 3);
-    telemetryData["StickForceRoll"] = FloatToString(XPLMGetDataf(gStickForceRoll), 3);
-    telemetryData["StickForceYaw"] = FloatToString(XPLMGetDataf(gStickForceYaw), 3);
+    SetTelemetryValue("StickForcePitch", XPLMGetDataf(gStickForcePitch));
+    SetTelemetryValue("StickForceRoll", XPLMGetDataf(gStickForceRoll));
+    SetTelemetryValue("StickForceYaw", XPLMGetDataf(gStickForceYaw));
 
-    telemetryData["AccBody"] =  FloatToString(XPLMGetDataf(gAccLocal_x) * fps_2_g, 3) + "~" + FloatToString(XPLMGetDataf(gAccLocal_y) * fps_2_g, 3) + "~" + FloatToString(XPLMGetDataf(gAccLocal_z) * fps_2_g, 3);
-    telemetryData["VelAcf"] =  FloatToString(XPLMGetDataf(gVelAcf_x), 3) + "~" + FloatToString(XPLMGetDataf(gVelAcf_y), 3) + "~" + FloatToString(-XPLMGetDataf(gVelAcf_z), 3);
-    telemetryData["Flaps"] = FloatToString(XPLMGetDataf(gFlaps), 3);
-    telemetryData["Gear"] = FloatArrayToString(gGear, no_convert, 3);
+    SetTelemetryValues("AccBody", { XPLMGetDataf(gAccLocal_x) * fps_2_g, XPLMGetDataf(gAccLocal_y) * fps_2_g, XPLMGetDataf(gAccLocal_z) * fps_2_g });
+    SetTelemetryValues("VelAcf", { XPLMGetDataf(gVelAcf_x), XPLMGetDataf(gVelAcf_y), -XPLMGetDataf(gVelAcf_z) });
+    SetTelemetryValue("Flaps", XPLMGetDataf(gFlaps));
+    SetTelemetryArray("Gear", gGear, no_convert, 3);
 
-    telemetryData["APMode"] = std::to_string(XPLMGetDatai(gAPMode));
-    telemetryData["APServos"] = std::to_string(XPLMGetDatai(gAPServos));
-    telemetryData["APYawServo"] = FloatToString(XPLMGetDataf(gYawServo), 3);
-    telemetryData["APPitchServo"] = FloatToString(XPLMGetDataf(gPitchServo), 3);
-    telemetryData["APRollServo"] = FloatToString(XPLMGetDataf(gRollServo), 3);
-    telemetryData["ElevTrimPct"] = FloatToString(XPLMGetDataf(gElevTrim), 3);
-    telemetryData["AileronTrimPct"] = FloatToString(XPLMGetDataf(gAilerTrim), 3);
-    telemetryData["RudderTrimPct"] = FloatToString(XPLMGetDataf(gRudderTrim), 3);
+    SetTelemetryInt("APMode", XPLMGetDatai(gAPMode));
+    SetTelemetryInt("APServos", XPLMGetDatai(gAPServos));
+    SetTelemetryValue("APYawServo", XPLMGetDataf(gYawServo));
+    SetTelemetryValue("APPitchServo", XPLMGetDataf(gPitchServo));
+    SetTelemetryValue("APRollServo", XPLMGetDataf(gRollServo));
+    SetTelemetryValue("ElevTrimPct", XPLMGetDataf(gElevTrim));
+    SetTelemetryValue("AileronTrimPct", XPLMGetDataf(gAilerTrim));
+    SetTelemetryValue("RudderTrimPct", XPLMGetDataf(gRudderTrim));
 
-    telemetryData["CanopyPos"] = FloatToString(XPLMGetDataf(gCanopyPos), 3);
-    telemetryData["SpeedbrakePos"] = FloatToString(XPLMGetDataf(gSpeedbrakePos), 3);
+    SetTelemetryValue("CanopyPos", XPLMGetDataf(gCanopyPos));
+    SetTelemetryValue("SpeedbrakePos", XPLMGetDataf(gSpeedbrakePos));
 
 
-    telemetryData["cOvrd"] = std::to_string(overrideCollective);
-    telemetryData["jOvrd"] = std::to_string(overrideJoystick);
-    telemetryData["pOvrd"] = std::to_string(overridePedals);
+    SetTelemetryInt("cOvrd", overrideCollective);
+    SetTelemetryInt("jOvrd", overrideJoystick);
+    SetTelemetryInt("pOvrd", overridePedals);
 
 
 
@@ -476,12 +1746,159 @@ void FormatAndSendTelemetryData()
     // Create a string with the data for UDP transmission
     std::string dataString;
 
+    std::vector<size_t> entryEnds;  // End of each "key=value;" entry, for splitting
+
     for (const auto& entry : telemetryData) {
-        dataString += entry.first + "=" + entry.second + ";";
+        dataString += entry.first;
+        dataString += '=';
+        EncodeTelemetryChannel(dataString, entry.second);
+        dataString += ';';
+        entryEnds.push_back(dataString.size());
+    }
+
+    // Every frame carries its sequence number so the receiver can count lost frames
+    std::string header = "Seq=" + std::to_string(++gTelemetrySeq) + ";";
+
+    if (header.size() + dataString.size() <= static_cast<size_t>(gNetworkConfig.mtu)) {
+        std::string packet = header + dataString;
+        sendto(udpSocket_tx, packet.c_str(), static_cast<int>(packet.length()), 0, (struct sockaddr*)&serverAddr_tx, sizeof(serverAddr_tx));
+        return;
+    }
+
+    // Too big for one datagram: split at entry boundaries into "Seq=n;Frag=i/count;..." fragments.
+    // The receiver only uses a frame once all its fragments arrived, so a lost fragment drops
+    // the frame instead of mixing old and new values. An entry larger than the MTU goes out alone.
+    const size_t room = gNetworkConfig.mtu - header.size() - 16;  // 16: "Frag=iii/nnn;"
+    std::vector<std::pair<size_t, size_t>> fragments;
+    size_t start = 0;
+    size_t end = 0;
+
+    for (size_t entryEnd : entryEnds) {
+        if (entryEnd - start > room && end > start) {
+            fragments.push_back(std::make_pair(start, end));
+            start = end;
+        }
+        end = entryEnd;
+    }
+    if (end > start) {
+        fragments.push_back(std::make_pair(start, end));
+    }
+
+    for (size_t i = 0; i < fragments.size(); ++i) {
+        std::string packet = header + "Frag=" + std::to_string(i + 1) + "/" + std::to_string(fragments.size()) + ";" +
+            dataString.substr(fragments[i].first, fragments[i].second - fragments[i].first);
+        sendto(udpSocket_tx, packet.c_str(), static_cast<int>(packet.length()), 0, (struct sockaddr*)&serverAddr_tx, sizeof(serverAddr_tx));
+    }
+}
+
+// Scheduling priority of the plugin I/O thread, requested with CONFIG:io_priority=..
+enum class ThreadPriority {
+    Normal,
+    AboveNormal,
+    High,
+    Realtime
+};
+
+const char* ThreadPriorityName(ThreadPriority priority) {
+    switch (priority) {
+    case ThreadPriority::AboveNormal: return "above_normal";
+    case ThreadPriority::High: return "high";
+    case ThreadPriority::Realtime: return "realtime";
+    default: return "normal";
+    }
+}
+
+ThreadPriority ParseThreadPriority(const std::string& name) {
+    if (name == "above_normal") return ThreadPriority::AboveNormal;
+    if (name == "high") return ThreadPriority::High;
+    if (name == "realtime") return ThreadPriority::Realtime;
+    return ThreadPriority::Normal;
+}
+
+// CPU bit mask in decimal, checked like ParseInt (strtoull alone would accept "-1")
+bool ParseAffinityMask(const std::string& text, unsigned long long& out) {
+    const char* begin = text.c_str();
+    char* end = nullptr;
+    errno = 0;
+    unsigned long long value = std::strtoull(begin, &end, 10);
+    if (end == begin || *end != 0 || errno == ERANGE || text.find('-') != std::string::npos) {
+        return false;
+    }
+    out = value;
+    return true;
+}
+
+// Apply priority and CPU affinity (bit mask, 0 = no restriction) to the calling thread.
+// Settings the OS does not permit fall back to the closest lower one; the effective
+// values are written back and the function returns false if anything fell back.
+bool ApplyCurrentThreadScheduling(ThreadPriority& priority, unsigned long long& affinityMask) {
+    bool applied = true;
+
+    static const int winPriority[] = { THREAD_PRIORITY_NORMAL, THREAD_PRIORITY_ABOVE_NORMAL, THREAD_PRIORITY_HIGHEST, THREAD_PRIORITY_TIME_CRITICAL };
+    HANDLE thread = GetCurrentThread();
+
+    while (!SetThreadPriority(thread, winPriority[static_cast<int>(priority)]) && priority != ThreadPriority::Normal) {
+        priority = static_cast<ThreadPriority>(static_cast<int>(priority) - 1);
+        applied = false;
+    }
+
+    if (affinityMask != 0 && SetThreadAffinityMask(thread, static_cast<DWORD_PTR>(affinityMask)) == 0) {
+        affinityMask = 0;
+        applied = false;
+    }
+
+    return applied;
+}
+
+// Runs on the receive thread itself, which is the thread being configured
+void ConfigureIoThread(ThreadPriority priority, unsigned long long affinityMask) {
+    bool applied = ApplyCurrentThreadScheduling(priority, affinityMask);
+
+    DebugLog(std::string("I/O thread scheduling: priority=") + ThreadPriorityName(priority) + ", affinity=" + std::to_string(affinityMask) + (applied ? "" : " (fallback)"));
+    SendReply("THREAD:name=io,priority=" + std::string(ThreadPriorityName(priority)) + ",affinity=" + std::to_string(affinityMask) + ",fallback=" + (applied ? "0" : "1"));
+}
+
+// Parse a "key=value,key=value" command payload
+std::map<std::string, std::string> ParseParameters(const std::string& payload) {
+    std::istringstream iss(payload);
+    std::string key, value;
+    std::map<std::string, std::string> parameters;
+
+    while (std::getline(iss, key, '=')) {
+        std::getline(iss, value, ',');
+        parameters[key] = value;
+    }
+    return parameters;
+}
+
+// Optional numeric command parameters: true when the key is absent (out keeps its default)
+// or holds a valid number, false and logged when the value is malformed
+bool ReadIntParameter(const std::map<std::string, std::string>& parameters, const char* key, int& out) {
+    auto found = parameters.find(key);
+    if (found == parameters.end() || ParseInt(found->second, out)) {
+        return true;
+    }
+    DebugLog(std::string("Invalid value for ") + key + ": " + found->second);
+    return false;
+}
+
+bool ReadDoubleParameter(const std::map<std::string, std::string>& parameters, const char* key, double& out) {
+    auto found = parameters.find(key);
+    if (found == parameters.end() || ParseDouble(found->second, out)) {
+        return true;
     }
+    DebugLog(std::string("Invalid value for ") + key + ": " + found->second);
+    return false;
+}
 
-    // Send the data over the UDP socket
-    sendto(udpSocket_tx, dataString.c_str(), dataString.length(), 0, (struct sockaddr*)&serverAddr_tx, sizeof(serverAddr_tx));
+CollectTier ParseCollectTier(const std::string& priority) {
+    if (priority == "critical") {
+        return CollectTier::Critical;
+    }
+    if (priority == "low") {
+        return CollectTier::Low;
+    }
+    return CollectTier::Normal;
 }
 
 void ProcessReceivedData(const std::string& dataType, const std::string& payload) {
@@ -493,14 +1910,40 @@ void ProcessReceivedData(const std::string& dataType, const std::string& payload
         while (std::getline(iss, token, ',')) {
             size_t equalsPos = token.find('=');
             if (equalsPos != std::string::npos) {
-                std::string key = token.substr(0, equalsPos);
-                float value = std::stof(token.substr(equalsPos + 1));
-                axisDataMap[key] = value;
+                auto axis = gAxisIndex.find(token.substr(0, equalsPos));
+                double value = 0.0;
+                if (axis != gAxisIndex.end() && ParseDouble(token.substr(equalsPos + 1), value)) {
+                    gAxes[axis->second].value = static_cast<float>(value);
+                }
             }
         }
-
-        // Perform actions based on AXIS data
-        // ...
+    }
+    else if (dataType == "AXISDEF") {
+        // e.g. "name=lbrake,dataref=sim/cockpit2/controls/left_brake_ratio,group=brakes,
+        //       override=sim/operation/override/override_toe_brakes,in_min=-1,in_max=1,out_min=0,out_max=1"
+        // dataref may list several targets separated by '|', index selects an array element
+        std::map<std::string, std::string> parameters = ParseParameters(payload);
+        bool valid = true;
+        auto number = [&parameters, &valid](const char* key, float fallback) {
+            double value = fallback;
+            valid = ReadDoubleParameter(parameters, key, value) && valid;
+            return static_cast<float>(value);
+        };
+        int index = -1;
+        valid = ReadIntParameter(parameters, "index", index) && valid;
+        AxisRequest request = { parameters["name"], parameters["group"], parameters["dataref"], index, parameters["override"],
+            number("in_min", -1.0f), number("in_max", 1.0f), number("out_min", -1.0f), number("out_max", 1.0f) };
+
+        if (request.name.empty() || request.datarefs.empty()) {
+            DebugLog("AXISDEF needs name and dataref: " + payload);
+        }
+        else if (!valid) {
+            DebugLog("Ignoring AXISDEF with invalid parameters: " + payload);
+        }
+        else {
+            // Resolved and installed on the sim thread
+            gPendingAxisDefinitions.push_back(request);
+        }
     }
     else if (dataType == "OVERRIDE") {
         // Parse the payload for keyword and value
@@ -516,53 +1959,199 @@ void ProcessReceivedData(const std::string& dataType, const std::string& payload
             DebugLog("Received Keyword: " + keyword);
             DebugLog("Stream Content: " + payload);
             DebugLog("Parsed overrideValue: " + std::to_string(overrideValue));
-            // Handle "OVERRIDE" data type based on keywords
-            if (keyword == "joystick") {
-                //DebugLog("Inside the joystick block");
-
-                XPLMSetDatai(gRollOvd, overrideValue ? 1 : 0);
-                XPLMSetDatai(gPitchOvd, overrideValue ? 1 : 0);
+            // Enable every axis in the group; the flight loop sets their override datarefs
+            gAxisGroupEnabled[keyword] = overrideValue;
+            bool known = false;
+            for (auto& axis : gAxes) {
+                if (axis.group == keyword) {
+                    axis.enabled = overrideValue;
+                    known = true;
+                }
+            }
 
+            if (keyword == "joystick") {
                 overrideJoystick = overrideValue;
             }
             else if (keyword == "pedals") {
-                XPLMSetDatai(gYawOvd, overrideValue ? 1 : 0);
                 overridePedals = overrideValue;
-
             }
             else if (keyword == "collective") {
-                XPLMSetDatai(gCollectiveOvd, overrideValue ? 1 : 0);
                 overrideCollective = overrideValue;
             }
-            else {
-                // Unknown or unsupported keyword
-                // Handle accordingly or log a warning
+            else if (!known) {
+                DebugLog("OVERRIDE for unknown axis group: " + keyword);
             }
         }
     }
     else if (dataType == "SUBSCRIBE") {
         // Example payload format: "dataref=sim/flightmodel/position/latitude,type=float,tag=Latitude,precision=6,conversion=0.51444"
-        std::istringstream iss(payload);
-        std::string key, value;
-        std::map<std::string, std::string> parameters;
-
-        // Parse key-value pairs (dataref, type, tag, precision, conversion)
-        while (std::getline(iss, key, '=')) {
-            std::getline(iss, value, ',');
-            parameters[key] = value;
-        }
+        // Only dataref is required: type defaults to auto detection and tag to the dataref path
+        // priority=critical|normal|low selects the collection tier (default normal)
+        std::map<std::string, std::string> parameters = ParseParameters(payload);
 
         // Extract mandatory parameters
         std::string datarefStr = parameters["dataref"];
-        std::string typeStr = parameters["type"];
+        std::string typeStr = parameters.find("type") != parameters.end() ? parameters["type"] : "auto";
         std::string tagStr = parameters["tag"];
 
         // Extract optional parameters with default values
-        int precision = parameters.find("precision") != parameters.end() ? std::stoi(parameters["precision"]) : 3;
-        float conversionFactor = parameters.find("conversion") != parameters.end() ? std::stof(parameters["conversion"]) : 1.0f;
+        int precision = 3;
+        double conversionFactor = 1.0;
+        if (!ReadIntParameter(parameters, "precision", precision) || !ReadDoubleParameter(parameters, "conversion", conversionFactor)) {
+            DebugLog("Ignoring SUBSCRIBE with invalid parameters: " + payload);
+            return;
+        }
+        precision = std::min(std::max(precision, 0), 12);
+        CollectTier tier = ParseCollectTier(parameters["priority"]);
+
+        // Optional reduction of the new channel, same modes as REDUCE
+        ReduceMode reduceMode;
+        if (!IsGlobPattern(datarefStr) && ParseReduceMode(parameters["reduce"], reduceMode)) {
+            gReduceModes[tagStr.empty() ? datarefStr : tagStr] = reduceMode;
+            gReduceModesChanged = true;
+        }
+
+        if (IsGlobPattern(datarefStr)) {
+            // e.g. "dataref=aw109/controls/*,tag=AW109_" subscribes every matching dataref
+            // Expanded on the sim thread, which owns the dataref index
+            PatternSubscription patternSub = { datarefStr, tagStr, typeStr, precision, conversionFactor, tier };
+            gPendingPatterns.push_back(patternSub);
+        }
+        else {
+            // Looked up on the sim thread with the provided or default precision and conversion factor
+            SubscribeRequest request = { datarefStr, tagStr, typeStr, precision, conversionFactor, tier };
+            gPendingSubscribes.push_back(request);
+        }
+    }
+    else if (dataType == "REDUCE") {
+        // e.g. "G=peak,WeightOnWheels=max,TAS=mean,AoA=lowpass", "last" restores plain sampling
+        std::map<std::string, std::string> parameters = ParseParameters(payload);
+        for (const auto& parameter : parameters) {
+            ReduceMode mode;
+            if (ParseReduceMode(parameter.second, mode)) {
+                gReduceModes[parameter.first] = mode;
+            }
+            else {
+                DebugLog("Unknown reduce mode for " + parameter.first + ": " + parameter.second);
+            }
+        }
+        gReduceModesChanged = true;
+    }
+    else if (dataType == "QUERY") {
+        // e.g. "id=7,datarefs=sim/aircraft/view/acf_Vne|sim/aircraft/parts/acf_gear_znodef"
+        // Read once on the next frame instead of subscribing for good
+        std::map<std::string, std::string> parameters = ParseParameters(payload);
+        DataRefQuery query;
+        query.id = parameters["id"];
+
+        std::istringstream paths(parameters["datarefs"]);
+        std::string path;
+        while (std::getline(paths, path, '|')) {
+            if (!path.empty()) {
+                query.paths.push_back(path);
+            }
+        }
+        gPendingQueries.push_back(query);
+    }
+    else if (dataType == "PREDICT") {
+        // e.g. "G=quadratic,AoA=linear,IAS=off"
+        std::map<std::string, std::string> parameters = ParseParameters(payload);
+        for (const auto& parameter : parameters) {
+            if (parameter.second == "linear") {
+                gPredictModes[parameter.first] = PredictMode::Linear;
+            }
+            else if (parameter.second == "quadratic") {
+                gPredictModes[parameter.first] = PredictMode::Quadratic;
+            }
+            else {
+                gPredictModes[parameter.first] = PredictMode::Off;
+            }
+        }
+        gPredictModesChanged = true;
+    }
+    else if (dataType == "FLOW") {
+        // e.g. "rate=58.2,queue=0,capacity=410.5", sent by the backend a few times per second
+        std::map<std::string, std::string> parameters = ParseParameters(payload);
+        if (gFlowEnabled) {
+            double achievedHz = 0.0;
+            int queueDepth = 0;
+            double capacityHz = 0.0;
+            // A malformed report is dropped rather than adapting the rate to half of it
+            if (ReadDoubleParameter(parameters, "rate", achievedHz) && ReadIntParameter(parameters, "queue", queueDepth) &&
+                ReadDoubleParameter(parameters, "capacity", capacityHz)) {
+                UpdateFlowControl(std::max(achievedHz, 0.0), std::max(queueDepth, 0), std::max(capacityHz, 0.0));
+            }
+        }
+    }
+    else if (dataType == "PING") {
+        // Echoed back as is, the client measures the round trip time
+        SendReply("PONG:" + payload);
+    }
+    else if (dataType == "CONFIG") {
+        // Runtime settings, e.g. "collect_budget_us=500"
+        std::map<std::string, std::string> parameters = ParseParameters(payload);
+
+        int collectBudgetUs = 0;
+        if (parameters.count("collect_budget_us") && ReadIntParameter(parameters, "collect_budget_us", collectBudgetUs)) {
+            gCollectBudgetUs = std::max(collectBudgetUs, 50);
+            DebugLog("Telemetry collection budget set to " + std::to_string(gCollectBudgetUs) + " us");
+        }
 
-        // Register the dataref with the provided or default precision and conversion factor
-        RegisterDataRef(datarefStr, tagStr, typeStr, precision, conversionFactor);
+        int forcePassthrough = 0;
+        double forceValue = 0.0;
+        if (parameters.count("force_passthrough") && ReadIntParameter(parameters, "force_passthrough", forcePassthrough)) {
+            gForcePassthrough = forcePassthrough != 0;
+        }
+        if (parameters.count("force_full_scale_lb") && ReadDoubleParameter(parameters, "force_full_scale_lb", forceValue)) {
+            gForceFullScaleLb = static_cast<float>(forceValue);
+        }
+        if (parameters.count("force_filter_hz") && ReadDoubleParameter(parameters, "force_filter_hz", forceValue)) {
+            gForceFilterHz = static_cast<float>(std::max(forceValue, 0.0));
+        }
+        if (parameters.count("force_limit") && ReadDoubleParameter(parameters, "force_limit", forceValue)) {
+            gForceLimit = static_cast<float>(std::min(std::max(forceValue, 0.0), 1.0));
+        }
+
+        int predictHorizonMs = 0;
+        if (parameters.count("predict_horizon_ms") && ReadIntParameter(parameters, "predict_horizon_ms", predictHorizonMs)) {
+            gPredictHorizonMs = std::min(std::max(predictHorizonMs, 0), 200);
+        }
+
+        int sendHz = 0;
+        if (parameters.count("send_hz") && ReadIntParameter(parameters, "send_hz", sendHz)) {
+            gSendHz = std::max(sendHz, 0);
+            DebugLog("Telemetry send rate set to " + (gSendHz > 0 ? std::to_string(gSendHz) + " Hz" : std::string("every frame")));
+        }
+
+        if (parameters.find("flow_control") != parameters.end() || parameters.find("flow_min_hz") != parameters.end() ||
+            parameters.find("flow_max_hz") != parameters.end()) {
+            std::lock_guard<std::mutex> lock(axisDataMutex);
+            double flowHz = 0.0;
+            int flowControl = 0;
+            if (parameters.count("flow_min_hz") && ReadDoubleParameter(parameters, "flow_min_hz", flowHz)) {
+                gFlow.minHz = std::max(flowHz, 1.0);
+            }
+            if (parameters.count("flow_max_hz") && ReadDoubleParameter(parameters, "flow_max_hz", flowHz)) {
+                gFlow.maxHz = std::max(flowHz, 0.0);
+            }
+            if (parameters.count("flow_control") && ReadIntParameter(parameters, "flow_control", flowControl)) {
+                gFlowEnabled = flowControl != 0;
+            }
+            // Start over from the next report within the new bounds
+            gFlow.sendHz = 0.0;
+            gFlow.goodReports = 0;
+            gFlowSendHz = 0.0;
+        }
+
+        if (parameters.find("io_priority") != parameters.end() || parameters.find("io_affinity") != parameters.end()) {
+            unsigned long long affinityMask = 0;
+            if (parameters.count("io_affinity") && !ParseAffinityMask(parameters["io_affinity"], affinityMask)) {
+                DebugLog("Invalid value for io_affinity: " + parameters["io_affinity"]);
+            }
+            else {
+                ConfigureIoThread(ParseThreadPriority(parameters["io_priority"]), affinityMask);
+            }
+        }
     }
     else {
         DebugLog("Unknown Packet: " + payload);
@@ -572,13 +2161,20 @@ void ProcessReceivedData(const std::string& dataType, const std::string& payload
 }
 
 void ReceiveData() {
-    char buffer[1024];
+    char buffer[4096];
     int recvlen;
     struct sockaddr_in senderAddr;
     int senderAddrSize = sizeof(senderAddr);
 
-    recvlen = recvfrom(udpSocket_rx, buffer, sizeof(buffer), 0, (struct sockaddr*)&senderAddr, &senderAddrSize);
+    recvlen = recvfrom(udpSocket_rx, buffer, sizeof(buffer) - 1, 0, (struct sockaddr*)&senderAddr, &senderAddrSize);
+    if (recvlen > 0 && gRemoteMode && senderAddr.sin_addr.s_addr != gRemoteAddr.s_addr) {
+        // In remote mode only the configured FFB host may send commands
+        gRejectedPackets++;
+        return;
+    }
     if (recvlen > 0) {
+        gReceivedPackets++;
+
         // Process the received message
         buffer[recvlen] = 0; // Null-terminate the received data
 
@@ -592,8 +2188,14 @@ void ReceiveData() {
         {
             std::lock_guard<std::mutex> lock(axisDataMutex);
 
-            // Call the processing function with the parsed data
-            ProcessReceivedData(dataType, payload);
+            // Call the processing function with the parsed data. Nothing may escape the
+            // detached receive thread, an uncaught exception would terminate X-Plane.
+            try {
+                ProcessReceivedData(dataType, payload);
+            }
+            catch (const std::exception& e) {
+                DebugLog("Error processing " + dataType + " packet: " + e.what());
+            }
 
             //DebugLog("Received Data - Type: " + dataType + ", Payload: " + payload);
         }
@@ -603,28 +2205,46 @@ void ReceiveData() {
 void ReceiveThread() {
     while (!gTerminateReceiveThread) {
         ReceiveData();
+        FreeRetiredSnapshots();
         //std::this_thread::sleep_for(std::chrono::milliseconds(1));
     }
 }
 
 void SendAxisPosition() {
     std::lock_guard<std::mutex> lock(axisDataMutex);
-    if (overrideJoystick) {
-        float jx = axisDataMap["jx"];
-        float jy = axisDataMap["jy"];
- 
-        XPLMSetDataf(gRollRatio, jx);
-        XPLMSetDataf(gPitchRatio, jy);
-        //DebugLog("Send Axis: x=" + FloatToString(jx, 4) + ", y=" + FloatToString(jy, 4));
-    }
-    if (overridePedals) {
-        float px = axisDataMap["px"];
- 
-        XPLMSetDataf(gYawRatio, px);
-    }
-    if (overrideCollective) {
-        float cy = axisDataMap["cy"];
-        XPLMSetDataf(gCollectiveRatio, cy);
+    for (auto& axis : gAxes) {
+        if (axis.enabled != axis.overrideApplied) {
+            if (axis.overrideRef != nullptr) {
+                XPLMSetDatai(axis.overrideRef, axis.enabled ? 1 : 0);
+            }
+            axis.overrideApplied = axis.enabled;
+        }
+        if (!axis.enabled) {
+            continue;
+        }
+
+        float value = axis.offset + std::min(std::max(axis.value, axis.inMin), axis.inMax) * axis.scale;
+        for (const auto& target : axis.targets) {
+            switch (target.accessor) {
+            case DataRefAccessor::Float:
+                XPLMSetDataf(target.dataRef, value);
+                break;
+            case DataRefAccessor::Double:
+                XPLMSetDatad(target.dataRef, value);
+                break;
+            case DataRefAccessor::Int:
+                XPLMSetDatai(target.dataRef, static_cast<int>(std::lround(value)));
+                break;
+            case DataRefAccessor::FloatArray:
+                XPLMSetDatavf(target.dataRef, &value, axis.index, 1);
+                break;
+            case DataRefAccessor::IntArray: {
+                int intValue = static_cast<int>(std::lround(value));
+                XPLMSetDatavi(target.dataRef, &intValue, axis.index, 1);
+                break;
+            }
+            }
+        }
     }
 }
 
@@ -682,11 +2302,27 @@ PLUGIN_API int XPluginStart(char* outName, char* outSig, char* outDesc)
         return 0;
     }
 
+    LoadNetworkConfig("FSFFB_Config.txt");
+
+    if (!gNetworkConfig.remoteHost.empty()) {
+        if (ResolveHost(gNetworkConfig.remoteHost, gRemoteAddr)) {
+            gRemoteMode = true;
+        }
+        else {
+            XPLMDebugString(("FSFFB-XPP: cannot resolve remote_host " + gNetworkConfig.remoteHost + ", using local mode\n").c_str());
+        }
+    }
+
     // Set up server address information
     memset(&serverAddr_tx, 0, sizeof(serverAddr_tx));
     serverAddr_tx.sin_family = AF_INET;
-    serverAddr_tx.sin_port = htons(34390); // Set the desired port number
-    serverAddr_tx.sin_addr.s_addr = inet_addr("127.255.255.255"); // Send to localhost (127.0.0.1)
+    serverAddr_tx.sin_port = htons(static_cast<u_short>(gNetworkConfig.telemetryPort)); // Set the desired port number
+    if (gRemoteMode) {
+        serverAddr_tx.sin_addr = gRemoteAddr;  // Unicast to the FFB host
+    }
+    else {
+        serverAddr_tx.sin_addr.s_addr = inet_addr("127.255.255.255"); // Send to localhost (127.0.0.1)
+    }
 
 
     udpSocket_rx = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
@@ -701,24 +2337,41 @@ PLUGIN_API int XPluginStart(char* outName, char* outSig, char* outDesc)
     // Set up server address information for the receive socket
     memset(&serverAddr_rx, 0, sizeof(serverAddr_rx));
     serverAddr_rx.sin_family = AF_INET;
-    serverAddr_rx.sin_port = htons(34391);  // Set the desired port number for receiving
-    serverAddr_rx.sin_addr.s_addr = inet_addr("127.0.0.1");
-    bind(udpSocket_rx, (struct sockaddr*)&serverAddr_rx, sizeof(serverAddr_rx));
+    serverAddr_rx.sin_port = htons(static_cast<u_short>(gNetworkConfig.commandPort));  // Set the desired port number for receiving
+    serverAddr_rx.sin_addr.s_addr = gRemoteMode ? htonl(INADDR_ANY) : inet_addr("127.0.0.1");  // Remote commands are filtered by sender
+    if (bind(udpSocket_rx, (struct sockaddr*)&serverAddr_rx, sizeof(serverAddr_rx)) != 0) {
+        XPLMDebugString(("FSFFB-XPP: cannot listen for commands on port " + std::to_string(gNetworkConfig.commandPort) + "\n").c_str());
+    }
+
+    if (gRemoteMode) {
+        XPLMDebugString(("FSFFB-XPP: remote mode, telemetry to " + gNetworkConfig.remoteHost + ":" + std::to_string(gNetworkConfig.telemetryPort) +
+            ", commands on port " + std::to_string(gNetworkConfig.commandPort) + "\n").c_str());
+    }
+
+    // Wake the receive thread periodically so it notices shutdown
+    DWORD receiveTimeoutMs = 250;
+    setsockopt(udpSocket_rx, SOL_SOCKET, SO_RCVTIMEO, (const char*)&receiveTimeoutMs, sizeof(receiveTimeoutMs));
+
+    // Ask for XPLM_MSG_DATAREFS_ADDED so pattern subscriptions pick up datarefs registered later
+    if (XPLMHasFeature("XPLM_WANTS_DATAREF_NOTIFICATIONS")) {
+        XPLMEnableFeature("XPLM_WANTS_DATAREF_NOTIFICATIONS", 1);
+    }
 
 
     /* Register our callback for once a second.  Positive intervals
      * are in seconds, negative are the negative of sim frames.  Zero
      * registers but does not schedule a callback for time. */
+    DefineBuiltInAxes();
+
     XPLMRegisterFlightLoopCallback(
         MyFlightLoopCallback, /* Callback */
         -1,                  /* Interval */
         NULL);                /* refcon not used. */
+    XPLMRegisterFlightLoopCallback(DeferredRequestsCallback, kDeferredRequestInterval, NULL);
 
     std::thread receiveThread(ReceiveThread);
     receiveThread.detach();  // Detach the thread to allow it to run independently
 
-    //XPLMSetDatai(gRollOvd, 1);
-    //XPLMSetDatai(gPitchOvd, 1);
     return 1;
 }
 
@@ -726,6 +2379,8 @@ PLUGIN_API void XPluginStop(void)
 {
     /* Unregister the callback */
     XPLMUnregisterFlightLoopCallback(MyFlightLoopCallback, NULL);
+    XPLMUnregisterFlightLoopCallback(DeferredRequestsCallback, NULL);
+    delete gSubscriptionSnapshot.exchange(nullptr);  // No frame can read it any more
 
     gTerminateReceiveThread = true;
 
@@ -745,21 +2400,169 @@ PLUGIN_API int XPluginEnable(void)
     return 1;
 }
 
+// Copy the collected channels into the shared frame. Runs on the flight loop, readers on
+// other threads detect a frame being rewritten through the odd sequence number.
+void PublishSharedFrame() {
+    FSFFB_Frame& frame = gSharedFrame;
+
+    frame.sequence++;
+    FSFFB_FENCE();
+
+    uint32_t flags = simPaused ? FSFFB_FRAME_PAUSED : 0;
+    uint32_t channelCount = 0;
+    uint32_t valueCount = 0;
+    uint32_t textLength = 0;
+
+    // telemetryData is ordered by key, which keeps the channel table sorted for FSFFB_FindChannel
+    for (const auto& entry : telemetryData) {
+        const TelemetryChannel& channel = entry.second;
+        size_t count = channel.isText ? channel.text.size() : channel.values.size();
+        size_t capacity = channel.isText ? FSFFB_MAX_TEXT - textLength : FSFFB_MAX_VALUES - valueCount;
+
+        if (channelCount == FSFFB_MAX_CHANNELS || entry.first.size() >= FSFFB_KEY_LENGTH || count + (channel.isText ? 1 : 0) > capacity) {
+            flags |= FSFFB_FRAME_TRUNCATED;
+            continue;
+        }
+
+        FSFFB_Channel& out = frame.channels[channelCount++];
+        std::memcpy(out.key, entry.first.c_str(), entry.first.size() + 1);
+        out.isText = channel.isText ? 1 : 0;
+        out.count = static_cast<uint32_t>(count);
+
+        if (channel.isText) {
+            out.offset = textLength;
+            std::memcpy(frame.text + textLength, channel.text.c_str(), count + 1);
+            textLength += static_cast<uint32_t>(count + 1);
+        }
+        else {
+            out.offset = valueCount;
+            std::copy(channel.values.begin(), channel.values.end(), frame.values + valueCount);
+            valueCount += static_cast<uint32_t>(count);
+        }
+    }
+
+    frame.apiVersion = FSFFB_API_VERSION;
+    frame.size = sizeof(FSFFB_Frame);
+    frame.flags = flags;
+    frame.simTime = gSimTime;
+    frame.channelCount = channelCount;
+    frame.valueCount = valueCount;
+    frame.textLength = textLength;
+
+    FSFFB_FENCE();
+    frame.sequence++;
+}
+
 PLUGIN_API void XPluginReceiveMessage(XPLMPluginID inFromWho, int inMessage, void* inParam)
 {
+    if (inMessage == FSFFB_MSG_GET_FRAME && inParam != nullptr) {
+        // Another plugin asks for the shared frame
+        *static_cast<const FSFFB_Frame**>(inParam) = &gSharedFrame;
+        return;
+    }
+
+    if ((inMessage == XPLM_MSG_PLANE_LOADED && inParam == 0) || inMessage == XPLM_MSG_DATAREFS_ADDED) {
+        // The cached dataref index is out of date, DeferredRequestsCallback expands the pattern subscriptions again
+        gDataRefIndexStale = true;
+    }
+}
+
+// Dataref lookups queued by the receive thread (SUBSCRIBE, AXISDEF), and the pattern expansion after an aircraft
+// load or new datarefs. The lookups and the enumeration run without axisDataMutex, so the
+// flight loop never waits on them; only taking the queues and staging the results lock it.
+float DeferredRequestsCallback(float inElapsedSinceLastCall, float inElapsedTimeSinceLastFlightLoop, int inCounter, void* inRefcon)
+{
+    std::vector<SubscribeRequest> subscribes;
+    std::vector<PatternSubscription> patterns;
+    std::vector<AxisRequest> axes;
+    {
+        std::lock_guard<std::mutex> lock(axisDataMutex);
+        subscribes.swap(gPendingSubscribes);
+        patterns.swap(gPendingPatterns);
+        axes.swap(gPendingAxisDefinitions);
+    }
+
+    for (const auto& request : axes) {
+        DefineAxis(request);
+    }
+
+    // New patterns are expanded now; with a stale index every known pattern is expanded again
+    bool reexpand = gDataRefIndexStale && !patternSubscriptions.empty();
+    std::vector<PatternSubscription> expand;
+    if (reexpand) {
+        expand = patternSubscriptions;
+    }
+    for (const auto& patternSub : patterns) {
+        bool known = std::any_of(patternSubscriptions.begin(), patternSubscriptions.end(),
+            [&patternSub](const PatternSubscription& other) { return other.pattern == patternSub.pattern && other.tagPrefix == patternSub.tagPrefix; });
+        if (!known) {
+            patternSubscriptions.push_back(patternSub);
+        }
+        if (!known || !reexpand) {
+            expand.push_back(patternSub);
+        }
+    }
+
+    if (subscribes.empty() && expand.empty()) {
+        return kDeferredRequestInterval;
+    }
+
+    std::vector<std::pair<std::string, DataRefSubscription>> resolved;
+    for (const auto& request : subscribes) {
+        resolved.emplace_back(request.path, ResolveSubscription(request.path, request.key, request.type, request.precision, request.conversionFactor, request.tier));
+    }
+    std::vector<std::string> patternReplies;
+    for (const auto& patternSub : expand) {
+        int added = ResolvePatternSubscription(patternSub, resolved);
+        patternReplies.push_back("SUBSCRIBED_PATTERN:pattern=" + patternSub.pattern + ",count=" + std::to_string(added));
+    }
 
+    {
+        std::lock_guard<std::mutex> lock(axisDataMutex);
+        for (const auto& entry : resolved) {
+            StageSubscription(entry.first, entry.second);
+        }
+        PublishSubscriptions();
+    }
+    for (const auto& reply : patternReplies) {
+        SendReply(reply);
+    }
+    return kDeferredRequestInterval;
 }
 
 float MyFlightLoopCallback(float inElapsedSinceLastCall, float inElapsedTimeSinceLastFlightLoop, int inCounter, void* inRefcon)
 {
+    // Start from the sim clock, then accumulate the short per-frame intervals in double precision
+    if (gSimTime < 0.0) {
+        gSimTime = XPLMGetElapsedTime();
+    }
+    else {
+        gSimTime += inElapsedSinceLastCall;
+    }
+    gTelemetryFrame++;
+
     SendAxisPosition();
 
     // Collect telemetry data
     CollectTelemetryData();
 
-    // Format and send telemetry data
-    if (!simPaused) {
+    // Stick force passthrough and latency-compensating predictions at sim rate
+    UpdateForcePassthrough(inElapsedSinceLastCall);
+    UpdatePredictions();
+
+    // Make it available to other plugins in-process
+    PublishSharedFrame();
+
+    AnswerPendingQueries();
+
+    // Reduce at sim rate, then format and send telemetry data at the configured or adapted rate
+    double sendHz = CurrentSendHz();
+    SetTelemetryValue("SendHz", sendHz, 1);
+    AccumulateReductions(inElapsedSinceLastCall, sendHz);
+
+    if (!simPaused && SendIntervalElapsed(inElapsedSinceLastCall, sendHz)) {
         FormatAndSendTelemetryData();
+        ResetReductions();
     }
 
 